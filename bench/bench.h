@@ -0,0 +1,172 @@
+/** @file bench.h
+ *  @brief A minimal microbenchmark harness for the hot kernels of the engine.
+ *
+ *  A benchmark is a function taking a BenchState. It prepares its input first,
+ *  then runs the measured operation once per iteration of
+ *		while (st.keepRunning()) { ... }
+ *  Only the loop is timed. The harness repeats a benchmark with more iterations
+ *  until the loop takes at least the minimal time, and reports the last run:
+ *		ns/op		nanoseconds per iteration
+ *		items/s		throughput, where a benchmark tells how many items (states, samples...)
+ *					one iteration processes by BenchState::setItemsPerOp
+ *  A benchmark which can not prepare its input calls BenchState::skipWithError and returns,
+ *  it is then reported as an error, and left out of the csv.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+class BenchState {
+	public:
+		explicit BenchState(long long iterations) : iterations(iterations), done(0), items_per_op(1),
+			elapsed_ns(0), paused(false) {}
+
+		inline bool keepRunning() {
+			if (done == 0)
+				start = std::chrono::steady_clock::now();
+			if (done++ < iterations)
+				return true;
+			stop();
+			return false;
+		}
+
+		/// exclude some work inside the loop from the timing, e.g. resetting the input
+		inline void pauseTiming() {
+			stop();
+			paused = true;
+		}
+
+		inline void resumeTiming() {
+			paused = false;
+			start = std::chrono::steady_clock::now();
+		}
+
+		void setItemsPerOp(long long n) { items_per_op = n; }
+
+		/// give up the benchmark before its loop, the harness reports message instead of its figures
+		void skipWithError(const std::string& message) { error = message; }
+
+		long long getIterations() const { return iterations; }
+		long long getItemsPerOp() const { return items_per_op; }
+		long long getElapsedNs() const { return elapsed_ns; }
+		const std::string& getError() const { return error; }
+
+	private:
+		inline void stop() {
+			if (paused) return;
+			elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now() - start).count();
+		}
+
+		long long iterations;
+		long long done;
+		long long items_per_op;
+		long long elapsed_ns;
+		bool paused;
+		std::chrono::steady_clock::time_point start;
+		std::string error;
+};
+
+typedef void (*BenchFunction)(BenchState& st, int arg);
+
+struct Benchmark {
+	std::string name;
+	BenchFunction func;
+	int arg;
+};
+
+/** \class BenchRegistry
+ *  @brief Keeps all the benchmarks in the order of registration, and runs them.
+ */
+class BenchRegistry {
+	public:
+		static std::vector<Benchmark>& all() {
+			static std::vector<Benchmark> benchmarks;
+			return benchmarks;
+		}
+
+		/// register func once for each arg, named "name/arg"
+		static bool add(const char* name, BenchFunction func, std::vector<int> args) {
+			for (size_t i = 0; i < args.size(); i++) {
+				Benchmark b;
+				b.name = std::string(name) + "/" + std::to_string(args[i]);
+				b.func = func;
+				b.arg = args[i];
+				all().push_back(b);
+			}
+			return true;
+		}
+
+		/** @brief run the benchmarks whose name contains filter, all if filter is NULL
+		 *	@param min_time_ms each benchmark is repeated until it lasts at least this long
+		 *	@param csv if not NULL, the results are also written to it as name,iterations,ns_per_op,items_per_s
+		 */
+		static int run(const char* filter, double min_time_ms, FILE* csv) {
+			printf("%-40s %12s %14s %14s\n", "benchmark", "iterations", "ns/op", "items/s");
+			if (csv != NULL)
+				fprintf(csv, "name,iterations,ns_per_op,items_per_s\n");
+			int num = 0;
+			for (size_t i = 0; i < all().size(); i++) {
+				Benchmark& b = all()[i];
+				if ((filter != NULL) && (b.name.find(filter) == std::string::npos))
+					continue;
+				long long iterations = 1;
+				for (;;) {
+					BenchState st(iterations);
+					b.func(st, b.arg);
+					if (!st.getError().empty()) {
+						printf("%-40s error: %s\n", b.name.c_str(), st.getError().c_str());
+						fflush(stdout);
+						break;
+					}
+					double ms = st.getElapsedNs() / 1e6;
+					if ((ms >= min_time_ms) || (iterations >= 1000000000LL)) {
+						report(b.name, st, csv);
+						break;
+					}
+					// aim at 1.5 times of the minimal time, but grow at most 10 times a step
+					double scale = (ms <= 0) ? 10 : (min_time_ms * 1.5 / ms);
+					if (scale > 10) scale = 10;
+					if (scale < 2) scale = 2;
+					iterations = static_cast<long long>(iterations * scale);
+				}
+				num++;
+			}
+			return num;
+		}
+
+	private:
+		static void report(const std::string& name, const BenchState& st, FILE* csv) {
+			double ns_per_op = static_cast<double>(st.getElapsedNs()) / st.getIterations();
+			double items_per_s = (st.getElapsedNs() <= 0) ? 0
+				: st.getItemsPerOp() * st.getIterations() * 1e9 / st.getElapsedNs();
+			printf("%-40s %12lld %14.1f %14.4g\n", name.c_str(), st.getIterations(), ns_per_op, items_per_s);
+			fflush(stdout);
+			if (csv != NULL)
+				fprintf(csv, "%s,%lld,%.1f,%.6g\n", name.c_str(), st.getIterations(), ns_per_op, items_per_s);
+		}
+};
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+/// BENCHMARK(func, 64, 256, 1024) registers func with each of the args
+#define BENCHMARK(func, ...) \
+	static bool BENCH_CONCAT(_bench_registered_, __LINE__) = BenchRegistry::add(#func, func, {__VA_ARGS__})
+
+/// keep the compiler from optimizing away a result
+template <class T>
+inline void doNotOptimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+#endif
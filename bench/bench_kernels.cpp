@@ -0,0 +1,422 @@
+/** @file bench_kernels.cpp
+ *  @brief Microbenchmarks of the hot kernels of the engine, on synthetic datasets.
+ *
+ *  Usage: ./bench [filter] [--min-time=ms] [--csv=file]
+ *  e.g.   ./bench svmTrain --csv=bench.csv
+ *  runs the benchmarks whose name contains "svmTrain", and saves the results in bench.csv.
+ *
+ *  The datasets are drawn from a fixed seed, so every run measures the same inputs.
+ *  Their size is the argument of a benchmark. Their separability is controlled by the margin:
+ *  the states closer than margin to the real boundary are dropped, margin 0 gives the hardest sets.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "bench.h"
+#include "config.h"
+#include "monomial.h"
+#include "states.h"
+#include "polynomial.h"
+#include "classifier.h"
+#include "svm.h"
+#include "svm_i.h"
+#include "instrumentation.h"
+#include "loop_jit.h"
+
+#include <random>
+#include <sstream>
+#include <vector>
+
+static void print_null(const char *s) {}
+
+enum { SHAPE_LINEAR, SHAPE_QUADRATIC, SHAPE_BOX };
+
+/** \class Dataset
+ *  @brief Labeled integer states in [-range, range]^Nv, like the states of the target loops.
+ *
+ *	SHAPE_LINEAR:		positive iff 1*x0 + 2*x1 + ... + Nv*x{Nv-1} + 1 >= 0
+ *	SHAPE_QUADRATIC:	positive iff x0^2 + ... + x{Nv-1}^2 <= (range/2)^2
+ *	SHAPE_BOX:			positive iff |xi| <= range/2 for all i
+ */
+class Dataset {
+	public:
+		std::vector<double> values;	// size() * Nv
+		std::vector<int> labels;
+
+		Dataset(int num, int shape, double margin = 0.1, int range = 100, unsigned seed = 2016) {
+			std::mt19937 gen(seed);
+			std::uniform_int_distribution<int> value(-range, range);
+			State st;
+			while (size() < num) {
+				for (int j = 0; j < Nv; j++)
+					st[j] = value(gen);
+				double d = distance(st, shape, range);
+				if (d * d < margin * margin * range * range)
+					continue;
+				values.insert(values.end(), st, st + Nv);
+				labels.push_back(d >= 0 ? 1 : -1);
+			}
+		}
+
+		int size() const { return static_cast<int>(labels.size()); }
+
+		State* states(int i = 0) { return reinterpret_cast<State*>(&values[i * Nv]); }
+		double* state(int i) { return &values[i * Nv]; }
+
+	private:
+		/// signed and roughly normalized distance to the boundary, positive inside
+		static double distance(const State& st, int shape, int range) {
+			double d = 0;
+			switch (shape) {
+				case SHAPE_LINEAR:
+					d = 1;
+					for (int j = 0; j < Nv; j++)
+						d += (j + 1) * st[j];
+					return d / Nv;
+				case SHAPE_QUADRATIC:
+					for (int j = 0; j < Nv; j++)
+						d += st[j] * st[j];
+					return (range / 2.0) - sqrt(d);
+				case SHAPE_BOX:
+					d = range;
+					for (int j = 0; j < Nv; j++)
+						d = std::min(d, range / 2.0 - fabs(st[j]));
+					return d;
+			}
+			return 0;
+		}
+};
+
+/// the number of monomials of degree [1, et]
+static int dimension(int et) {
+	static const int dims[5] = { 0, Cv1to1, Cv1to2, Cv1to3, Cv1to4 };
+	return dims[et];
+}
+
+/// map the states of the dataset to degree et, as States::ensureMapped does.
+/// The i-th mapped state starts at i * Cv1to4.
+static std::vector<double> mapDataset(Dataset& ds, int et = 4) {
+	std::vector<double> mapped(ds.size() * Cv1to4);
+	for (int i = 0; i < ds.size(); i++)
+		monomial::expand(ds.state(i), &mapped[i * Cv1to4], et);
+	return mapped;
+}
+
+/// a random dense polynomial of degree et
+static void randomPolynomial(Polynomial& poly, int et, std::mt19937& gen) {
+	std::uniform_real_distribution<double> coef(-1, 1);
+	poly.setEtimes(et);
+	for (int i = 0; i < poly.getDims(); i++)
+		poly.setTheta(i, coef(gen));
+}
+
+
+//**********************************************************************************************
+// States
+//**********************************************************************************************
+
+/// build a set of n states, added in traces of 8 states, 1/8 of the traces duplicated
+static void statesAddStates(BenchState& st, int n) {
+	const int len = 8;
+	Dataset ds(n, SHAPE_LINEAR, 0, 100000);
+	State* traces = ds.states();
+	for (int i = len; i + len <= n; i += 8 * len)
+		memcpy(&traces[i], &traces[i - len], len * sizeof(State));
+	st.setItemsPerOp(n);
+	while (st.keepRunning()) {
+		st.pauseTiming();
+		States* ss = new States();
+		st.resumeTiming();
+		for (int i = 0; i + len <= n; i += len)
+			ss->addStates(&traces[i], len);
+		doNotOptimize(ss->size);
+		st.pauseTiming();
+		delete ss;
+		st.resumeTiming();
+	}
+}
+BENCHMARK(statesAddStates, 256, 1024, 4096);
+
+/// map one state to all the monomials up to degree et
+static void mappingData(BenchState& st, int et) {
+	Dataset ds(1024, SHAPE_LINEAR, 0);
+	SVM svm(0, print_null, 16);
+	MState dst = { 0 };
+	int i = 0;
+	while (st.keepRunning()) {
+		svm.mappingData(ds.state(i), dst, et);
+		doNotOptimize(dst[0]);
+		i = (i + 1) & 1023;
+	}
+}
+BENCHMARK(mappingData, 1, 2, 3, 4);
+
+
+//**********************************************************************************************
+// Polynomial
+//**********************************************************************************************
+
+/// evaluate a polynomial of degree et on one state
+static void polynomialCalc(BenchState& st, int et) {
+	std::mt19937 gen(2016);
+	Polynomial poly;
+	randomPolynomial(poly, et, gen);
+	Dataset ds(1024, SHAPE_LINEAR, 0);
+	int i = 0;
+	while (st.keepRunning()) {
+		double v = Polynomial::calc(poly, ds.state(i));
+		doNotOptimize(v);
+		i = (i + 1) & 1023;
+	}
+}
+BENCHMARK(polynomialCalc, 1, 2, 3, 4);
+
+/// solve a univariate polynomial of the given degree, all of whose roots are real
+static void gslSolvePolynomial(BenchState& st, int degree) {
+	std::mt19937 gen(2016);
+	std::uniform_real_distribution<double> root(-100, 100);
+	std::vector<std::vector<double> > coefs(256);
+	for (size_t k = 0; k < coefs.size(); k++) {
+		// expand (x - r1) * ... * (x - r_degree), coefs[k][i] is the coefficient of x^i
+		std::vector<double>& c = coefs[k];
+		c.assign(1, 1);
+		for (int d = 0; d < degree; d++) {
+			double r = root(gen);
+			c.push_back(0);
+			for (int i = d + 1; i > 0; i--)
+				c[i] = c[i - 1] - r * c[i];
+			c[0] = -r * c[0];
+		}
+	}
+	double result;
+	size_t k = 0;
+	while (st.keepRunning()) {
+		bool ok = Polynomial::gslSolvePolynomial(&coefs[k][0], degree, &result);
+		doNotOptimize(ok);
+		k = (k + 1) & 255;
+	}
+}
+BENCHMARK(gslSolvePolynomial, 2, 3, 4);
+
+
+//**********************************************************************************************
+// SVM
+//**********************************************************************************************
+
+/// one kernel evaluation between two states mapped to degree et
+static void kernelDot(BenchState& st, int et) {
+	Dataset ds(1024, SHAPE_LINEAR, 0);
+	std::vector<double> mapped = mapDataset(ds, et);
+	svm_parameter param;
+	prepare_svm_parameters(&param, 0);
+	setDimension(dimension(et));
+	int i = 0;
+	while (st.keepRunning()) {
+		double v = svm_kernel_function((svm_node*)&mapped[i * Cv1to4],
+				(svm_node*)&mapped[((i + 1) & 1023) * Cv1to4], &param);
+		doNotOptimize(v);
+		i = (i + 1) & 1023;
+	}
+}
+BENCHMARK(kernelDot, 1, 2, 3, 4);
+
+/// train on n states mapped to degree et, as LinearLearner (et = 1) and PolyLearner (et > 1) do
+static void svmTrain(BenchState& st, int n, int shape, double margin, int et) {
+	svm_set_print_string_function(print_null);
+	Dataset ds(n, shape, margin);
+	std::vector<double> mapped = mapDataset(ds, et);
+	std::vector<double*> x(n);
+	std::vector<double> y(n);
+	for (int i = 0; i < n; i++) {
+		x[i] = &mapped[i * Cv1to4];
+		y[i] = ds.labels[i];
+	}
+	svm_problem problem;
+	problem.l = n;
+	problem.x = (svm_node**)&x[0];
+	problem.y = &y[0];
+#ifdef __DS_ENABLED
+	problem.np = problem.nn = 0;
+	for (int i = 0; i < n; i++)
+		(y[i] > 0) ? problem.np++ : problem.nn++;
+#endif
+	svm_parameter param;
+	prepare_svm_parameters(&param, 0);
+	setDimension(dimension(et));
+	st.setItemsPerOp(n);
+	while (st.keepRunning()) {
+		svm_model* model = svm_train(&problem, &param);
+		doNotOptimize(model->l);
+		svm_free_and_destroy_model(&model);
+	}
+}
+
+static void svmTrainLinear(BenchState& st, int n) { svmTrain(st, n, SHAPE_LINEAR, 0.1, 1); }
+static void svmTrainLinearTight(BenchState& st, int n) { svmTrain(st, n, SHAPE_LINEAR, 0, 1); }
+static void svmTrainPoly(BenchState& st, int n) { svmTrain(st, n, SHAPE_QUADRATIC, 0.1, 2); }
+static void svmTrainPolyTight(BenchState& st, int n) { svmTrain(st, n, SHAPE_QUADRATIC, 0, 2); }
+BENCHMARK(svmTrainLinear, 64, 256, 1024, 4096);
+BENCHMARK(svmTrainLinearTight, 64, 256, 1024);
+BENCHMARK(svmTrainPoly, 64, 256, 1024);
+BENCHMARK(svmTrainPolyTight, 64, 256);
+
+/// SVM-I on n states, the positives in a box and the negatives around it
+static void svmITrain(BenchState& st, int n) {
+	Dataset ds(n, SHAPE_BOX, 0.1);
+	States gsets[3];
+	for (int i = 0; i < n; i++)
+		gsets[ds.labels[i] > 0 ? POSITIVE : NEGATIVE].addStates(ds.states(i), 1);
+	st.setItemsPerOp(n);
+	while (st.keepRunning()) {
+		st.pauseTiming();
+		SVM_I* svm_i = new SVM_I(0, print_null, 2 * n);
+		int pre_psize = 0, pre_nsize = 0;
+		svm_i->makeTrainingSet(gsets, pre_psize, pre_nsize);
+		st.resumeTiming();
+		svm_i->train();
+		doNotOptimize(svm_i->cl.size);
+		st.pauseTiming();
+		delete svm_i;
+		st.resumeTiming();
+	}
+}
+BENCHMARK(svmITrain, 64, 256, 1024);
+
+
+//**********************************************************************************************
+// Classifier
+//**********************************************************************************************
+
+/// simplify a conjunction of n bounds x0 >= -k, where all but the tightest one are redundant
+static void classifierSimplify(BenchState& st, int n) {
+	Classifier origin;
+	for (int k = 0; k < n; k++) {
+		Polynomial poly;
+		poly.setTheta(0, k);
+		poly.setTheta(1, 1);
+		origin.add(poly, CONJUNCT);
+	}
+	Classifier cl;
+	while (st.keepRunning()) {
+		st.pauseTiming();
+		cl = origin;
+		st.resumeTiming();
+		cl.simplify();
+		doNotOptimize(cl.size);
+	}
+}
+BENCHMARK(classifierSimplify, 2, 4, 8);
+
+
+//**********************************************************************************************
+// Loop
+//**********************************************************************************************
+
+/// a loop of bound iterations on the variables x0.., x0 going up by 1 or 2
+static std::string benchLoopCfg(int bound) {
+	std::ostringstream cfg;
+	cfg << "names=";
+	for (int i = 0; i < Nv; i++)
+		cfg << " x" << i;
+	cfg << "\nprecondition=x0 == 0\nloopcondition=x0 < " << bound
+		<< "\nloop=if (x0 % 3 == 0) x0 = x0 + 2; else x0++;\npostcondition=x0 >= " << bound << "\n";
+	return cfg.str();
+}
+
+/// run the loop by the interpreter, as the func of a context
+static void loopInterpreted(BenchState& st, int bound) {
+	LoopProgram program;
+	if (!program.parse(benchLoopCfg(bound))) {
+		st.skipWithError(program.error());
+		return;
+	}
+	int input[Nv] = { 0 };
+	st.setItemsPerOp(bound);
+	while (st.keepRunning()) {
+		beforeLoop();
+		program.run(input);
+		doNotOptimize(current_context->state_index);
+	}
+}
+BENCHMARK(loopInterpreted, 16, 256);
+
+/// run the loop compiled in-process, the compilation is not measured
+static void loopJit(BenchState& st, int bound) {
+	LoopProgram program;
+	std::string message;
+	LoopFunction func = program.parse(benchLoopCfg(bound)) ? compileLoopProgram(program, message) : NULL;
+	if (func == NULL) {
+		st.skipWithError(program.error().empty() ? message : program.error());
+		return;
+	}
+	int input[Nv] = { 0 };
+	st.setItemsPerOp(bound);
+	while (st.keepRunning()) {
+		beforeLoop();
+		func(input);
+		doNotOptimize(current_context->state_index);
+	}
+}
+BENCHMARK(loopJit, 16, 256);
+
+/// record x as iif_record does
+static inline void benchRecord(ContextState* c, const int* x) {
+	if (c->state_index < c->record_fast_limit) {
+		for (int i = 0; i < Nv; i++)
+			c->program_states[c->state_index][i] = x[i];
+		c->state_index++;
+		return;
+	}
+	double state[Nv];
+	for (int i = 0; i < Nv; i++)
+		state[i] = x[i];
+	addState(state);
+}
+
+/// the same loop as the program generated by cfg2test runs it
+static void loopNative(BenchState& st, int bound) {
+	st.setItemsPerOp(bound);
+	while (st.keepRunning()) {
+		beforeLoop();
+		ContextState* c = current_context;
+		int x[Nv] = { 0 };
+		c->passP = (x[0] == 0);
+		c->assume_times++;
+		while (x[0] < bound) {
+			benchRecord(c, x);
+			if (x[0] % 3 == 0) x[0] = x[0] + 2; else x[0]++;
+		}
+		benchRecord(c, x);
+		c->passQ = (x[0] >= bound);
+		c->assert_times++;
+		doNotOptimize(c->state_index);
+	}
+}
+BENCHMARK(loopNative, 16, 256);
+
+
+int main(int argc, char** argv) {
+	const char* filter = NULL;
+	const char* csv_name = NULL;
+	double min_time_ms = 200;
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--min-time=", 11) == 0)
+			min_time_ms = atof(argv[i] + 11);
+		else if (strncmp(argv[i], "--csv=", 6) == 0)
+			csv_name = argv[i] + 6;
+		else
+			filter = argv[i];
+	}
+	// kernels are measured without any log output
+	Logger::setLevel(LOG_ERROR);
+
+	FILE* csv = NULL;
+	if ((csv_name != NULL) && ((csv = fopen(csv_name, "w")) == NULL)) {
+		fprintf(stderr, "can not open %s\n", csv_name);
+		return 1;
+	}
+	int num = BenchRegistry::run(filter, min_time_ms, csv);
+	if (csv != NULL)
+		fclose(csv);
+	return (num > 0) ? 0 : 1;
+}
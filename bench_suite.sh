@@ -0,0 +1,449 @@
+#!/bin/bash
+red="\e[31m"
+green="\e[32m"
+yellow="\e[33m"
+blue="\e[34m"
+bold="\e[1m"
+normal="\e[0m"
+
+##########################################################################
+# Runs run_iterative.sh on every cfg in cfg/ with fixed seeds and a time budget,
+# records the figures of each run to CSV and JSON,
+# and compares them against a stored baseline.
+#
+# Each job (a cfg with a seed) runs in its own work directory <out>/work/<prefix>.<seed>,
+# which links the sources, tools and the cfg of the repository, and has its own
+# include/ (config.h is generated per Nv), test/, tmp/, build/ and CMakeLists.txt.
+# So --jobs=N jobs can run at the same time, each worker pinned to a cpu.
+#
+# The figures come from the profile of each run, see include/profiler.h:
+#	status		pass, fail or timeout
+#	wall_s		wall time of run_iterative.sh, including building the target
+#	iterations	learning and verification iterations of run_iterative.sh
+#	samples		distinct traces executed by all the learners
+#	learn_ms	time of all the learner runs
+#	train_ms	svm training time
+#	verify_ms	verification time of all the properties
+#	peak_rss_kb	the largest peak resident set size of the learner runs
+#
+# With --diff-interp, each job instead checks the interpreter of the daemon against cfg2test:
+# the loop is learnt once by the program generated by cfg2test and once by 'iifd --run',
+# both built with the same Nv and run with the same IIF_SEED, and their data sets tmp/<prefix>.ds
+# are compared. The status of a job in diff.csv is then
+#	same		the data sets are the same
+#	differ		the data sets differ, the interpreter does not run the loop as the compiled program does
+#	no_interp	the daemon can not interpret the loop, and compiles it
+#	fail		either run did not build or did not end within the budget
+##########################################################################
+function usage(){
+	echo "./bench_suite.sh [options] [cfg_prefix ...]"
+	echo "  runs all the cfgs in cfg/ if no prefix is given"
+	echo "  --org                  also run the cfgs in cfg/org"
+	echo "  --seeds=1,2,3          run each cfg once with each seed (default 1)"
+	echo "  --budget=600           time budget of one run in seconds"
+	echo "  --unselective          disable selective sampling"
+	echo "  --jobs=N               run N jobs at the same time (default 1)"
+	echo "  --cpus=0,2,4-7         cpus to pin the workers to, one each in turn (default all)"
+	echo "  --no-pin               do not pin the workers"
+	echo "  --mem=MB               cap the virtual memory of each job"
+	echo "  --keep-work            keep the work directories of passed jobs"
+	echo "  --out=dir              where results.csv, results.json and the logs go"
+	echo "                         (default bench_results/<date>)"
+	echo "  --baseline=file        baseline to compare with (default bench/suite_baseline.csv)"
+	echo "  --save-baseline        store the results as the baseline instead of comparing"
+	echo "  --threshold=metric:r   a regression is a metric over r times its baseline,"
+	echo "                         e.g. --threshold=wall_s:1.5, can be given several times"
+	echo "  --diff-interp          compare the data sets of the generated programs with those of 'iifd --run'"
+	echo "                         under the same seeds, instead of measuring the runs"
+}
+
+seeds="1"
+budget=600
+sampling=0
+org=0
+jobs=1
+cpus=""
+pin=1
+mem=""
+keep_work=0
+out=""
+baseline="bench/suite_baseline.csv"
+save_baseline=0
+diff_interp=0
+# default thresholds, ratio of the new value to the baseline
+thresholds="wall_s:1.25 iterations:1.5 samples:1.5 learn_ms:1.25 train_ms:1.25 verify_ms:1.25 peak_rss_kb:1.25"
+user_thresholds=""
+prefixes=""
+
+for arg in "$@"; do
+	case $arg in
+		--org) org=1 ;;
+		--seeds=*) seeds=${arg#--seeds=} ;;
+		--budget=*) budget=${arg#--budget=} ;;
+		--unselective) sampling="" ;;
+		--jobs=*) jobs=${arg#--jobs=} ;;
+		--cpus=*) cpus=${arg#--cpus=} ;;
+		--no-pin) pin=0 ;;
+		--mem=*) mem=${arg#--mem=} ;;
+		--keep-work) keep_work=1 ;;
+		--out=*) out=${arg#--out=} ;;
+		--baseline=*) baseline=${arg#--baseline=} ;;
+		--save-baseline) save_baseline=1 ;;
+		--threshold=*) user_thresholds=$user_thresholds" "${arg#--threshold=} ;;
+		--diff-interp) diff_interp=1 ;;
+		-h|--help) usage; exit 0 ;;
+		-*) echo "unknown option $arg"; usage; exit 1 ;;
+		*) prefixes=$prefixes" "$arg ;;
+	esac
+done
+thresholds=$thresholds$user_thresholds
+
+repo=$(pwd)
+if [ -z "$out" ]; then
+	out="bench_results/"$(date +%Y%m%d-%H%M%S)
+fi
+mkdir -p $out/log $out/work $out/rows
+out=$(cd $out && pwd)
+csv=$out"/results.csv"
+json=$out"/results.json"
+
+# cfgs in cfg/org run under the name org_<prefix>
+if [ -z "$prefixes" ]; then
+	for file in `find cfg/ -maxdepth 1 -name '*.cfg' | sort`; do
+		filename=${file#cfg/}
+		prefixes=$prefixes" "${filename%.cfg}
+	done
+	if [ $org -eq 1 ]; then
+		for file in `find cfg/org/ -maxdepth 1 -name '*.cfg' | sort`; do
+			filename=${file#cfg/org/}
+			prefixes=$prefixes" org_"${filename%.cfg}
+		done
+	fi
+fi
+
+# the job list, one "prefix seed" a line
+joblist=$out"/jobs"
+rm -f $joblist
+for prefix in $prefixes; do
+	for seed in ${seeds//,/ }; do
+		echo "$prefix $seed" >> $joblist
+	done
+done
+njobs=$(wc -l < $joblist)
+
+# cpus of the workers
+cpulist=""
+if [ $pin -eq 1 ]; then
+	if ! command -v taskset > /dev/null; then
+		echo -e $yellow"taskset is not found, the workers are not pinned."$normal
+		pin=0
+	elif [ -z "$cpus" ]; then
+		cpulist=$(seq 0 $(($(nproc) - 1)))
+	else
+		for range in ${cpus//,/ }; do
+			cpulist=$cpulist" "$(seq ${range%-*} ${range#*-})
+		done
+	fi
+fi
+cpulist=($cpulist)
+
+# the tools are shared by all the jobs, so they are built once here
+echo -e $blue"Building the tools..."$normal
+cd tools
+./make_tools.sh
+if [ $? -ne 0 ]; then
+	exit 1
+fi
+cd ..
+export IIF_PREBUILT_TOOLS=1
+# the runs are measured, none of them is taken from the cache of results
+unset IIF_RESULT_CACHE
+if [ $diff_interp -eq 1 ]; then
+	# the data sets only depend on the loop and the seed, nothing is kept across runs or cut by time
+	unset IIF_SAMPLE_LIB IIF_CHECKPOINT IIF_PORTFOLIO IIF_TIME_BUDGET IIF_MEM_BUDGET IIF_JIT
+fi
+
+
+##########################################################################
+# prepare the work directory $1 for cfg prefix $2
+##########################################################################
+function func_makeWorkdir(){
+w=$1
+rm -rf $w
+mkdir -p $w/cfg $w/include $w/test $w/tmp $w/build
+cp $repo/include/*.h $w/include/
+for f in src tools bench daemon cmake.in config.h.in run_iterative.sh build_project.sh gen_init.sh verify.sh; do
+	ln -s $repo/$f $w/$f
+done
+if [ "${2#org_}" != "$2" ] && [ -f $repo/cfg/org/${2#org_}.cfg ]; then
+	ln -s $repo/cfg/org/${2#org_}.cfg $w/cfg/$2.cfg
+else
+	ln -s $repo/cfg/$2.cfg $w/cfg/$2.cfg
+fi
+}
+
+
+##########################################################################
+# sum up the profile of a run: samples learn_ms train_ms verify_ms peak_rss_kb
+##########################################################################
+function func_profileSummary(){
+if [ ! -s $1 ]; then
+	echo "NA,NA,NA,NA,NA"
+	return
+fi
+awk -F, '
+$2 == "total" && $4 == "traces" { samples += $5 }
+$2 == "total" && $4 == "wall_ms" { learn += $5 }
+$2 == "total" && $4 == "svm_train_ms" { train += $5 }
+$2 == "total" && $4 == "peak_rss_kb" && $5 > rss { rss = $5 }
+$2 == "verify" && $4 == "verify_ms" { verify += $5 }
+END { printf "%d,%.1f,%.1f,%.1f,%d\n", samples, learn, train, verify, rss }' $1
+}
+
+
+##########################################################################
+# run job number $1: cfg prefix $2 with seed $3, the result row goes to rows/$1.csv
+##########################################################################
+function func_runJob(){
+i=$1
+prefix=$2
+seed=$3
+w=$out"/work/"$prefix"."$seed
+log=$out"/log/"$prefix"."$seed".log"
+func_makeWorkdir $w $prefix
+
+start=$(date +%s%N)
+(
+	cd $w
+	if [ -n "$mem" ]; then
+		ulimit -v $(($mem * 1024))
+	fi
+	IIF_SEED=$seed timeout $budget ./run_iterative.sh $prefix $sampling
+) > $log 2>&1
+ret=$?
+end=$(date +%s%N)
+wall=$(($end - $start))
+wall_s=$(($wall / 1000000000)).$(printf "%03d" $((($wall / 1000000) % 1000)))
+
+if [ $ret -eq 0 ]; then
+	status="pass"
+	result=$green$bold"[PASS]"$normal
+elif [ $ret -eq 124 ]; then
+	status="timeout"
+	result=$yellow$bold"[TIMEOUT]"$normal
+else
+	status="fail"
+	result=$red$bold"[FAIL]"$normal
+fi
+echo -e $blue$i"/"$njobs" --> "$prefix" [seed "$seed"] "$result" "$wall_s"s"
+
+iterations=$(grep -o "Iteration [0-9]*" $log | tail -n 1 | awk '{print $2}')
+if [ -z "$iterations" ]; then
+	iterations=0
+fi
+name=$prefix
+if [ "${prefix#org_}" != "$prefix" ] && [ -f $repo/cfg/org/${prefix#org_}.cfg ]; then
+	name="org/"${prefix#org_}
+fi
+summary=$(func_profileSummary $w"/tmp/"$prefix".prof.csv")
+echo "$name,$seed,$status,$wall_s,$iterations,$summary" > $out"/rows/"$(printf "%06d" $i)".csv"
+# the work directory is kept for failed jobs to look into
+if [ $status = "pass" ] && [ $keep_work -eq 0 ]; then
+	rm -rf $w
+fi
+}
+
+
+##########################################################################
+# run job number $1 in --diff-interp mode: cfg prefix $2 with seed $3, the result row goes to rows/$1.csv
+##########################################################################
+function func_diffJob(){
+i=$1
+prefix=$2
+seed=$3
+w=$out"/work/"$prefix"."$seed
+log=$out"/log/"$prefix"."$seed".log"
+func_makeWorkdir $w $prefix
+
+start=$(date +%s%N)
+(
+	cd $w
+	if [ -n "$mem" ]; then
+		ulimit -v $(($mem * 1024))
+	fi
+	# iifd is built by the CMakeLists.txt of the generated program, so it has the same Nv
+	./build_project.sh $prefix tmp/$prefix.cnt tmp/$prefix.ds $sampling || exit 1
+	cd build
+	make iifd > /dev/null || exit 1
+	# a run which finds a counter-example ends with an error, its data set is compared all the same
+	echo "----- generated program"
+	IIF_SEED=$seed timeout $budget ./$prefix
+	if [ $? -eq 124 ]; then exit 1; fi
+	echo "----- iifd --run"
+	IIF_SEED=$seed timeout $budget ./iifd --run=../cfg/$prefix.cfg --name=$prefix"_interp"
+	if [ $? -eq 124 ]; then exit 1; fi
+	exit 0
+) > $log 2>&1
+ret=$?
+end=$(date +%s%N)
+wall=$(($end - $start))
+wall_s=$(($wall / 1000000000)).$(printf "%03d" $((($wall / 1000000) % 1000)))
+
+ds=$w"/tmp/"$prefix".ds"
+if grep -q "iifd: can not interpret the loop" $log; then
+	status="no_interp"
+	result=$yellow$bold"[NO INTERP]"$normal
+elif [ $ret -ne 0 ] || [ ! -f $ds ] || [ ! -f $w"/tmp/"$prefix"_interp.ds" ]; then
+	status="fail"
+	result=$red$bold"[FAIL]"$normal
+elif cmp -s $ds $w"/tmp/"$prefix"_interp.ds"; then
+	status="same"
+	result=$green$bold"[SAME]"$normal
+else
+	status="differ"
+	result=$red$bold"[DIFFER]"$normal
+fi
+echo -e $blue$i"/"$njobs" --> "$prefix" [seed "$seed"] "$result" "$wall_s"s"
+
+name=$prefix
+if [ "${prefix#org_}" != "$prefix" ] && [ -f $repo/cfg/org/${prefix#org_}.cfg ]; then
+	name="org/"${prefix#org_}
+fi
+echo "$name,$seed,$status,$wall_s" > $out"/rows/"$(printf "%06d" $i)".csv"
+# the work directory, with both data sets, is kept for the jobs to look into
+if [ $status != "differ" ] && [ $status != "fail" ] && [ $keep_work -eq 0 ]; then
+	rm -rf $w
+fi
+}
+
+
+##########################################################################
+# worker $1 takes the next job from the list until none is left
+##########################################################################
+function func_worker(){
+if [ $pin -eq 1 ]; then
+	# the jobs started afterwards inherit the affinity
+	taskset -cp ${cpulist[$(($1 % ${#cpulist[@]}))]} $BASHPID > /dev/null
+fi
+while true; do
+	i=$(flock $out"/next.lock" bash -c 'n=$(cat '$out'/next); echo $(($n + 1)) > '$out'/next; echo $n')
+	if [ $i -gt $njobs ]; then
+		return 0
+	fi
+	if [ $diff_interp -eq 1 ]; then
+		func_diffJob $i $(sed -n $i"p" $joblist)
+	else
+		func_runJob $i $(sed -n $i"p" $joblist)
+	fi
+done
+}
+
+
+##########################################################################
+# run the suite
+##########################################################################
+echo 1 > $out"/next"
+rm -f $out/rows/*.csv
+if [ $jobs -gt $njobs ]; then
+	jobs=$njobs
+fi
+echo -e $blue"Running "$njobs" jobs by "$jobs" workers..."$normal
+for ((k = 0; k < $jobs; k++)); do
+	func_worker $k &
+done
+wait
+
+# --diff-interp reports the jobs whose data sets differ, and is not compared with the baseline
+if [ $diff_interp -eq 1 ]; then
+	diff_csv=$out"/diff.csv"
+	echo "cfg,seed,status,wall_s" > $diff_csv
+	cat $out/rows/*.csv >> $diff_csv 2>/dev/null
+	rm -rf $out/rows $out/next $out/next.lock $joblist
+	echo -e $blue"results saved in "$diff_csv$normal
+	awk -F, 'NR > 1 { n[$3]++ }
+	END { printf "  same %d, differ %d, no_interp %d, fail %d\n", n["same"], n["differ"], n["no_interp"], n["fail"] }' $diff_csv
+	if grep -q ",differ,\|,fail," $diff_csv; then
+		echo -e $red$bold"[DIFFER]"$normal
+		exit 1
+	fi
+	echo -e $green$bold"[SAME]"$normal
+	exit 0
+fi
+
+echo "cfg,seed,status,wall_s,iterations,samples,learn_ms,train_ms,verify_ms,peak_rss_kb" > $csv
+cat $out/rows/*.csv >> $csv 2>/dev/null
+rm -rf $out/rows $out/next $out/next.lock $joblist
+
+# the same records as a json array
+awk -F, '
+NR == 1 { for (i = 1; i <= NF; i++) key[i] = $i; n = NF; printf "["; next }
+{
+	printf "%s\n  {", (NR > 2) ? "," : ""
+	for (i = 1; i <= n; i++) {
+		v = $i
+		if ((i <= 3) || (v == "NA")) v = "\"" v "\""
+		printf "%s\"%s\": %s", (i > 1) ? ", " : "", key[i], v
+	}
+	printf "}"
+}
+END { printf "\n]\n" }' $csv > $json
+echo -e $blue"results saved in "$csv" and "$json$normal
+
+
+##########################################################################
+# compare with the baseline
+##########################################################################
+if [ $save_baseline -eq 1 ]; then
+	mkdir -p $(dirname $baseline)
+	cp $csv $baseline
+	echo -e $green$bold"baseline saved to "$baseline$normal
+	exit 0
+fi
+if [ ! -s $baseline ]; then
+	echo -e $yellow"no baseline at "$baseline", run with --save-baseline to store one."$normal
+	exit 0
+fi
+
+echo -e $blue"comparing with "$baseline" ..."$normal
+awk -F, -v thresholds="$thresholds" '
+BEGIN {
+	n = split(thresholds, t, " ")
+	for (i = 1; i <= n; i++) {
+		split(t[i], kv, ":")
+		limit[kv[1]] = kv[2]
+	}
+}
+FNR == 1 { for (i = 1; i <= NF; i++) col[FILENAME, $i] = i; next }
+NR == FNR { base[$1 "," $2] = $0; next }
+{
+	key = $1 "," $2
+	if (!(key in base)) { printf "  %-40s new, no baseline\n", key; next }
+	split(base[key], b, ",")
+	if ((b[3] == "pass") && ($3 != "pass")) {
+		printf "  %-40s REGRESSION status %s -> %s\n", key, b[3], $3
+		bad++
+		next
+	}
+	if (($3 != "pass") || (b[3] != "pass")) next
+	for (m in limit) {
+		i = col[FILENAME, m]
+		if ((i == "") || ($i == "NA") || (b[i] == "NA") || (b[i] <= 0)) continue
+		# times below 1s are mostly noise
+		if ((m == "wall_s") && ($i < 1) && (b[i] < 1)) continue
+		if ((m ~ /_ms$/) && ($i < 1000) && (b[i] < 1000)) continue
+		ratio = $i / b[i]
+		if (ratio > limit[m]) {
+			printf "  %-40s REGRESSION %s %s -> %s (x%.2f > x%s)\n", key, m, b[i], $i, ratio, limit[m]
+			bad++
+		} else if (ratio < 1 / limit[m]) {
+			printf "  %-40s improved %s %s -> %s (x%.2f)\n", key, m, b[i], $i, ratio
+		}
+	}
+}
+END { exit (bad > 0) ? 1 : 0 }' $baseline $csv
+if [ $? -ne 0 ]; then
+	echo -e $red$bold"[REGRESSION]"$normal
+	exit 1
+fi
+echo -e $green$bold"[NO REGRESSION]"$normal
+exit 0
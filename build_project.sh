@@ -75,6 +75,8 @@ cat ./cmake.in >> $cmakefile
 echo "add_executable("$prefix" "$path_cpp" \${DIR_SRCS} \${HEADER})" >> $cmakefile
 echo "target_link_libraries("$prefix" \${Z3_LIBRARY})" >> $cmakefile
 echo "target_link_libraries("$prefix" \${GSL_LIBRARIES})" >> $cmakefile
+echo "target_link_libraries("$prefix" \${CMAKE_THREAD_LIBS_INIT})" >> $cmakefile
+echo "target_link_libraries("$prefix" \${CMAKE_DL_LIBS})" >> $cmakefile
 echo -e $green$bold"[DONE]"$normal
 
 
@@ -0,0 +1,471 @@
+/** @file iifd.cpp
+ *  @brief A resident inference daemon, which learns the invariants of the loops submitted over a local socket.
+ *
+ *  Usage: ./iifd [--socket=path] [--jobs=n] [--compile]						serve, from the build folder
+ *		   ./iifd [--socket=path] --submit=cfgfile [--name=prefix]			submit one loop and wait for its result
+ *		   ./iifd --run=cfgfile [--name=prefix] [--compile]					learn one loop in this process, without a daemon
+ *  e.g.   cd build && ./iifd --jobs=4 &
+ *		   ./iifd --submit=../cfg/f2.cfg --name=f2
+ *  The socket is ../tmp/iifd.sock by default.
+ *
+ *  The engine, Z3 and GSL are loaded once by the daemon. For each job it forks a worker, which
+ *		1. writes the cfg to tmp/<name>.cfg,
+ *		2. compiles the loop into bytecode and learns it by the interpreter, see LoopProgram,
+ *		   with the same files as ./<name> would use, e.g. tmp/<name>.inv is then checked by ./verify.sh <name>.
+ *  If the loop uses some C the interpreter does not support, or with --compile, the worker instead
+ *		2. converts the cfg by cfg2test, as build_project.sh does,
+ *		3. compiles only the generated loop into a shared object, kept in tmp/iifd/ under a hash of its source,
+ *		   of the compiler command and of this executable, which the engine is linked into,
+ *		   so that a loop submitted again is not compiled again,
+ *		4. loads it and runs its main in-process.
+ *  The worker stops at the end of the job, so a timeout or a counter-example of the loop does not stop the daemon.
+ *  The engine ends the worker by exit only on a round which does not return before the timeout alarm,
+ *  and the worker still reports the code.
+ *
+ *  Protocol: the client sends a line "job <name>", followed by the cfg payload, and closes its side.
+ *  The daemon answers with the output of the learners as it is produced, then the lines
+ *		iifd: invariant <invariant>		if one is found
+ *		iifd: done <code>				the exit code of the loop program, 0 if an invariant is found, -2 on a counter-example
+ *  or "iifd: error <message>". The client (--submit) prints them all and exits with the code,
+ *  or with 3 if the daemon can not run the job, e.g. the loop does not have Nv variables.
+ *
+ *  With IIF_JIT=1 in the environment of the daemon, the bytecode is compiled into native code instead, see loop_jit.h.
+ *  The loops not interpreted are compiled with the compiler and the flags the daemon is built with, see IIFD_CXX.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "config.h"
+#include "logger.h"
+#include "iif.h"
+#include "loop_program.h"
+#include "loop_key.h"
+#include "z3++.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <csignal>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#ifndef IIFD_CXX
+#define IIFD_CXX "clang++"
+#endif
+#ifndef IIFD_CXX_FLAGS
+#define IIFD_CXX_FLAGS "-std=gnu++11 -I../include"
+#endif
+
+/// a hash of the engine, which this executable is linked with, the loops compiled by another build are not reused
+static std::string engine_id;
+
+/// a job can not be run by this daemon, see the exit codes of --submit
+static const int job_rejected = 3;
+
+/// the job run by this process, and whether its result is written already, see reportExit
+static std::string job_prefix;
+static bool job_reported = false;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onStop(int) {
+	stopping = 1;
+}
+
+/// only interrupts accept, so that the workers done are reaped
+static void onChild(int) {
+}
+
+static bool writeAll(int fd, const char* data, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, data, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool readAll(int fd, std::string& data) {
+	char buf[4096];
+	for (;;) {
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+		if (n == 0) return true;
+		data.append(buf, n);
+	}
+}
+
+static bool readFile(const std::string& name, std::string& data) {
+	std::ifstream fin(name.c_str(), std::ios::binary);
+	if (!fin) return false;
+	std::ostringstream sout;
+	sout << fin.rdbuf();
+	data = sout.str();
+	return true;
+}
+
+/// a hash of this executable, or of the file it is run from where /proc is missing
+static std::string engineId(const char* argv0) {
+	std::string binary;
+	if (!readFile("/proc/self/exe", binary) && !readFile(argv0, binary))
+		return "";
+	return hashName(fnv1a(binary));
+}
+
+/// the name of a job ends up in file names and in shell commands
+static bool validName(const std::string& name) {
+	if (name.empty() || (name[0] == '.')) return false;
+	for (size_t i = 0; i < name.size(); i++)
+		if (!isalnum(name[i]) && (name[i] != '_') && (name[i] != '-') && (name[i] != '.'))
+			return false;
+	return true;
+}
+
+static int connectTo(const char* path) {
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/// write the result lines of a job, once
+static void reportResult(const std::string& prefix, int ret) {
+	if (job_reported)
+		return;
+	job_reported = true;
+	std::string invariant;
+	if ((ret == 0) && readFile("../" + prefix + ".inv", invariant))
+		std::cout << "iifd: invariant " << invariant << std::endl;
+	std::cout << "iifd: done " << ret << std::endl;
+}
+
+/// tell the client the result of a job, once the messages of the learners are written
+static int finishJob(const std::string& prefix, int ret) {
+	Logger::flush();
+	reportResult(prefix, ret);
+	return ret;
+}
+
+/** @brief tell the client the result of a job which ends the process by exit, e.g. by the timeout alarm.
+ *		   It runs after the logger has written its messages at exit, as the logger is started later in the job.
+ *		   It does not wait for the logger, exit may be called by the timeout alarm.
+ */
+static void reportExit(int code, void*) {
+	if (!job_prefix.empty())
+		reportResult(job_prefix, code);
+}
+
+/// learn the loop by the bytecode interpreter, with the same files as the program generated by cfg2test
+static int interpretJob(const LoopProgram& program, const std::string& prefix) {
+	program.writeVarFile(("../" + prefix + ".var").c_str());
+	int ret;
+	{
+		iif::iifContext context(program, ("../" + prefix + ".ds").c_str());
+		program.setup(context);
+		ret = context.learn(("../" + prefix + ".cnt").c_str(), ("../" + prefix).c_str());
+	}
+	return finishJob(prefix, ret);
+}
+
+/// convert the loop by cfg2test, compile it into a shared object and run its main
+static int compileJob(const std::string& name, const std::string& prefix) {
+	std::string command = "cd .. && tools/bin/cfg2test " + prefix + ".cfg " + prefix + ".cpp "
+		+ prefix + ".var " + prefix + " " + prefix + ".cnt " + prefix + ".ds";
+	int status = system(command.c_str());
+	std::cout << std::endl;
+	// cfg2test exits with the number of variables of the loop, the shell with 126 or more if it can not run it
+	int vnum = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	if ((vnum <= 0) || (vnum >= 126)) {
+		std::cout << "iifd: error cfg2test failed";
+		if (vnum >= 0)
+			std::cout << " with status " << vnum;
+		std::cout << ", is tools/bin/cfg2test built by tools/make_tools.sh?" << std::endl;
+		return job_rejected;
+	}
+	if (vnum != Nv) {
+		std::cout << "iifd: error the loop has " << vnum << " variables, this daemon is built with Nv=" << Nv << std::endl;
+		return job_rejected;
+	}
+
+	std::string source;
+	if (!readFile("../" + prefix + ".cpp", source)) {
+		std::cout << "iifd: error cfg2test did not generate ../" << prefix << ".cpp" << std::endl;
+		return job_rejected;
+	}
+	std::string hash = hashName(fnv1a(source + "\n" + IIFD_CXX + " " + IIFD_CXX_FLAGS + "\n" + engine_id));
+	std::string object = "../tmp/iifd/" + hash + ".so";
+	if (access(object.c_str(), R_OK) == 0) {
+		std::cout << "iifd: reuse " << object << std::endl;
+	} else {
+		// the generated main is renamed, and exported without mangling
+		std::string entry = "../tmp/iifd/" + hash + ".cpp";
+		{
+			std::ofstream fout(entry.c_str());
+			fout << "extern \"C\" int iifJobMain(int argc, char** argv);\n"
+				<< "#define main iifJobMain\n"
+				<< "#include \"../" << name << ".cpp\"\n";
+		}
+		// concurrent jobs may compile the same loop, the last one replaces the object
+		char partial[64];
+		snprintf(partial, sizeof(partial), ".%d", (int)getpid());
+		std::cout << "iifd: compile " << object << std::endl;
+		command = std::string(IIFD_CXX) + " " + IIFD_CXX_FLAGS + " -fPIC -shared -o " + object + partial + " " + entry;
+		status = system(command.c_str());
+		if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0) || (rename((object + partial).c_str(), object.c_str()) != 0)) {
+			unlink((object + partial).c_str());
+			std::cout << "iifd: error can not compile the loop" << std::endl;
+			return job_rejected;
+		}
+	}
+
+	void* handle = dlopen(object.c_str(), RTLD_NOW | RTLD_LOCAL);
+	int (*jobMain)(int, char**) = (handle != NULL) ? (int (*)(int, char**))dlsym(handle, "iifJobMain") : NULL;
+	if (jobMain == NULL) {
+		std::cout << "iifd: error " << dlerror() << std::endl;
+		return job_rejected;
+	}
+	char program[256];
+	snprintf(program, sizeof(program), "%s", name.c_str());
+	char* argv[] = { program, NULL };
+	return finishJob(prefix, jobMain(1, argv));
+}
+
+/** @brief run one job, its stdout and stderr are already the client socket in a worker
+ *	@param compile compile the loop even if it can be interpreted
+ *	@return the exit code of the worker
+ */
+static int runJob(const std::string& request, bool compile) {
+	size_t eol = request.find('\n');
+	std::string head = request.substr(0, eol);
+	std::string cfg = (eol == std::string::npos) ? "" : request.substr(eol + 1);
+	std::string name;
+	if (head.compare(0, 4, "job ") == 0)
+		name = head.substr(4);
+	if (!validName(name)) {
+		std::cout << "iifd: error a request should start with \"job <name>\", the name in [A-Za-z0-9_.-]" << std::endl;
+		return job_rejected;
+	}
+
+	// the same files as build_project.sh and run_once.sh use, relative to the repository
+	std::string prefix = "tmp/" + name;
+	job_prefix = prefix;
+	on_exit(reportExit, NULL);
+	{
+		std::ofstream fout(("../" + prefix + ".cfg").c_str());
+		fout << cfg;
+		if (!fout) {
+			std::cout << "iifd: error can not write ../" << prefix << ".cfg" << std::endl;
+			return job_rejected;
+		}
+	}
+	if (!compile) {
+		LoopProgram program;
+		if (program.parse(cfg))
+			return interpretJob(program, prefix);
+		std::cout << "iifd: can not interpret the loop, " << program.error() << ", compile it instead" << std::endl;
+	}
+	return compileJob(name, prefix);
+}
+
+static int serve(const char* path, int jobs, bool compile) {
+	struct sockaddr_un addr;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "iifd: socket path %s is too long\n", path);
+		return 1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path);
+	if ((listener < 0) || (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0) || (listen(listener, 64) != 0)) {
+		fprintf(stderr, "iifd: can not listen on %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	mkdir("../tmp", 0755);
+	mkdir("../tmp/iifd", 0755);
+
+	// the first Z3 context initializes the solver once, the workers inherit it
+	{
+		z3::config cfg;
+		z3::context ctx(cfg);
+	}
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onStop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = onChild;
+	sigaction(SIGCHLD, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	fprintf(stdout, "iifd: serving loops of %d variables on %s, %d jobs at a time\n", Nv, path, jobs);
+	fflush(stdout);
+
+	// the daemon itself does not log, so that the logger thread is only started in the workers
+	int running = 0;
+	while (!stopping) {
+		while (waitpid(-1, NULL, WNOHANG) > 0)
+			running--;
+		if (running >= jobs) {
+			if (wait(NULL) > 0)
+				running--;
+			continue;
+		}
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0)
+			continue;
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(listener);
+			signal(SIGINT, SIG_DFL);
+			signal(SIGTERM, SIG_DFL);
+			signal(SIGCHLD, SIG_DFL);
+			std::string request;
+			readAll(fd, request);
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+			// exit flushes the log messages still queued
+			exit(runJob(request, compile));
+		}
+		close(fd);
+		if (pid > 0)
+			running++;
+	}
+	close(listener);
+	unlink(path);
+	while (wait(NULL) > 0);
+	return 0;
+}
+
+/// run one job in this process, as a worker of the daemon would
+static int runLocal(const char* cfgfile, const char* name, bool compile) {
+	std::string cfg;
+	if (!readFile(cfgfile, cfg)) {
+		fprintf(stderr, "iifd: can not read %s\n", cfgfile);
+		return job_rejected;
+	}
+	mkdir("../tmp", 0755);
+	mkdir("../tmp/iifd", 0755);
+	return runJob(std::string("job ") + name + "\n" + cfg, compile);
+}
+
+static int submit(const char* path, const char* cfgfile, const char* name) {
+	std::string request = std::string("job ") + name + "\n";
+	std::string cfg;
+	if (!readFile(cfgfile, cfg)) {
+		fprintf(stderr, "iifd: can not read %s\n", cfgfile);
+		return job_rejected;
+	}
+	request += cfg;
+	int fd = connectTo(path);
+	if (fd < 0) {
+		fprintf(stderr, "iifd: no daemon on %s\n", path);
+		return job_rejected;
+	}
+	if (!writeAll(fd, request.data(), request.size())) {
+		close(fd);
+		return job_rejected;
+	}
+	shutdown(fd, SHUT_WR);
+
+	// print the answer as it comes, and keep the last line to get the result
+	int ret = job_rejected;
+	std::string line;
+	char buf[4096];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) != 0) {
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		fwrite(buf, 1, n, stdout);
+		fflush(stdout);
+		for (ssize_t i = 0; i < n; i++) {
+			if (buf[i] != '\n') {
+				line += buf[i];
+				continue;
+			}
+			if (line.compare(0, 11, "iifd: done ") == 0)
+				ret = atoi(line.c_str() + 11);
+			line.clear();
+		}
+	}
+	close(fd);
+	return ret;
+}
+
+int main(int argc, char** argv) {
+	const char* path = "../tmp/iifd.sock";
+	const char* cfgfile = NULL;
+	const char* runfile = NULL;
+	const char* name = NULL;
+	bool compile = false;
+	int jobs = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--socket=", 9) == 0)
+			path = argv[i] + 9;
+		else if (strncmp(argv[i], "--jobs=", 7) == 0)
+			jobs = atoi(argv[i] + 7);
+		else if (strncmp(argv[i], "--submit=", 9) == 0)
+			cfgfile = argv[i] + 9;
+		else if (strncmp(argv[i], "--run=", 6) == 0)
+			runfile = argv[i] + 6;
+		else if (strcmp(argv[i], "--compile") == 0)
+			compile = true;
+		else if (strncmp(argv[i], "--name=", 7) == 0)
+			name = argv[i] + 7;
+		else {
+			fprintf(stderr, "usage: %s [--socket=path] [--jobs=n] [--compile] [--submit=cfgfile | --run=cfgfile] [--name=prefix]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (jobs < 1) jobs = 1;
+	// the client does not compile any loop
+	if (cfgfile == NULL)
+		engine_id = engineId(argv[0]);
+
+	if ((cfgfile != NULL) || (runfile != NULL)) {
+		const char* file = (runfile != NULL) ? runfile : cfgfile;
+		std::string job = (name != NULL) ? name : "";
+		if (job.empty()) {
+			// cfg/f2.cfg is submitted as f2
+			job = file;
+			size_t slash = job.rfind('/');
+			if (slash != std::string::npos) job = job.substr(slash + 1);
+			size_t dot = job.rfind('.');
+			if (dot != std::string::npos) job = job.substr(0, dot);
+		}
+		if (runfile != NULL)
+			return runLocal(runfile, job.c_str(), compile);
+		return submit(path, cfgfile, job.c_str());
+	}
+	return serve(path, jobs, compile);
+}
@@ -16,6 +16,10 @@
 #include "classifier.h"
 #include "candidates.h"
 #include "instrumentation.h"
+#include "sampler.h"
+#include "checkpoint.h"
+#include "time_budget.h"
+#include "sample_library.h"
 #include "color.h"
 
 #include <iostream>
@@ -25,15 +29,21 @@
 #include <assert.h>
 #include <sys/time.h>
 #include <unistd.h>
-
-#ifdef __PRT_STATISTICS
-extern int random_samples, selective_samples;
-#endif
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 
 class BaseLearner{
 	public:
-		BaseLearner(States* gsets, /*const char* cntempl_fname = NULL,*/ int (*func)(int*) = target_program):
-			gsets(gsets), func(func) { }
+		/** @brief the learner works in the context current at its construction,
+		 *		   func NULL stands for the program registered in that context
+		 */
+		BaseLearner(States* gsets, /*const char* cntempl_fname = NULL,*/ int (*func)(int*) = NULL):
+			gsets(gsets), context(current_context), cancel_flag(NULL), round_listener(NULL),
+			slice_end(TimeBudget::Clock::time_point::max()), restored(false) {
+			this->func = (func != NULL) ? func : context->target_program;
+			resumeRounds();
+		}
 
 		virtual ~BaseLearner() {
 		} 
@@ -41,19 +51,20 @@ class BaseLearner{
 		void runCounterExampleFile(const char* cntempl_fname = NULL) {
 			std::cout.unsetf(std::ios::fixed);
 			if (cntempl_fname!= NULL) {
+				std::lock_guard<std::mutex> lock(context->states_mutex);
 				std::ifstream fin(cntempl_fname);
 				if (fin) {
 					Solution s;
-					while (fin >> s) {
+					while (!counterExample() && (fin >> s)) {
 						//std::cout.setf(std::ios::fixed);
-						std::cout << BLUE << BOLD << "Test on Last Counter Example: "
+						IIF_LOG(LOG_LEARN, LOG_INFO) << BLUE << BOLD << "Test on Last Counter Example: "
 							<< s << " from file " << cntempl_fname << " --> " << NORMAL << NORMAL;
 						//std::cout.unsetf(std::ios::fixed);
 						int ret = runTarget(s);
 						printRunResult(ret);
-						std::cout << std::endl << NORMAL;
+						IIF_LOG(LOG_LEARN, LOG_INFO) << std::endl << NORMAL;
 					}
-					int newscope = maxv;
+					int newscope = context->maxv;
 					for (int i = 0; i < Nv; i++) {
 						while(std::abs(s[i]) > newscope) {
 							if (newscope * 2 >= 0)
@@ -62,55 +73,189 @@ class BaseLearner{
 								break;
 						}
 					}
-					if (newscope > maxv) {
-						maxv = newscope;
-						minv = -1 * maxv;
-#ifdef __PRT
-						std::cout << YELLOW << "new scope:=[" << minv << "," << maxv << "]" << NORMAL << std::endl;
-#endif
+					if (newscope > context->maxv) {
+						context->maxv = newscope;
+						context->minv = -1 * newscope;
+						IIF_LOG(LOG_LEARN, LOG_DEBUG) << YELLOW << "new scope:=[" << context->minv << "," << context->maxv << "]" << NORMAL << std::endl;
 					}
 					fin.close();
 				}
 			}
 		}
 
+		/** @brief add the executions of a sample library, see iifContext::setSampleLibrary.
+		 *		   The states of a deterministic target are added as they are, the other inputs are executed again.
+		 *	@return the number of inputs executed again
+		 */
+		int runSampleLibrary(const std::vector<SampleLibrary::Execution>& executions) {
+			std::lock_guard<std::mutex> lock(context->states_mutex);
+			int executed = 0;
+			for (size_t i = 0; (i < executions.size()) && !counterExample(); i++) {
+				const SampleLibrary::Execution& e = executions[i];
+				int len = e.states.size() / Nv;
+				if (context->deterministic_target && e.reusable && (len > 0)) {
+					if ((e.label == POSITIVE) || (e.label == NEGATIVE) || (e.label == QUESTION))
+						gsets[e.label].addStates(reinterpret_cast<State*>(const_cast<double*>(&e.states[0])), len);
+					if (e.label == CNT_EMPL) {
+						IIF_LOG(LOG_LEARN, LOG_INFO) << RED << BOLD << "BUG! The sample library has a Counter-Example trace."
+							<< NORMAL << std::endl;
+						context->counter_example = true;
+					}
+					context->executed_inputs->insert(e.input);
+					context->execution_cache->store(e.input, e.label);
+					continue;
+				}
+				Solution input;
+				for (int j = 0; j < Nv; j++)
+					input[j] = e.input[j];
+				runTarget(input);
+				executed++;
+			}
+			return executed;
+		}
+
 		virtual int save2file(const char*) = 0;
-		/** @brief This function runs the target_program with the given input
+		/** @brief This function runs the target_program with the given input.
+		 *		   The caller should hold the states_mutex of the context, as the execution adds states to gsets.
+		 *		   The states are recorded into the context of the learner, whichever thread runs it.
 		 *
 		 *  @param  input defines input values which are used to call target_program 
+		 *  @param  cl the classifier of the calling learner used by SAMPLE_SIGN_CHANGE in this execution, if any
 		 */
-		int runTarget(Solution& input) {
+		int runTarget(Solution& input, const Classifier* cl = NULL) {
 			assert(func != NULL || "Func equals NULL, ERROR!\n");
-			beforeLoop();
+			ContextBinding bind(context);
 
 			//< convert the given input with double type to the input with int type 
 			int a[Nv];
 			for (int i = 0; i < Nv; i++)
 				a[i] = static_cast<int>(input[i]);
+
+			// a deterministic target gives the same trace on the same input,
+			// and its states have already been added to gsets
+			int cached_label;
+			if (context->deterministic_target && context->execution_cache->lookup(a, cached_label)) {
+				context->cached_samples++;
+				return cached_label;
+			}
+
+			beforeLoop();
+			context->executed_inputs->insert(a);
+			// the learners running in parallel share the context, so it is set for this execution only
+			context->sampling_classifier = cl;
 			//target_program
 			//std::cout << "----> run the loop function.\n";
 			func(a);
 			//std::cout << "\t<---- run the loop function.\n";
+			context->sampling_classifier = NULL;
 
 			int label = afterLoop(gsets);
+			if (context->deterministic_target)
+				context->execution_cache->store(a, label);
+			if (context->sample_library != NULL)
+				context->sample_library->record(a, label, context->program_states, context->state_index);
 			//if (gsets[CNT_EMPL].traces_num() > 0) {
 			if (label == CNT_EMPL) {
-				std::cout << RED << BOLD << " \nBUG! Program encountered a Counter-Example trace." << std::endl;
+				IIF_LOG(LOG_LEARN, LOG_INFO) << RED << BOLD << " \nBUG! Program encountered a Counter-Example trace." << std::endl;
 				//std::cout << "here78.\n";
 				//std::cout.setf(std::ios::fixed);
 				//std::cout << std::setprecision(0) <<gsets[CNT_EMPL] << NORMAL << std::endl;
 				//std::cout.unsetf(std::ios::fixed);
 				//std::cout << "here82.\n";
-				exit(-2);
+				// the learners stop at the end of their sampling, and learn() returns -2
+				context->counter_example = true;
 			}
 			return label;
 		}
 
+		/// whether an execution of the context has violated the postcondition, see runTarget
+		bool counterExample() const {
+			return context->counter_example.load(std::memory_order_relaxed);
+		}
+
 		/** @brief This method is the entrance for the whole learning procedure.
 		 *		   Child class should implement it based on learning algorithm.
+		 *	@return 0 if an invariant is found, -2 on a counter example, see counterExample, -1 otherwise
 		 */
 		virtual int learn() = 0;
 
+		/** @brief let learn() return -1 at the beginning of its next round once flag is set,
+		 *		   used to stop the other learners when one of them succeeds, see iifContext::setPortfolio
+		 */
+		void setCancelFlag(const std::atomic<bool>* flag) {
+			cancel_flag = flag;
+		}
+
+		bool cancelled() const {
+			return (cancel_flag != NULL) && cancel_flag->load(std::memory_order_relaxed);
+		}
+
+		/// tell listener at the beginning of each round, e.g. to save a checkpoint, NULL for nobody
+		void setRoundListener(RoundListener* listener) {
+			round_listener = listener;
+		}
+
+		/** @brief let learn() return -1 at the beginning of its first round after end, see TimeBudget.
+		 *		   The samples of its rounds are reduced to fit before end, see budgetSamples.
+		 */
+		void setTimeSlice(TimeBudget::Clock::time_point end) {
+			slice_end = end;
+		}
+
+		bool outOfTime() const {
+			return (slice_end != TimeBudget::Clock::time_point::max()) && (TimeBudget::Clock::now() >= slice_end);
+		}
+
+		/** @brief reduce the random and the selective samples of this round, if they would not fit into its share
+		 *		   of the time slice, along with the training, see time_budget.h. One of each is always kept.
+		 *	@return false if not even these fit into what is left of the slice, the round should not start
+		 */
+		bool budgetSamples(int& randn, int& exen) {
+			double cost = context->budget.sampleCost();
+			if ((slice_end == TimeBudget::Clock::time_point::max()) || (cost <= 0) || (randn + exen <= 0))
+				return true;
+			double left = std::chrono::duration<double>(slice_end - TimeBudget::Clock::now()).count();
+			if (left < training_seconds + cost * ((randn > 0) + (exen > 0)))
+				return false;
+			// this round and the ones to confirm its classifier
+			int rounds = converged_std - converged_time + 1;
+			double fit = (left / rounds - training_seconds) / cost;
+			if (fit >= randn + exen)
+				return true;
+			double ratio = (fit > 0) ? fit / (randn + exen) : 0;
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "budget: " << randn + exen << " samples reduced to " << static_cast<int>(fit) << "\n";
+			randn = (randn > 0) ? std::max(1, static_cast<int>(randn * ratio)) : 0;
+			exen = (exen > 0) ? std::max(1, static_cast<int>(exen * ratio)) : 0;
+			return true;
+		}
+
+		/** @brief offer the classifier of this round, which separates the training set, as the best candidate so far,
+		 *		   called once its convergence is checked
+		 */
+		void offerCandidate(const Classifier& cl) {
+			context->budget.offer(this, cl.toString(), converged_time);
+		}
+
+		/** @brief write the rounds of learn() into a snapshot, see checkpoint.h.
+		 *		   It is called at the beginning of a round, see beginRound.
+		 */
+		virtual void saveRounds(std::ostream& out) {
+			writeBinary(out, rnd);
+			writeBinary(out, converged_time);
+			writeBinary(out, pre_psize);
+			writeBinary(out, pre_nsize);
+			writeClassifier(out, pre_cl);
+		}
+
+		/** @brief restore the rounds saved by saveRounds, the states sets should have been restored first.
+		 *		   The next learn() then goes on from the round saved.
+		 */
+		virtual bool loadRounds(std::istream& in) {
+			restored = readBinary(in, rnd) && readBinary(in, converged_time)
+				&& readBinary(in, pre_psize) && readBinary(in, pre_nsize) && readClassifier(in, pre_cl);
+			return restored;
+		}
+
 		/** @brief This method is used to generate new input and drive the testing process.
 		 *		   This method is actually does several jobs, depend on parameters. 
 		 *		   It is better to split it into several methods.
@@ -118,47 +263,54 @@ class BaseLearner{
 		 *		   You can find details of each parameters in child class.
 		 */
 		int selectiveSampling(int randn, int exen, Classifier* cl) {
-#ifdef __PRT
-			std::cout << "{" << GREEN;
-#endif
+			PROFILE_SCOPE(PHASE_SAMPLING);
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "{" << GREEN;
+			// the target is run by one learner at a time, it records its states in the context
+			std::lock_guard<std::mutex> lock(context->states_mutex);
 
 #ifndef __SELECTIVE_SAMPLING_ENABLED
-			std::cout << "Pure Random";
+			IIF_LOG(LOG_LEARN, LOG_INFO) << "Pure Random";
 			randn += exen;
 			exen = 0;
 #endif
 			Solution input;
 			int ret = 0;
-			for (int i = 0; i < randn; i++) {
+			int executed = 0;
+			TimeBudget::Clock::time_point begin = TimeBudget::Clock::now();
+			for (int i = 0; (i < randn) && !outOfTime() && !counterExample(); i++) {
+				executed++;
 				Classifier::solver(NULL, input);
-#ifdef __PRT_STATISTICS
-				random_samples++;
-#endif
-				ret = runTarget(input);
-#ifdef __PRT
-				std::cout << input;
-				printRunResult(ret);
-				std::cout << "|";
-#endif
+				context->random_samples++;
+				// SAMPLE_SIGN_CHANGE keeps the states where cl changes its sign
+				ret = runTarget(input, cl);
+				if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << input;
+					printRunResult(ret);
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << "|";
+				}
 			}
-#ifdef __PRT
-			std::cout << BLUE;
-#endif
-			for (int i = 0; i < exen; i++) {
-				Classifier::solver(cl, input);
-#ifdef __PRT_STATISTICS
-				selective_samples++;
-#endif
-				ret = runTarget(input);
-#ifdef __PRT
-				std::cout << "|" << input;
-				printRunResult(ret);
-#endif
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << BLUE;
+			// boundary inputs are generated as a batch, spread over all the conjuncts of cl
+			Solution* inputs = new Solution[exen > 0 ? exen : 1];
+			sampler.sample(cl, inputs, exen);
+			for (int i = 0; (i < exen) && !outOfTime() && !counterExample(); i++) {
+				executed++;
+				context->selective_samples++;
+				ret = runTarget(inputs[i], cl);
+				if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << "|" << inputs[i];
+					printRunResult(ret);
+				}
 			}
+			delete []inputs;
+			double seconds = std::chrono::duration<double>(TimeBudget::Clock::now() - begin).count();
+			sampling_seconds += seconds;
+			context->budget.recordSampling(executed, seconds);
+			// a run stopped by the timeout alarm keeps the executions of its rounds, see iifContext::finish
+			if (context->sample_library != NULL)
+				context->sample_library->flush();
 
-#ifdef __PRT
-			std::cout << NORMAL << "}" << std::endl;
-#endif
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << NORMAL << "}" << std::endl;
 			return randn + exen;
 		}
 
@@ -168,8 +320,10 @@ class BaseLearner{
 		 */
 		virtual std::string invariant(int n) = 0;
 
+		/// the canonical form of the classifier of invariant(n), called after it, see Classifier::canonical
+		virtual std::string canonicalInvariant(int n) = 0;
+
 		void printStatistics() {
-#ifdef __PRT_STATISTICS
 			//std::cout << GREEN << BOLD << "***********************STATISTICS*********************\n";
 			//std::cout << GREEN << BOLD << "|*\t\t   " << RED << "random_samples= " << random_samples << "\n";
 			//std::cout << GREEN << BOLD << "|*\t\t   " << RED << "selective_samples= " << selective_samples << "\n";
@@ -184,13 +338,67 @@ class BaseLearner{
 			strftime(tmbuf, sizeof(tmbuf), "%H:%M:%S", nowtm);
 			snprintf(buf, sizeof(buf), "%s.%06ld", tmbuf, tv.tv_usec);
 			//of1 << buf << "\t\t" << random_samples << "\t\t" << selective_samples << std::endl;
-			of1 << "\t\t#r_samples=" << random_samples << "\t\t#s_samples=" << selective_samples << std::endl;
+			of1 << "\t\t#r_samples=" << context->random_samples << "\t\t#s_samples=" << context->selective_samples
+				<< "\t\t#c_samples=" << context->cached_samples << std::endl;
 			of1.close();
-#endif
 		}
 	protected:
+		/** @brief start the rounds of learn() from the first one, unless they are restored by loadRounds
+		 *	@return true if they are restored
+		 */
+		bool resumeRounds() {
+			if (restored) {
+				restored = false;
+				return true;
+			}
+			round_start = TimeBudget::Clock::time_point();
+			sampling_seconds = 0;
+			training_seconds = 0;
+			rnd = 1;
+			converged_time = 0;
+			pre_cl.clear();
+			pre_psize = 0;
+			pre_nsize = 0;
+			return false;
+		}
+
+		/// called by learn() at the beginning of each round
+		void beginRound() {
+			TimeBudget::Clock::time_point now = TimeBudget::Clock::now();
+			// the rest of the previous round is spent on training and checking
+			if (round_start != TimeBudget::Clock::time_point())
+				training_seconds = std::chrono::duration<double>(now - round_start).count() - sampling_seconds;
+			round_start = now;
+			sampling_seconds = 0;
+			TimeBudget::setThreadDeadline(slice_end);
+			if (round_listener != NULL)
+				round_listener->onRound(this);
+		}
+
 		States* gsets;
+		ContextState* context;
 		int (*func)(int*);
+		BoundarySampler sampler;
+		const std::atomic<bool>* cancel_flag;
+		RoundListener* round_listener;
+
+		/// the end of the time slice of learn(), see setTimeSlice
+		TimeBudget::Clock::time_point slice_end;
+		/// the beginning of the current round, and the seconds spent on its sampling and on training in the previous one
+		TimeBudget::Clock::time_point round_start;
+		double sampling_seconds, training_seconds;
+
+		// the rounds of learn(), kept here so that they can be saved in a checkpoint
+
+		/// the current round, from 1
+		int rnd;
+		/// the number of rounds in a row whose classifier is the same as the previous one
+		int converged_time;
+		/// the classifier of the previous round
+		Classifier pre_cl;
+		/// the numbers of positive and negative states already in the training set
+		int pre_psize, pre_nsize;
+		bool restored;
 };
 
 #endif
@@ -0,0 +1,59 @@
+/** @file checkpoint.h
+ *  @brief Binary snapshots of the learning state, so that a run stopped by its timeout, or preempted, can resume.
+ *
+ *  A snapshot is written by iifContext at the beginning of a round of its learners, see iifContext::setCheckpoint.
+ *  It holds all that the next rounds depend on:
+ *		the state of rand(), the scope and the sampling counters of the context,
+ *		the inputs executed, the states sets, the learner running and its rounds (see BaseLearner::saveRounds),
+ *		including the previous classifier and the order of its SVM training set.
+ *  So a run resumed from a snapshot goes on as the run which wrote it would have.
+ *
+ *  The values are written in the byte order and the sizes of the machine, a snapshot is not portable.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <iostream>
+#include <string>
+
+class Classifier;
+class BaseLearner;
+
+template <typename T>
+inline void writeBinary(std::ostream& out, const T& value) {
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool readBinary(std::istream& in, T& value) {
+	return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void writeString(std::ostream& out, const std::string& s);
+bool readString(std::istream& in, std::string& s);
+
+void writeClassifier(std::ostream& out, const Classifier& cl);
+bool readClassifier(std::istream& in, Classifier& cl);
+
+/** @brief seed rand(), as srand does, but keeping its state where writeRandomState can read it.
+ *		   The state is of the process, the contexts learning at the same time share it, see context_state.h.
+ */
+void seedRandom(unsigned int seed);
+
+/// the state of rand(), only if it is seeded by seedRandom
+void writeRandomState(std::ostream& out);
+bool readRandomState(std::istream& in);
+
+/** \class RoundListener
+ *  @brief Told by a learner at the beginning of each of its rounds, see BaseLearner::beginRound.
+ */
+class RoundListener {
+	public:
+		virtual ~RoundListener() {}
+		virtual void onRound(BaseLearner* learner) = 0;
+};
+
+#endif
@@ -55,6 +55,13 @@ class Classifier{
 
 		std::string toString() const;
 
+		/** @brief A canonical form of the classifier, the same for the classifiers differing in the order of
+		 *		   their conjuncts, their duplicates or the scaling of their polynomials, see Polynomial::canonical.
+		 *		   A conjunction is written as its sorted conjuncts, "1 2 && 3 -1", a classifier with disjuncts
+		 *		   keeps its order. verify.sh memoizes the verification of the candidates by this form.
+		 */
+		std::string canonical() const;
+
 		friend std::ostream& operator << (std::ostream& out, const Classifier& cs);
 };
 
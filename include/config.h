@@ -65,15 +65,10 @@
 #define PRECISION 2
 //#define PRECISION 3
 
-/** @brief The pointer to test program, DO NOT assign directly
- *		   Call register_program to set its value
- */
-extern int (*target_program) (int*);
-
 /** @brief defines the initial max number items contains by states set. 
  *		   Better to be a number larger than 1000 
  */
-const int Mitems = 10000000;
+const int Mitems = 65536;
 
 /** @brief defines max number of states contains in one executionn. 
  *		   Better to be a number larger than 128 
@@ -108,7 +103,13 @@ const int restricted_trainset_size = 2000*Nv;
 //		  the learnt classifier is regarded as candidate invariant
 const int converged_std = 1;
 
-/** @brief This function register the test program to the framework.
+/** @brief defines the max number of misclassified negative states SVM_I adds to one training step.
+ *		   Nearby negatives are usually cut off by the same conjunct, so they are tried together.
+ *		   Should be a positive integer. 1 means adding one negative state each step.
+ */
+const int Mviolators_per_step = 8;
+
+/** @brief This function register the test program to the current context, see context_state.h
  *
  *	@param func The function to be tested
  *		   It involves a small validation test on the given function.
@@ -118,42 +119,18 @@ const int converged_std = 1;
 // legacy function, can be removed after all the test modification
 bool register_program(int (*func)(int*), const char* func_name = 0);
 
+/** @brief the seed for rand(), which is the value of environment variable IIF_SEED if it is set,
+ *		   so that a run can be repeated, otherwise the current time.
+ */
+unsigned int randomSeed();
+
+/** @brief create the folder and its missing parents, as mkdir -p does
+ *	@return false if the folder can not be created
+ */
+bool makeFolders(const char* path);
+
 /** @brief defines the timeout signal handler 
 */
 // legacy function, can be removed after all the test modification
 //void sig_alrm(int signo);
-extern std::string* variables;
-class VariablePowerArray{
-	private:
-		int _vtimes[Nv];
-	public:
-		int& operator[] (int i) {
-			assert((i>=0) && (i<Nv));
-			return _vtimes[i];
-		}
-
-		friend std::ostream& operator << (std::ostream& out, VariablePowerArray& vpa) {
-			out << "[" << vpa[0];
-			for (int i = 1; i < Nv; i++) {
-				out << "," << vpa[i];
-			}
-			out <<"]";
-			return out;
-		}
-
-		std::string toString() {
-			std::ostringstream stm;
-			stm << "1";
-			for (int i = 0; i < Nv; i++) {
-				if (_vtimes[i] == 0)
-					continue;
-				for (int j = 0; j < _vtimes[i]; j++) {
-					stm << "*" << variables[i + 1]; 
-				}
-			}
-			return stm.str();
-		}
-};
-
-extern VariablePowerArray* vparray;
 #endif
@@ -7,7 +7,7 @@
 
 class ConjunctiveLearner: public BaseLearner {
 	public:
-		ConjunctiveLearner(States* gsets, /*const char* solution_filename = NULL,*/ int (*func)(int*) = target_program, int max_iteration = Miter);
+		ConjunctiveLearner(States* gsets, /*const char* solution_filename = NULL,*/ int (*func)(int*) = NULL, int max_iteration = Miter);
 
 		~ConjunctiveLearner();
 
@@ -16,6 +16,10 @@ class ConjunctiveLearner: public BaseLearner {
 		virtual int learn();
 
 		virtual std::string invariant(int n);
+		virtual std::string canonicalInvariant(int n);
+
+		/// the rounds, and the training set of SVM-I rebuilt from them
+		virtual bool loadRounds(std::istream& in);
 
 	protected:
 		SVM_I* svm_i;
@@ -0,0 +1,131 @@
+/** @file context_state.h
+ *  @brief All the state of one inference context, which used to be process globals.
+ *
+ *  Each iifContext owns a ContextState: the program under test and its variables,
+ *  the scope of random inputs, the sampling counters, the inputs executed,
+ *  and the recording of the current execution.
+ *
+ *  The target program records its states by iif_record, iif_assume and iif_assert,
+ *  which are bound to the context through the thread local pointer current_context.
+ *  A context is made current on a thread by its constructor, and by ContextBinding
+ *  in each of its methods, e.g. iifContext::learn. So several contexts can coexist
+ *  in one process, and learn on different threads.
+ *
+ *  Some state is still of the process, and shared by the contexts learning at the same time:
+ *  the rand() sequence the inputs are drawn from (see seedRandom), the timeout alarm,
+ *  and the profiler files (see Profiler::open). The alarm goes off at the latest deadline of them,
+ *  and the profile holds all of them. A fixed IIF_SEED reproduces a run, and a snapshot resumes
+ *  its rand() sequence, only when one context learns at a time.
+ *
+ *  Code run outside of any context, e.g. the microbenchmarks, uses a default context.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _CONTEXT_STATE_H_
+#define _CONTEXT_STATE_H_
+
+#include "config.h"
+#include "time_budget.h"
+#include <string>
+#include <atomic>
+#include <mutex>
+
+class InputSet;
+class ExecutionCache;
+class SampleLibrary;
+class Classifier;
+class LoopProgram;
+
+class ContextState {
+	public:
+		ContextState();
+		~ContextState();
+
+		/// the program under test, see register_program
+		int (*target_program)(int*);
+		/// the interpreted loop, when target_program is runLoopProgram, see loop_program.h
+		const LoopProgram* loop_program;
+		/// names of the monomials, indexed as in monomial.h, variables[0] is "1"
+		std::string* variables;
+		int vnum;
+
+		/// the scope [minv, maxv] of random inputs, enlarged while learning
+		std::atomic<int> minv, maxv;
+		std::atomic<int> random_samples, selective_samples, cached_samples;
+
+		/// all the inputs the target has been executed on, maintained by BaseLearner::runTarget
+		InputSet* executed_inputs;
+		/// labels of the executed inputs, only used when deterministic_target is set
+		ExecutionCache* execution_cache;
+		bool deterministic_target;
+		/// the executions of the loop observed by all the runs, NULL if not kept, see iifContext::setSampleLibrary
+		SampleLibrary* sample_library;
+
+		/** @brief guards the states sets of the context when learners run in parallel, see iifContext::setPortfolio.
+		 *		   Executing the target and adding its states, mapping states and reading the values of states
+		 *		   are done holding it. The size, the number of traces and the mapped states can be read without it.
+		 */
+		std::mutex states_mutex;
+
+		/// the wall-clock budget of the current learn(), and the best candidate found in it
+		TimeBudget budget;
+		/// set by BaseLearner::runTarget once an execution violates the postcondition, learn() then returns -2
+		std::atomic<bool> counter_example;
+
+		// recording of the current execution, see instrumentation.h and iif_assert.h
+
+		/// whether the input has passed the loop precondition and postcondition
+		bool passP, passQ;
+		/// calls to iif_assume and iif_assert, each should be called exactly once
+		int assume_times, assert_times;
+
+		/// states of the current execution, they are moved to the states sets by afterLoop
+		double program_states[MstatesIn1trace * 2][Nv];
+		int state_index;
+		/// states before this index are always kept, and they are recorded inline by iif_record
+		int record_fast_limit;
+
+		int sampling_policy;
+		int sampling_k;
+		/// the classifier used by SAMPLE_SIGN_CHANGE, that of the learner running the current execution,
+		/// set by BaseLearner::runTarget
+		const Classifier* sampling_classifier;
+
+		// book keeping of the sampling policy, reset by beforeLoop
+		int trace_length;
+		int stride;
+		int state_seq[MstatesIn1trace * 2];
+		double last_state[Nv];
+		bool last_kept;
+		int last_sign;
+		double reorder_buffer[MstatesIn1trace * 2][Nv];
+
+	private:
+		ContextState(const ContextState&);
+		ContextState& operator= (const ContextState&);
+};
+
+/// the context of the calling thread, never NULL
+extern thread_local ContextState* current_context;
+
+/// the context used by a thread before any other is made current
+ContextState* defaultContext();
+
+/** \class ContextBinding
+ *  @brief Makes a context current on the calling thread during its lifetime.
+ */
+class ContextBinding {
+	public:
+		explicit ContextBinding(ContextState* state) : previous(current_context) {
+			current_context = state;
+		}
+		~ContextBinding() {
+			current_context = previous;
+		}
+
+	private:
+		ContextState* previous;
+};
+
+#endif
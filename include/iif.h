@@ -20,6 +20,7 @@
 #include "connector.h"
 #include "classifier.h"
 #include "states.h"
+#include "memtrack.h"
 #include "base_learner.h"
 #include "linear_learner.h"
 #include "poly_learner.h"
@@ -27,6 +28,11 @@
 #include "conjunctive_learner.h"
 //#include "disjunctive_learner.h"
 #include "iif_assert.h"
+#include "context_state.h"
+#include "loop_program.h"
+#include "loop_jit.h"
+#include "checkpoint.h"
+#include "sample_library.h"
 
 #include <iostream>
 #include <float.h>
@@ -37,18 +43,15 @@
 
 #include <cstdlib>
 #include <signal.h>
-#ifdef linux
+#include <thread>
+#include <mutex>
+#include <atomic>
+#ifdef __linux__
 #include <sys/time.h>
 #include <unistd.h>
 #endif
 
 
-extern int minv, maxv;
-extern std::string* variables;
-extern int vnum;
-extern VariablePowerArray* vparray;
-
-
 namespace iif{
 	class LearnerNode {
 		public:
@@ -58,12 +61,10 @@ namespace iif{
 			LearnerNode* next;
 	};
 
-	class iifContext {
+	class iifContext : public RoundListener {
 		private:
-			static void sig_alrm(int signo) {
-				std::cout << "\nTIMEOUT!\n";
-				exit(-1);
-			}
+			// the budget is cooperative, the alarm only stops a round which never returns to it, see learn()
+			static void sig_alrm(int signo);
 
 		public:
 			iifContext (States* ss);
@@ -71,17 +72,131 @@ namespace iif{
 			iifContext (const char* vfilename, int (*func)(int*), const char* func_name = "Unknown", 
 					const char* pasttestcase = NULL, int timeout = 3600);
 
+			/** @brief learn the loop of a cfg by interpreting it, instead of a compiled loop function, see loop_program.h
+			 *		   The program should live as long as the context. Its learners are added by LoopProgram::setup.
+			 */
+			iifContext (const LoopProgram& program, const char* pasttestcase = NULL, int timeout = 3600);
+
 			~iifContext();
 
 			iifContext& addLearner(const char* learnerName);
 
+			/** @brief set how states are sampled when an execution is too long, see sampling_policy
+			 *	@param policyName "legacy", "reservoir", "stride", "firstlast" or "signchange"
+			 *	@param k the number of states kept in one execution
+			 */
+			iifContext& setTraceSampling(const char* policyName, int k = MstatesIn1trace);
+
+			/** @brief declare whether the target always produces the same trace on the same input.
+			 *		   If so, an input already executed is not executed again, its label is reused.
+			 */
+			iifContext& setDeterministic(bool deterministic = true);
+
+			/** @brief set the levels of log messages, see logger.h
+			 *	@param spec e.g. "debug" or "info,query=debug", NULL keeps the current levels
+			 */
+			iifContext& setLogLevel(const char* spec);
+
+			/** @brief set a soft budget of the memory held by the engine, see memtrack.h.
+			 *		   It is also read from the environment variable IIF_MEM_BUDGET.
+			 *	@param megabytes 0 for no budget
+			 */
+			iifContext& setMemoryBudget(int megabytes);
+
+			/** @brief run all the learners in parallel on the shared states sets, instead of one after another.
+			 *		   The first learner which finds a candidate wins, the others stop at the beginning of their next round.
+			 *		   It is also set by the environment variable IIF_PORTFOLIO=1.
+			 */
+			iifContext& setPortfolio(bool portfolio = true);
+
+			/** @brief run the loop of a LoopProgram as native code compiled in-process, instead of interpreting it, see loop_jit.h.
+			 *		   If it can not be compiled, the loop is still interpreted.
+			 *		   It is also set by the environment variable IIF_JIT=1.
+			 */
+			iifContext& setJit(bool jit = true);
+
+			/** @brief set the wall-clock budget of learn(), the timeout of the constructor by default, see time_budget.h.
+			 *		   The learners share it, and once it runs out learn() writes the best candidate found so far,
+			 *		   if any, as if a learner had succeeded.
+			 *		   It is also set by the environment variable IIF_TIME_BUDGET=seconds.
+			 *	@param seconds 0 for no budget
+			 */
+			iifContext& setTimeBudget(int seconds);
+
+			/** @brief keep all the executions of the loop, of all the runs, in a library in folder, see sample_library.h.
+			 *		   learn() starts from the executions of the library, and adds its own ones to it.
+			 *		   The library is only kept once the key of the loop is set, see setLoopKey.
+			 *		   It is also set by the environment variable IIF_SAMPLE_LIB=folder, where 1 stands for ../tmp/lib.
+			 *	@param folder NULL for no library
+			 */
+			iifContext& setSampleLibrary(const char* folder);
+
+			/// set the key of the loop in its sample library, set by the programs of cfg2test and by LoopProgram::setup
+			iifContext& setLoopKey(const char* key);
+
+			/** @brief save a snapshot of the learning state into filename at the beginning of the rounds of the learners,
+			 *		   at most once every interval seconds, and resume from it in learn() if it exists, see checkpoint.h.
+			 *		   The snapshot is removed once learn() finishes. It is not written in the portfolio mode.
+			 *		   It is also set by the environment variables IIF_CHECKPOINT=filename, where 1 stands for
+			 *		   <invfilename>.ckpt of learn(), and IIF_CHECKPOINT_INTERVAL=seconds.
+			 *	@param filename NULL for no snapshot
+			 */
+			iifContext& setCheckpoint(const char* filename, int interval = 60);
+
+			/// write a snapshot of the learning state now, return false if it can not be written
+			bool saveCheckpoint(const char* filename);
+
+			/** @brief restore the learning state from a snapshot, the next learn() goes on from it.
+			 *		   A broken snapshot is removed, and the learning state is left as it was.
+			 *	@return false if there is no snapshot, it is not of the loop and the learners of this context,
+			 *			or it is broken
+			 */
+			bool loadCheckpoint(const char* filename);
+
+			/// save a snapshot if it is time to, called by the learners
+			virtual void onRound(BaseLearner* learner);
+
+			/** @brief run the learners on the loop, the result is written to <invfilename>.inv
+			 *	@return 0 if an invariant is found, -2 if an execution violates the postcondition, -1 otherwise
+			 */
 			int learn(const char* solution_filename = NULL, const char* invfilename = "noname", int times = 1);
 
 		private:
+			/// set up the variables and the states sets of a new context, and make it current
+			void init(const std::string* names, const char* dataset_fname);
+
+			/// add the executions of the sample library to the states sets, through learner
+			void loadSampleLibrary(BaseLearner* learner, bool replay);
+
+			/// run all the learners in parallel, return the node of the first one succeeded, NULL if all failed
+			LearnerNode* learnPortfolio();
+
+			/** @brief save the result of the learner succeeded, and end the run.
+			 *		   If p is NULL, the best candidate is saved if the budget has run out, nothing otherwise.
+			 */
+			int finish(LearnerNode* p, const char* invfilename);
+
+			/// the state of this context, made current on the calling thread by each method
+			ContextState* state;
 			States* gsets;
 			LearnerNode* first;
 			LearnerNode* last; 
 			int timeout;
+			bool portfolio;
+			/// whether learn() has opened the profiler, finish() then closes it
+			bool profiled;
+
+			/// the snapshot file as set, and as resolved by learn()
+			std::string checkpoint_file;
+			std::string checkpoint_path;
+			int checkpoint_interval;
+			time_t checkpoint_saved;
+			/// the folder of the sample library, and the key of the loop in it
+			std::string sample_folder;
+			std::string loop_key;
+			/// the learner running in learn(), and the one to go on with after loadCheckpoint
+			LearnerNode* running;
+			LearnerNode* resumed;
 	};
 }
 #endif
@@ -11,13 +11,9 @@
 #ifndef _IIF_ASSERT_H_
 #define _IIF_ASSERT_H_
 
-/// a flag to justify whether the given input has pass loop precondition
-extern bool _passP;
-/// a flag to justify whether the given input has pass loop postcondition
-extern bool _passQ;
+#include "context_state.h"
 
-/// integers values contain the call times to iif_assume and iif_assert, used to validate a given test
-extern int assume_times, assert_times;
+// the flags and the call times are kept by the current context, see ContextState::passP
 
 /** @brief Used to envelope loop precondition
  *
@@ -26,8 +22,8 @@ extern int assume_times, assert_times;
  *  @param expr: loop precondition
  */
 #define iif_assume(expr) do { \
-	_passP = (expr)? true : false;\
-	assume_times++;\
+	current_context->passP = (expr)? true : false;\
+	current_context->assume_times++;\
 } while(0)
 
 /** @brief Used to envelope loop precondition
@@ -37,8 +33,8 @@ extern int assume_times, assert_times;
  *  @param expr: loop postcondition
  */
 #define iif_assert(expr) do { \
-	_passQ = (expr)? true : false;\
-	assert_times++;\
+	current_context->passQ = (expr)? true : false;\
+	current_context->assert_times++;\
 } while(0)
 
 #endif
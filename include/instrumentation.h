@@ -8,6 +8,7 @@
 #define _INSTRUMENTATION_H_
 #include "config.h"
 #include "states.h"
+#include "context_state.h"
 #include <stdarg.h>
 
 /** \enum trace_type
@@ -19,6 +20,63 @@
 //enum {NEGATIVE = -1, QUESTION, POSITIVE, CNT_EMPL};	/* trace_type */
 enum {NEGATIVE = 0, POSITIVE, QUESTION, CNT_EMPL};	/* trace_type */
 
+/** \enum sampling_policy
+ * @brief How states are kept when one execution records more states than it can keep.
+ *
+ * SAMPLE_LEGACY:      keep all the first states, then drop more and more of them, until 0.999 * MstatesIn1trace
+ * SAMPLE_RESERVOIR:   keep an uniform random sample of k states, in their original order
+ * SAMPLE_STRIDE:      keep every stride-th state, the stride doubles each time k states are kept
+ * SAMPLE_FIRST_LAST:  keep the first k and the last k states
+ * SAMPLE_SIGN_CHANGE: keep the first state, and the states where the current classifier changes its sign
+ *
+ * Except SAMPLE_LEGACY, the last state of an execution is always kept.
+ */
+enum {SAMPLE_LEGACY = 0, SAMPLE_RESERVOIR, SAMPLE_STRIDE, SAMPLE_FIRST_LAST, SAMPLE_SIGN_CHANGE};	/* sampling_policy */
+
+class Classifier;
+
+/** @brief set the sampling policy for all the following executions in the current context
+ *
+ *	@param policy one of sampling_policy
+ *	@param k the number of states to keep, clamped into [2, MstatesIn1trace]
+ *		   For SAMPLE_FIRST_LAST, k states are kept at each end.
+ *	@return false if the policy is unknown
+ */
+bool setTraceSampling(int policy, int k = MstatesIn1trace);
+
+/*  The states of the current execution are recorded into ContextState::program_states of the current context.
+ *  States before ContextState::record_fast_limit are always kept, and they are recorded inline by iif_record.
+ *  Later states go through addState, which decides whether to keep them by the sampling policy.
+ *  The limit is reset by beforeLoop.
+ *  SAMPLE_SIGN_CHANGE uses ContextState::sampling_classifier, which is set for each execution by the learner
+ *  running it, all states are kept as changes if there is none.
+ */
+
+/** @brief record one state of Nv values into program_states, may drop it by the sampling policy
+ */
+int addState(const double* state);
+
+/** @brief record the current state in loop.
+ *
+ *	The number of arguments is checked against Nv at compile time,
+ *	and the state is written directly into program_states.
+ *	e.g. iif_record(x, y); in a loop with Nv = 2
+ */
+template <typename... T>
+inline int iif_record(T... values) {
+	static_assert(sizeof...(T) == Nv, "iif_record should be given exactly Nv values");
+	const double state[] = { static_cast<double>(values)... };
+	ContextState* c = current_context;
+	if (c->state_index < c->record_fast_limit) {
+		double* dst = c->program_states[c->state_index++];
+		for (int i = 0; i < Nv; i++)
+			dst[i] = state[i];
+		return 0;
+	}
+	return addState(state);
+}
+
+// legacy record functions, use iif_record instead
 int addStateInt(int first, ...);
 int addStateDouble(double first, ...);
 
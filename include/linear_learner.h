@@ -7,7 +7,7 @@
 
 class LinearLearner: public BaseLearner {
 	public:
-		LinearLearner(States* gsets, /*const char* solution_filename = NULL,*/ int (*func)(int*) = target_program, int max_iteration = Miter);
+		LinearLearner(States* gsets, /*const char* solution_filename = NULL,*/ int (*func)(int*) = NULL, int max_iteration = Miter);
 
 		~LinearLearner();
 
@@ -16,6 +16,11 @@ class LinearLearner: public BaseLearner {
 		virtual int learn();
 
 		virtual std::string invariant(int n);
+		virtual std::string canonicalInvariant(int n);
+
+		/// the rounds and the training set of the SVM
+		virtual void saveRounds(std::ostream& out);
+		virtual bool loadRounds(std::istream& in);
 
 	protected:
 		SVM* svm;
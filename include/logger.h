@@ -0,0 +1,98 @@
+/** @file logger.h
+ *  @brief Runtime leveled logging, which replaces the __PRT* compile flags.
+ *
+ *  Each message belongs to a topic and has a level. A topic prints the messages
+ *  whose level is not above the level set for it, LOG_INFO by default.
+ *  Levels are set by iifContext::setLogLevel, or by the environment variable IIF_LOG, e.g.
+ *		IIF_LOG=debug					all the topics at debug level
+ *		IIF_LOG=info,query=debug,svm_i=trace
+ *
+ *  Usage: IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "new training set: " << problem.l << "\n";
+ *  When the level is disabled, the statement costs a comparison, the operands are not evaluated.
+ *  Otherwise the message is formatted by the caller and written by a background thread,
+ *  in the order of the calls. Messages are written as they are, no prefix or newline is added.
+ *  LOG_ERROR messages go to stderr, the others to stdout.
+ *  Each thread keeps the text it logs to stdout until a newline, and queues the whole line,
+ *  so that the lines of learners running in parallel do not interleave.
+ *  A message built by a loop is collected by one LogRecord, e.g. see the checkQuestionTraces of SVM.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <sstream>
+#include <string>
+
+enum LogLevel { LOG_ERROR = 0, LOG_WARN, LOG_INFO, LOG_DEBUG, LOG_TRACE };
+
+enum LogTopic {
+	LOG_LEARN = 0,	// learning rounds of all the learners
+	LOG_SAMPLE,		// test cases and their results
+	LOG_STATES,		// program states of each execution
+	LOG_SVM,		// linear and polynomial svm
+	LOG_SVM_I,		// svm-i of the conjunctive learner
+	LOG_POLY,		// polynomial operations, e.g. factor and roundoff
+	LOG_SOLVE,		// gsl and z3 solving of polynomials
+	LOG_QUERY,		// z3 implication queries
+	LOG_INFER,		// classifier simplification
+	LOG_TOPIC_NUM
+};
+
+class Logger {
+	public:
+		static inline bool enabled(int topic, int level) {
+			return level <= levels[topic];
+		}
+
+		static void setLevel(int level);
+		static void setLevel(int topic, int level);
+
+		/** @brief set levels by a spec like "info,query=debug"
+		 *  @return false if some part of spec is not recognized, the other parts still take effect
+		 */
+		static bool configure(const char* spec);
+
+		/** @brief queue the message to be written by the background thread,
+		 *		   a message to stdout is kept by the calling thread until its line ends
+		 */
+		static void push(int level, const std::string& text);
+
+		/** @brief block until all the messages queued so far, and the unfinished line
+		 *		   of the calling thread, have been written
+		 */
+		static void flush();
+
+	private:
+		static int levels[LOG_TOPIC_NUM];
+};
+
+/** \class LogRecord
+ *  @brief Collects one message, which is queued when the record is destroyed.
+ */
+class LogRecord {
+	public:
+		explicit LogRecord(int level) : level(level) {}
+		~LogRecord() { Logger::push(level, out.str()); }
+		std::ostream& stream() { return out; }
+
+	private:
+		int level;
+		std::ostringstream out;
+};
+
+/** \class LogVoidify
+ *  @brief Turns the stream expression into void, so that IIF_LOG is a single expression
+ *		   and can be the body of an if statement without braces.
+ *		   operator& binds looser than << and tighter than ?:.
+ */
+class LogVoidify {
+	public:
+		void operator&(std::ostream&) {}
+};
+
+#define IIF_LOG(topic, level) \
+	!Logger::enabled(topic, level) ? (void)0 : LogVoidify() & LogRecord(level).stream()
+
+#endif
@@ -0,0 +1,34 @@
+/** @file loop_jit.h
+ *  @brief Compile the bytecode of a loop into native code in-process, for the loops too long to be interpreted.
+ *
+ *  The bytecode of a LoopProgram is written as a C function (see LoopProgram::toC), compiled into a shared object
+ *  by the local C compiler, and loaded by dlopen. The function is then a loop function as any other,
+ *  it can be given to register_program, see iifContext::setJit.
+ *
+ *  The objects are kept under a hash of their source and of the compiler command (see loop_key.h),
+ *  with the source next to them, so a loop compiled once, by this process or by another one,
+ *  is only loaded the next times. The folder is created with its parents if it does not exist.
+ *  The generated C does not include any header of the engine, so the objects do not depend on its build.
+ *
+ *  Environment variables:
+ *		IIF_JIT_CC		the compiler command, "cc -O2" by default
+ *		IIF_JIT_DIR		the folder of the objects, "../tmp/jit" by default
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _LOOP_JIT_H_
+#define _LOOP_JIT_H_
+
+#include "loop_program.h"
+#include <string>
+
+typedef int (*LoopFunction)(int*);
+
+/** @brief compile the loop of program into native code and load it
+ *	@param message why it failed
+ *	@return the loop function, which behaves as LoopProgram::run, NULL if the loop can not be compiled
+ */
+LoopFunction compileLoopProgram(const LoopProgram& program, std::string& message);
+
+#endif
@@ -0,0 +1,61 @@
+/** @file loop_key.h
+ *  @brief The key of a loop in its sample library, see sample_library.h, and the hash it is made of.
+ *
+ *  It is shared by the engine and tools/src/cfg2test.cpp, which puts the key into the programs it generates,
+ *  so it only depends on the standard library. The hash is FNV-1a, which is the same in every build,
+ *  unlike std::hash, so that it can name the files kept across runs, e.g. the loops compiled by loop_jit.h.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _LOOP_KEY_H_
+#define _LOOP_KEY_H_
+
+#include <string>
+#include <cctype>
+#include <cstdio>
+
+/// continue the FNV-1a hash h with text
+inline unsigned long long fnv1a(const std::string& text, unsigned long long h = 14695981039346656037ULL) {
+	for (size_t i = 0; i < text.size(); i++) {
+		h ^= static_cast<unsigned char>(text[i]);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/// the hash as 16 hex digits, e.g. to name a file
+inline std::string hashName(unsigned long long h) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", h);
+	return name;
+}
+
+/** @brief the key of a loop in its library, a hash of the sections of its cfg which define its executions:
+ *		   names, beforeloop, beforeloopinit, symbolic, precondition, loopcondition, loop, postcondition, afterloop.
+ *		   The blanks in each section are collapsed, so the layout of the cfg does not change the key.
+ *	@param sections the values of these keys of the cfg, in this order
+ */
+inline std::string loopKey(const std::string* sections, int num) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < num; i++) {
+		// blanks are collapsed into one space, and dropped at both ends
+		std::string text;
+		bool blank = false;
+		for (size_t j = 0; j < sections[i].size(); j++) {
+			if (isspace(static_cast<unsigned char>(sections[i][j]))) {
+				blank = true;
+				continue;
+			}
+			if (blank && !text.empty())
+				text += ' ';
+			blank = false;
+			text += sections[i][j];
+		}
+		text += '\n';
+		h = fnv1a(text, h);
+	}
+	return hashName(h);
+}
+
+#endif
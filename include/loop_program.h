@@ -0,0 +1,122 @@
+/** @file loop_program.h
+ *  @brief An interpreter of the loops given in cfg files, so that they can be learnt without being compiled.
+ *
+ *  The fields of a cfg (beforeloop, beforeloopinit, symbolic, precondition, loopcondition, loop, postcondition)
+ *  are put together in the same way as cfg2test does, into a loop function of the names of the cfg.
+ *  The function is compiled once into a register bytecode, and LoopProgram::run executes it,
+ *  recording the states and the results of iif_assume and iif_assert into the current context.
+ *  So it behaves as the loopFunction generated by cfg2test, and can be given to register_program
+ *  by runLoopProgram, see iifContext::iifContext(const LoopProgram&).
+ *
+ *  The statements supported are the C subset on int used by the cfgs:
+ *		{ }, if, else, while, do while, for, break, continue, return, int declarations,
+ *		=, +=, -=, *=, /=, %=, ++ and -- as statements,
+ *		and the expressions of + - * / % unary - ! < <= > >= == != && || parentheses, integers and rand().
+ *  Integers wrap around on overflow, and x / 0 and x % 0 give 0, as a loop should not depend on them.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _LOOP_PROGRAM_H_
+#define _LOOP_PROGRAM_H_
+
+#include "config.h"
+#include <string>
+#include <vector>
+
+namespace iif {
+	class iifContext;
+}
+
+class LoopProgram {
+	public:
+		/// registers are indexed by short, the names of the cfg are the first Nv of them
+		static const int max_registers = 256;
+
+		/** \enum opcode
+		 *	@brief The instructions have the form op a, b, c where a and b are registers,
+		 *		   c is a register, an immediate value or the target of a jump.
+		 *
+		 *	OP_MOVE:	a = b
+		 *	OP_ADD..:	a = b op c						OP_ADDI:	a = b + immediate c
+		 *	OP_NEG:		a = -b							OP_NOT:		a = !b
+		 *	OP_LT..:	a = (b op c)
+		 *	OP_JUMP:	goto c							OP_JZ, OP_JNZ:	if a is zero (not zero) goto c
+		 *	OP_JLT..:	if (a op b) goto c, the comparison of a loop condition in one instruction
+		 *	OP_RAND:	a = rand()
+		 *	OP_RECORD:	record the state of the names	OP_ASSUME, OP_ASSERT:	iif_assume(a), iif_assert(a)
+		 *	OP_END:		the end of the loop function
+		 */
+		enum {
+			OP_MOVE, OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_ADDI, OP_NEG, OP_NOT,
+			OP_LT, OP_LE, OP_GT, OP_GE, OP_EQ, OP_NE,
+			OP_JUMP, OP_JZ, OP_JNZ,
+			OP_JLT, OP_JLE, OP_JGT, OP_JGE, OP_JEQ, OP_JNE,
+			OP_RAND, OP_RECORD, OP_ASSUME, OP_ASSERT, OP_END
+		};	/* opcode */
+
+		struct Instr {
+			short op;
+			short a;
+			short b;
+			int c;
+		};
+
+		LoopProgram();
+
+		/** @brief read a cfg file and compile its loop, the keys are the same as cfg2test
+		 *	@return false if the file can not be read, or the loop is not supported, see error()
+		 */
+		bool parseFile(const char* cfgfilename);
+
+		/// the same as parseFile, on the content of a cfg
+		bool parse(const std::string& cfg);
+
+		/// why the last parse failed
+		const std::string& error() const { return message; }
+
+		const std::vector<std::string>& getNames() const { return names; }
+
+		/// the key of the loop in its sample library, see loopKey
+		const std::string& getKey() const { return key; }
+
+		/// write the names as cfg2test does, e.g. for ./verify.sh
+		bool writeVarFile(const char* varfilename) const;
+
+		/// add the learners of the cfg to context, and set its sampling policy and determinism, as cfg2test does
+		void setup(iif::iifContext& context) const;
+
+		/// run the loop on input, recording into the current context, return 0 as the loop function
+		int run(const int* input) const;
+
+		/// a listing of the bytecode, one instruction per line
+		std::string disassemble() const;
+
+		/** @brief the same loop as a self-contained C function int function(int* input), see loop_jit.h
+		 *		   It records and checks the states by the hooks iif_jit_record, iif_jit_assume and iif_jit_assert.
+		 */
+		std::string toC(const std::string& function) const;
+
+	private:
+		friend class LoopCompiler;
+
+		std::vector<std::string> names;
+		std::vector<std::string> learners;
+		std::string key;
+		std::string sampling;
+		bool deterministic;
+
+		std::vector<Instr> code;
+		/// registers [constant_base, constant_base + constants.size()) hold the constants, set before each run
+		std::vector<int> constants;
+		int constant_base;
+		int register_num;
+		std::string message;
+};
+
+/** @brief the loop function of the program in the current context, see ContextState::loop_program
+ *		   This is the func registered for an interpreted loop.
+ */
+int runLoopProgram(int* input);
+
+#endif
@@ -0,0 +1,82 @@
+/** @file memtrack.h
+ *  @brief Counts the bytes held by each subsystem of the engine, under an optional budget.
+ *
+ *  Each subsystem adds the bytes it allocates and subtracts the bytes it frees,
+ *  the tracker keeps the current and the peak bytes of each subsystem and of them all.
+ *  The figures are written to the profile by Profiler::close, and logged at the end of learning.
+ *
+ *  With a budget, set by iifContext::setMemoryBudget or the environment variable IIF_MEM_BUDGET (in MB),
+ *  a subsystem asks MemoryTracker::reserve before it grows. If the growth does not fit,
+ *  the registered compactors release what they can, e.g. the execution cache,
+ *  and when it still does not fit, the subsystem degrades instead of failing:
+ *  States and the training sets grow to the exact size needed instead of doubling,
+ *  the trace hashes of a States are dropped, and the svm kernel cache is shrunk to what is left.
+ *  The budget is soft, the engine never refuses an allocation it needs to go on.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _MEMTRACK_H_
+#define _MEMTRACK_H_
+
+#include <atomic>
+#include <string>
+
+enum { MEM_STATES = 0, MEM_MAPPED, MEM_TRAINSET, MEM_SVM_CACHE, MEM_CLASSIFIER, MEM_SAMPLER, MEM_NUM };
+
+class MemoryTracker {
+	public:
+		static inline void add(int subsystem, long long bytes) {
+			raise(peak[subsystem], current[subsystem] += bytes);
+			raise(total_peak, total += bytes);
+		}
+
+		static inline void sub(int subsystem, long long bytes) {
+			current[subsystem] -= bytes;
+			total -= bytes;
+		}
+
+		static long long getCurrent(int subsystem) { return current[subsystem]; }
+		static long long getPeak(int subsystem) { return peak[subsystem]; }
+		static long long getTotal() { return total; }
+		static long long getTotalPeak() { return total_peak; }
+		static const char* getName(int subsystem) { return names[subsystem]; }
+
+		/// set the budget in bytes, 0 for no budget
+		static void setBudget(long long bytes) { budget = bytes; }
+		static long long getBudget() { return budget; }
+
+		/// bytes left under the budget, can be negative. A large number if there is no budget.
+		static long long available();
+
+		/** @brief check whether bytes more fit in the budget,
+		 *		   calling the compactors in the order of registration until they fit.
+		 *		   Nothing is added to any subsystem, which is done by the caller when it allocates.
+		 *	@return true if they fit
+		 */
+		static bool reserve(long long bytes);
+
+		/** @brief register a function releasing memory when the budget is short.
+		 *		   It is called with the bytes needed, and returns the bytes it has released.
+		 */
+		static bool addCompactor(long long (*compactor)(long long needed));
+
+		/// one line of the peak bytes of the subsystems, in MB
+		static std::string summary();
+
+	private:
+		static inline void raise(std::atomic<long long>& peak_value, long long value) {
+			long long p = peak_value;
+			while ((value > p) && !peak_value.compare_exchange_weak(p, value))
+				;
+		}
+
+		static const char* names[MEM_NUM];
+		static std::atomic<long long> current[MEM_NUM];
+		static std::atomic<long long> peak[MEM_NUM];
+		static std::atomic<long long> total;
+		static std::atomic<long long> total_peak;
+		static std::atomic<long long> budget;
+};
+
+#endif
@@ -14,8 +14,6 @@
 #include "polynomial.h"
 #include "classifier.h"
 
-typedef double MState[Cv1to4];
-
 class MLalgo 
 {
 	protected:
@@ -90,45 +88,14 @@ class MLalgo
 			return out;
 		};
 
+		/** @brief map the Nv values in src to all the monomials of degree [1, et] in dst
+		 *		   The expansion is unrolled at compile time, see monomial.h
+		 */
 		bool mappingData(double* src, double* dst, int et = 4) {
-			int index = 0;
-			if (et >= 1) {
-				for (int i = 0; i < Nv; i++) {
-					dst[index++] = src[i];
-				}
-			}
-			if (et >= 2) {
-				for (int i = 0; i < Nv; i++) {
-					for (int j = i; j < Nv; j++) {
-						dst[index++] = src[i] * src[j];
-					}
-				}
-			}
-			if (et >= 3) {
-				for (int i = 0; i < Nv; i++) {
-					for (int j = i; j < Nv; j++) {
-						for (int k = j; k < Nv; k++) {
-							dst[index++] = src[i] * src[j] * src[k];
-						}
-					}
-				}
-			}
-			if (et >= 4) {
-				for (int i = 0; i < Nv; i++) {
-					for (int j = i; j < Nv; j++) {
-						for (int k = j; k < Nv; k++) {
-							for (int l = k; l < Nv; l++) {
-								dst[index++] = src[i] * src[j] * src[k] * src[l];
-							}
-						}
-					}
-				}
-			}
-			if (et >= 5) {
-				std::cout << "Unsupported for 5 dimension up.\n";
-				return false;
-			}
-			return true;
+			if (monomial::expand(src, dst, et))
+				return true;
+			IIF_LOG(LOG_SVM, LOG_ERROR) << "Unsupported for 5 dimension up.\n";
+			return false;
 		}
 
 		bool setEtimes(int et) {
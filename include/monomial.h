@@ -0,0 +1,161 @@
+/** @file monomial.h
+ *  @brief Compile-time monomial tables and feature expansion kernels.
+ *
+ *  Monomials of Nv variables up to degree 4 are indexed in the same order used all over the project:
+ *  1, x_0, ..., x_{Nv-1}, x_0*x_0, x_0*x_1, ..., x_{Nv-1}^4
+ *  Inside one degree the monomials x_i*x_j*... (i <= j <= ...) are sorted lexicographically.
+ *
+ *  The exponent table and the expansion kernels are generated by the compiler for the configured Nv.
+ *  A degree-d monomial x_i*m is computed as x_i times the degree-(d-1) monomial m,
+ *  which has already been computed, so a feature expansion is a straight-line chain of multiplies.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _MONOMIAL_H_
+#define _MONOMIAL_H_
+
+#include "config.h"
+
+namespace monomial {
+	/// binomial coefficient C(n, k)
+	constexpr int binom(int n, int k) {
+		return ((k < 0) || (k > n)) ? 0 : ((k == 0) ? 1 : binom(n - 1, k - 1) * n / k);
+	}
+
+	/// the number of monomials in nv variables with degree exactly d
+	constexpr int count(int nv, int d) {
+		return binom(nv + d - 1, d);
+	}
+
+	/// the index of the first monomial with degree d
+	constexpr int offset(int nv, int d) {
+		return (d == 0) ? 0 : offset(nv, d - 1) + count(nv, d - 1);
+	}
+
+	/// the number of degree-d monomials whose smallest variable is less than i,
+	/// which is also the rank of the first one beginning with x_i
+	constexpr int before(int nv, int d, int i) {
+		return count(nv, d) - count(nv - i, d);
+	}
+
+	/// the smallest variable of the rank-th monomial with degree d
+	constexpr int first(int nv, int d, int rank, int i = 0) {
+		return ((i + 1 < nv) && (before(nv, d, i + 1) <= rank)) ? first(nv, d, rank, i + 1) : i;
+	}
+
+	/// the exponent of variable v in the rank-th monomial with degree d
+	constexpr int rankExponent(int nv, int d, int rank, int v) {
+		return (d == 0) ? 0 :
+			((first(nv, d, rank) == v) ? 1 : 0)
+			+ rankExponent(nv - first(nv, d, rank), d - 1,
+					rank - before(nv, d, first(nv, d, rank)), v - first(nv, d, rank));
+	}
+
+	constexpr int indexDegree(int nv, int index, int d = 0) {
+		return (index < offset(nv, d + 1)) ? d : indexDegree(nv, index, d + 1);
+	}
+
+	constexpr int indexExponent(int nv, int index, int v) {
+		return rankExponent(nv, indexDegree(nv, index), index - offset(nv, indexDegree(nv, index)), v);
+	}
+
+	/// integer sequences, generated with logarithmic template depth
+	template <int... I> struct Seq {
+		typedef Seq<I..., (int(sizeof...(I)) + I)...> doubled;
+		typedef Seq<I..., (int(sizeof...(I)) + I)..., 2 * int(sizeof...(I))> doubledPlusOne;
+	};
+
+	template <int N, bool odd = (N % 2 == 1)> struct MakeSeq;
+	template <int N> struct MakeSeq<N, false> { typedef typename MakeSeq<N / 2>::type::doubled type; };
+	template <int N> struct MakeSeq<N, true> { typedef typename MakeSeq<N / 2>::type::doubledPlusOne type; };
+	template <> struct MakeSeq<0, false> { typedef Seq<> type; };
+
+	/// value[index * Nv + v] is the exponent of variable v in monomial index
+	template <class S> struct ExponentTable;
+	template <int... I> struct ExponentTable<Seq<I...> > {
+		static constexpr int value[sizeof...(I)] = { indexExponent(Nv, I / Nv, I % Nv)... };
+	};
+	template <int... I> constexpr int ExponentTable<Seq<I...> >::value[sizeof...(I)];
+
+	/// value[index] is the degree of monomial index
+	template <class S> struct DegreeTable;
+	template <int... I> struct DegreeTable<Seq<I...> > {
+		static constexpr int value[sizeof...(I)] = { indexDegree(Nv, I)... };
+	};
+	template <int... I> constexpr int DegreeTable<Seq<I...> >::value[sizeof...(I)];
+
+	typedef ExponentTable<MakeSeq<Cv0to4 * Nv>::type> Exponents;
+	typedef DegreeTable<MakeSeq<Cv0to4>::type> Degrees;
+
+	/** @brief the exponent of variable var in the monomial with the given index
+	 *		   index 0 is the constant term 1, index in [1, Nv] is the variable index-1 itself.
+	 */
+	inline int exponent(int index, int var) {
+		assert((index >= 0) && (index < Cv0to4) && (var >= 0) && (var < Nv));
+		return Exponents::value[index * Nv + var];
+	}
+
+	inline int degree(int index) {
+		assert((index >= 0) && (index < Cv0to4));
+		return Degrees::value[index];
+	}
+
+	/*
+	 * Feature expansion kernels.
+	 * The destination f does not contain the constant term, so monomial index is stored at f[index - 1].
+	 * Chain<D, I, R, Len> computes the R-th degree-D monomial beginning with x_I,
+	 * from the matching degree-(D-1) monomial, which only contains variables x_I ... x_{Nv-1}.
+	 */
+	template <int D, int I, int R, int Len> struct Chain {
+		static inline void run(const double* x, double* f) {
+			f[offset(Nv, D) - 1 + before(Nv, D, I) + R] = x[I] * f[offset(Nv, D - 1) - 1 + before(Nv, D - 1, I) + R];
+			Chain<D, I, R + 1, Len>::run(x, f);
+		}
+	};
+	template <int D, int I, int Len> struct Chain<D, I, Len, Len> {
+		static inline void run(const double*, double*) {}
+	};
+
+	template <int D, int I = 0> struct Block {
+		static inline void run(const double* x, double* f) {
+			Chain<D, I, 0, count(Nv - I, D - 1)>::run(x, f);
+			Block<D, I + 1>::run(x, f);
+		}
+	};
+	template <int D> struct Block<D, Nv> {
+		static inline void run(const double*, double*) {}
+	};
+
+	template <int D> struct Expand {
+		static inline void run(const double* x, double* f) {
+			Expand<D - 1>::run(x, f);
+			Block<D>::run(x, f);
+		}
+	};
+	template <> struct Expand<1> {
+		static inline void run(const double* x, double* f) {
+			for (int i = 0; i < Nv; i++)
+				f[i] = x[i];
+		}
+	};
+
+	/** @brief expand x to all the monomials of degree [1, et], in the order of their indices.
+	 *
+	 *	@param x the values of Nv variables
+	 *	@param f set by callee, must have room for Cv1to(et) values
+	 *	@param et the max degree, should be in [1, 4]
+	 *	@return false if et is not supported
+	 */
+	inline bool expand(const double* x, double* f, int et) {
+		switch (et) {
+			case 1: Expand<1>::run(x, f); return true;
+			case 2: Expand<2>::run(x, f); return true;
+			case 3: Expand<3>::run(x, f); return true;
+			case 4: Expand<4>::run(x, f); return true;
+		}
+		return false;
+	}
+}
+
+#endif
@@ -9,6 +9,9 @@
 #define _POLYNOMIAL_H_
 
 #include "config.h"
+#include "monomial.h"
+#include "profiler.h"
+#include "logger.h"
 #include <cmath>
 #include <cfloat>
 #include <stdarg.h>
@@ -23,16 +26,12 @@
 #include "color.h"
 #include "solution.h"
 #include "candidates.h"
+#include "context_state.h"
 #if (linux || __MACH__)
 #include "z3++.h"
 using namespace z3;
 #endif
 
-extern int maxv;
-extern int minv;
-extern std::string* variables;
-extern VariablePowerArray* vparray;
-extern int vnum;
 //class Candidates;
 
 
@@ -110,6 +109,13 @@ class Polynomial {
 
 		std::string toString() const;
 
+		/** @brief A canonical form of the polynomail, the same for all the polynomails of the same half space
+		 *		   written with integer coefficients, e.g. "2 + 4*x >= 0" and "1 + 2*x >= 0".
+		 *		   Integer coefficients are divided by their gcd, then all the coefficients are written
+		 *		   by the monomial order, without the trailing zeros, e.g. "1 2".
+		 */
+		std::string canonical() const;
+
 		/** @brief Output the polynomail in a readable format
 		 *
 		 *	Example:
@@ -166,9 +172,8 @@ class Polynomial {
 			assert ((index >= 0) && (index < dims));
 			double result = theta[index];
 			for (int i = 0; (i < Nv) && (result != 0); i++) {
-				if (vparray[index][i] != 0) {
-					result *= pow(given_values[i], vparray[index][i]);
-				}
+				for (int power = monomial::exponent(index, i); power > 0; power--)
+					result *= given_values[i];
 			}
 			return result;
 		}
@@ -177,7 +182,7 @@ class Polynomial {
 			double result = 0;
 			given_values[x] = 1;
 			for (int i = 0; i < dims; i++) {
-				if (vparray[i][x] == power)
+				if (monomial::exponent(i, x) == power)
 					result += evaluateItem(i, given_values);
 			}
 			return result;
@@ -207,12 +212,13 @@ class Polynomial {
 						break;
 					}
 				}
-#ifdef __PRT_GSLSOLVE
-				std::cout << " >" << pickX << "{";
-				for (int i = 0; i < etimes + 1; i++)
-					std::cout << uni_coefs[i] << ", ";
-				std::cout << "} ";
-#endif
+				if (Logger::enabled(LOG_SOLVE, LOG_DEBUG)) {
+					LogRecord record(LOG_DEBUG);
+					record.stream() << " >" << pickX << "{";
+					for (int i = 0; i < etimes + 1; i++)
+						record.stream() << uni_coefs[i] << ", ";
+					record.stream() << "} ";
+				}
 				res = gslSolvePolynomial(uni_coefs, etimes, &results[pickX]);
 				delete []uni_coefs;
 			}
@@ -279,6 +285,7 @@ class Polynomial {
 		 * @return int 0 if no error.
 		 */
 		static int solver(/*const*/ Polynomial* poly, Solution& sol) {
+			const int minv = current_context->minv, maxv = current_context->maxv;
 			if (poly == NULL) {
 				/**
 				 * poly == NULL means no polynomail is specified
@@ -310,9 +317,7 @@ class Polynomial {
 				}
 			}
 
-#ifdef __PRT_TESTCASE
 			//std::cout << sol << "~";
-#endif
 
 			//std::cout << "solved the polynomail to get one solution";
 			return 0;
@@ -329,16 +334,11 @@ class Polynomial {
 		static double calc(Polynomial& poly, double* sol) {
 			if (sol == NULL) return -1;
 			//if (&poly == NULL) return -1;
-			double res = 0;
-			for (int i = 0; i < poly.getDims(); i++) {
-				double tmp = poly.theta[i];
-				for (int j = 0; j < Nv; j++) {
-					int power = vparray[i][j];
-					while (power-->0)
-						tmp *= sol[j];
-				}
-				res += tmp;
-			}
+			double features[Cv1to4];
+			if (monomial::expand(sol, features, poly.getEtimes()) == false) return -1;
+			double res = poly.theta[0];
+			for (int i = 1; i < poly.getDims(); i++)
+				res += poly.theta[i] * features[i - 1];
 			return res;
 		}
 
@@ -0,0 +1,147 @@
+/** @file profiler.h
+ *  @brief Scoped phase timers and counters of the learning procedure.
+ *
+ *  Each learning round accumulates the time spent in every phase, and a few counters.
+ *  When a new round begins, or the run ends, the figures are appended to file <prefix>.prof.csv
+ *  in a long format, one metric per line:
+ *		pid,stage,round,metric,value
+ *  where stage is the learner name for a round, or "total" for the whole run.
+ *  verify.sh appends its own lines with stage "verify" to the same file.
+ *
+ *  Besides, every learner round and learner is recorded as a span in <prefix>.trace.json,
+ *  in the chrome trace event format, which can be opened by chrome://tracing or ui.perfetto.dev.
+ *  A round span carries the time and calls of each phase in its args, so that the trace grows with
+ *  the rounds only. Setting IIF_TRACE_CALLS=1 records every phase call as a span of its own as well,
+ *  e.g. each execution of the target and each z3 query, which is costly and meant for short runs.
+ *  The file is a json array without the closing bracket, which the format allows,
+ *  so that several runs and verify.sh can append to it. Timestamps are microseconds since epoch,
+ *  each process is a pid, each thread a track.
+ *
+ *  Each round also records mem_kb, the bytes held by the engine as counted by MemoryTracker,
+ *  and the totals include the peak of each subsystem as mem_<subsystem>_peak_kb.
+ *
+ *  The current round is kept by each thread, so that learners running in parallel
+ *  (see iifContext::setPortfolio) have their own rounds, and share the totals.
+ *  Contexts learning at the same time share the files opened by the first one,
+ *  and the last one to close writes the totals of them all.
+ *
+ *  Phase times are inclusive, e.g. sampling contains the time of addStates.
+ *  Profiling is compiled in only if __PROFILE_ENABLED is defined,
+ *  otherwise PROFILE_SCOPE and PROFILE_COUNT expand to nothing.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <atomic>
+
+enum { PHASE_SAMPLING = 0, PHASE_ADD_STATES, PHASE_MAPPING, PHASE_SVM_TRAIN,
+	PHASE_CHECK, PHASE_SIMPLIFY, PHASE_Z3, PHASE_NUM };
+
+enum { COUNT_SMO_ITERATIONS = 0, COUNT_TRACES, COUNT_Z3_QUERIES, COUNT_NUM };
+
+class Profiler {
+	public:
+		/** @brief start profiling a run, the result is written to <prefix>.prof.csv and <prefix>.trace.json
+		 *		   The files are closed by Profiler::close, or at exit.
+		 *		   If another run is being profiled, this one is written to its files.
+		 *	@return whether the run is profiled, it should then call close once
+		 */
+		static bool open(const char* prefix);
+
+		/** @brief write the figures of the previous round, and start round rnd of the given learner
+		 */
+		static void round(const char* learner, int rnd);
+
+		/** @brief write the last round of the learner run by the calling thread,
+		 *		   called by each learner thread before it ends, see iifContext::setPortfolio
+		 */
+		static void endLearner();
+
+		/** @brief write the last round of the calling thread, and the totals of the runs including peak memory usage
+		 *		   once the last run opened is closed
+		 */
+		static void close();
+
+		static inline void addTime(int phase, std::chrono::steady_clock::time_point begin,
+				std::chrono::steady_clock::time_point end) {
+			round_ns[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+			round_calls[phase]++;
+			if (trace_calls.load(std::memory_order_relaxed))
+				span(phase_names[phase], "phase", begin, end);
+		}
+
+		/** @brief record a span on the track of the calling thread in the trace file,
+		 *		   args is the json members of its args object, if any
+		 */
+		static void span(const char* name, const char* category,
+				std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end,
+				const std::string& args = "");
+
+		static inline void count(int counter, long long n) {
+			round_counts[counter] += n;
+		}
+
+		/// peak resident set size of this process in KB, -1 if unknown
+		static long peakRSS();
+
+	private:
+		static void flushRound(std::chrono::steady_clock::time_point now);
+		/// record the bytes held by each subsystem, see MemoryTracker, as a counter in the trace file
+		static void memoryCounter(std::chrono::steady_clock::time_point when);
+		static void write(const char* stage, int rnd, const char* metric, double value);
+		/// close the files whatever runs are still open
+		static void closeAtExit();
+
+		static const char* phase_names[PHASE_NUM];
+		/// the number of runs open, guarded by open_mutex, it is read without it by the learners
+		static std::atomic<int> opened;
+		static std::mutex open_mutex;
+		/// record every phase call as a span, see IIF_TRACE_CALLS
+		static std::atomic<bool> trace_calls;
+		static std::ofstream fout;
+		static std::ofstream tout;
+		static std::mutex tout_mutex;
+		/// guards fout and the totals
+		static std::mutex fout_mutex;
+		/// system clock minus steady clock in microseconds, to convert steady time points to timestamps
+		static long long epoch_offset_us;
+		static std::chrono::steady_clock::time_point start;
+		static long long total_ns[PHASE_NUM], total_calls[PHASE_NUM], total_counts[COUNT_NUM];
+		// the current round is kept by each thread, so that learners can run in parallel
+		static thread_local std::chrono::steady_clock::time_point learner_start, round_start;
+		static thread_local std::string learner;
+		static thread_local int rnd;
+		static thread_local long long round_ns[PHASE_NUM], round_calls[PHASE_NUM], round_counts[COUNT_NUM];
+};
+
+/** \class ScopedTimer
+ *  @brief Adds the time between its construction and destruction to the given phase.
+ */
+class ScopedTimer {
+	public:
+		explicit ScopedTimer(int phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+		~ScopedTimer() {
+			Profiler::addTime(phase, start, std::chrono::steady_clock::now());
+		}
+
+	private:
+		int phase;
+		std::chrono::steady_clock::time_point start;
+};
+
+#ifdef __PROFILE_ENABLED
+#define PROFILE_SCOPE(phase) ScopedTimer _profile_scope(phase)
+#define PROFILE_COUNT(counter, n) Profiler::count(counter, n)
+#else
+#define PROFILE_SCOPE(phase)
+#define PROFILE_COUNT(counter, n)
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+/** @file sample_library.h
+ *  @brief An on-disk library of all the executions of a loop ever observed, shared by the runs on the loop.
+ *
+ *  The library of a loop is the file <folder>/<key>.lib, where key is a hash of the cfg of the loop, see loop_key.h.
+ *  It keeps each execution once: its input, its label and the states recorded, including the executions on
+ *  the counter examples of verify.sh, which are replayed by the next run, and those which violate the
+ *  postcondition, so that the next run returns -2 right away.
+ *  A run reads the library at the beginning of learn() and appends its new executions after each sampling
+ *  and at the end, see iifContext::setSampleLibrary. The states of a deterministic target are then added to the states sets
+ *  as they are, without executing it again. The inputs of the other targets are executed again.
+ *
+ *  The file is a sequence of chunks, one by each run:
+ *		"IIFSLIB1", Nv, MstatesIn1trace, the sampling policy, its k, the number of executions,
+ *		then the executions: Nv ints of input, the label, the number of states, and the states.
+ *  The states are kept as the sampling policy of their run left them, so they are only reused
+ *  under the same policy, otherwise the input is executed again.
+ *  A chunk is appended as a whole, under an exclusive lock, so that concurrent runs can share a library.
+ *  A chunk left incomplete, e.g. by a run killed while writing it, is read up to its last complete execution.
+ *
+ *  The values are written in the byte order and the sizes of the machine, a library is not portable.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _SAMPLE_LIBRARY_H_
+#define _SAMPLE_LIBRARY_H_
+
+#include "config.h"
+#include "loop_key.h"
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <atomic>
+
+class SampleLibrary {
+	public:
+		struct Execution {
+			int input[Nv];
+			int label;
+			/// whether the states can be reused, i.e. recorded under the sampling policy of this run
+			bool reusable;
+			/// the states, Nv values each
+			std::vector<double> states;
+		};
+
+		SampleLibrary(const std::string& folder, const std::string& key);
+
+		const std::string& path() const {
+			return filename;
+		}
+
+		/** @brief read all the executions of the library, they are not recorded again by this run
+		 *	@return false if there is no library yet
+		 */
+		bool load(std::vector<Execution>& executions);
+
+		/// record an execution of this run, unless the library has it already
+		void record(const int* input, int label, const double (*states)[Nv], int len);
+
+		/// the number of executions recorded and not written yet
+		int pending() const {
+			return pending_num;
+		}
+
+		/** @brief append the executions recorded to the library
+		 *	@return false if it can not be written, the executions are then kept for the next time
+		 */
+		bool flush();
+
+		/** @brief flush, unless the library is being changed, e.g. by the thread the timeout alarm has interrupted,
+		 *		   called by the alarm before the process exits
+		 */
+		bool flushIfIdle();
+
+	private:
+		bool writePending();
+
+		/// a hash of the input and the states of an execution
+		static unsigned long long executionHash(const int* input, const double* states, int len);
+
+		std::string folder;
+		std::string filename;
+		std::unordered_set<unsigned long long> known;
+		/// the executions of this run, in the format of a chunk
+		std::string buffer;
+		int pending_num;
+		/// set while the executions are recorded or written, see flushIfIdle
+		std::atomic<bool> busy;
+
+		SampleLibrary(const SampleLibrary&);
+		SampleLibrary& operator= (const SampleLibrary&);
+};
+
+#endif
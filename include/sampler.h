@@ -0,0 +1,197 @@
+/** @file sampler.h
+ *  @brief Provide batch generation of inputs for selective sampling.
+ *
+ *  Classifier::solver picks one input at a time. BoundarySampler instead produces
+ *  a whole batch of distinct integer inputs which lie next to the boundary of the
+ *  given classifier, spread over all its conjuncts.
+ *  Inputs that have already been executed are rejected.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include "config.h"
+#include "solution.h"
+#include "polynomial.h"
+#include "classifier.h"
+#include "memtrack.h"
+#include "context_state.h"
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+/** \class InputSet
+ *  @brief A hash set of integer program inputs.
+ *
+ *  Each input is converted to integers in the same way as BaseLearner::runTarget does.
+ */
+class InputSet {
+	public:
+		InputSet() {}
+		InputSet(const InputSet&) = delete;
+		InputSet& operator= (const InputSet&) = delete;
+		~InputSet() { MemoryTracker::sub(MEM_SAMPLER, keys.size() * entry_bytes); }
+
+		struct Key {
+			int v[Nv];
+			bool operator== (const Key& rhs) const {
+				for (int i = 0; i < Nv; i++)
+					if (v[i] != rhs.v[i]) return false;
+				return true;
+			}
+		};
+
+		struct KeyHash {
+			size_t operator() (const Key& k) const {
+				// FNV-1a over the integer values
+				unsigned long long h = 14695981039346656037ULL;
+				for (int i = 0; i < Nv; i++) {
+					h ^= static_cast<unsigned int>(k.v[i]);
+					h *= 1099511628211ULL;
+				}
+				return static_cast<size_t>(h);
+			}
+		};
+
+		static inline void toKey(const int* input, Key& k) {
+			for (int i = 0; i < Nv; i++)
+				k.v[i] = input[i];
+		}
+
+		static inline void toKey(const double* input, Key& k) {
+			for (int i = 0; i < Nv; i++)
+				k.v[i] = static_cast<int>(input[i]);
+		}
+
+		template <typename T>
+		bool contains(const T* input) const {
+			Key k;
+			toKey(input, k);
+			return keys.find(k) != keys.end();
+		}
+
+		/** @brief insert the input into the set
+		 *  @return false if the input is already contained
+		 */
+		template <typename T>
+		bool insert(const T* input) {
+			Key k;
+			toKey(input, k);
+			if (keys.insert(k).second == false)
+				return false;
+			MemoryTracker::add(MEM_SAMPLER, entry_bytes);
+			return true;
+		}
+
+		int size() const { return keys.size(); }
+		void clear() {
+			MemoryTracker::sub(MEM_SAMPLER, keys.size() * entry_bytes);
+			keys.clear();
+		}
+
+		/// write the inputs into a snapshot, see checkpoint.h
+		void save(std::ostream& out) const;
+		/// replace the inputs by the ones saved
+		bool load(std::istream& in);
+
+		/// approximate bytes taken by one key in the set, counting its node and bucket
+		static const long long entry_bytes = sizeof(Key) + 3 * sizeof(void*);
+
+	private:
+		std::unordered_set<Key, KeyHash> keys;
+};
+
+/** \class ExecutionCache
+ *  @brief Maps integer program inputs to the labels of their traces.
+ *
+ *  Only valid for deterministic targets, where an input always produces the same trace.
+ */
+class ExecutionCache {
+	public:
+		ExecutionCache() {}
+		ExecutionCache(const ExecutionCache&) = delete;
+		ExecutionCache& operator= (const ExecutionCache&) = delete;
+		~ExecutionCache() { MemoryTracker::sub(MEM_SAMPLER, labels.size() * entry_bytes); }
+
+		bool lookup(const int* input, int& label) const {
+			InputSet::Key k;
+			InputSet::toKey(input, k);
+			std::unordered_map<InputSet::Key, int, InputSet::KeyHash>::const_iterator it = labels.find(k);
+			if (it == labels.end())
+				return false;
+			label = it->second;
+			return true;
+		}
+
+		/// nothing is stored when the memory budget is used up, the cache is only an optimization
+		void store(const int* input, int label) {
+			if (MemoryTracker::available() < entry_bytes)
+				return;
+			InputSet::Key k;
+			InputSet::toKey(input, k);
+			if (labels.insert(std::make_pair(k, label)).second)
+				MemoryTracker::add(MEM_SAMPLER, entry_bytes);
+			else
+				labels[k] = label;
+		}
+
+		int size() const { return labels.size(); }
+		void clear() {
+			MemoryTracker::sub(MEM_SAMPLER, labels.size() * entry_bytes);
+			labels.clear();
+		}
+
+		void save(std::ostream& out) const;
+		bool load(std::istream& in);
+
+		static const long long entry_bytes = sizeof(InputSet::Key) + sizeof(int) + 3 * sizeof(void*);
+
+	private:
+		std::unordered_map<InputSet::Key, int, InputSet::KeyHash> labels;
+};
+
+/** \class BoundarySampler
+ *  @brief Generates batches of distinct inputs near the boundary of a classifier.
+ *
+ *  For each conjunct, a block of random base points is drawn, and one variable
+ *  is solved from the univariate polynomial left after substituting the others.
+ *  The univariate coefficients of the whole block are evaluated together
+ *  on structure-of-arrays buffers, so that the inner loops run over the block.
+ */
+class BoundarySampler {
+	public:
+		/// executed NULL stands for the inputs executed in the current context, see ContextState::executed_inputs
+		BoundarySampler(const InputSet* executed = NULL) : executed(executed) {}
+
+		/** @brief Generate n distinct inputs near the boundary of cl.
+		 *
+		 *	If cl is NULL or empty, the inputs are picked randomly in scope [minv, maxv].
+		 *	Conjuncts of cl share the batch evenly.
+		 *	When not enough boundary points can be found, random inputs fill the rest.
+		 *
+		 *	@param cl the classifier, can be NULL
+		 *	@param sols set by callee, must have room for n solutions
+		 *	@param n the number of inputs required
+		 *	@return int the number of inputs generated which are near the boundary
+		 */
+		int sample(const Classifier* cl, Solution* sols, int n);
+
+	private:
+		int sampleConjunct(Polynomial& poly, Solution* sols, int n);
+		int fillRandom(Solution* sols, int n, int scale);
+		bool accept(const int* input);
+
+		const InputSet* executed;
+		/// inputs generated in the current batch, used to reject duplicates within a batch
+		InputSet batch;
+
+		// structure-of-arrays buffers, indexed by [variable or power][point in block]
+		std::vector<double> base;
+		std::vector<double> powers;
+		std::vector<double> coefs;
+		std::vector<double> terms;
+};
+
+#endif
@@ -23,9 +23,6 @@
 #include <assert.h>
 #include "color.h"
 
-extern int maxv;
-extern int minv;
-
 /** \class Solution
  *  @brief This class defines the format of a valid solution to an equation.
  *
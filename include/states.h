@@ -1,19 +1,32 @@
 #ifndef _STATES_H_
 #define _STATES_H_
 #include "config.h"
+#include "monomial.h"
+#include "profiler.h"
+#include "logger.h"
+#include "memtrack.h"
 #include <iostream>
 #include <fstream>
 #include <cassert>
 #include <string.h>
+#include <vector>
+#include <unordered_set>
+#include <atomic>
 
 
 typedef double State[Nv];
 
+/// a state mapped to all its monomials up to degree 4.
+/// The monomials up to degree d are a prefix of it, so it can be trained with any etimes.
+typedef double MState[Cv1to4];
+
+// the states sets are guarded by ContextState::states_mutex when learners run in parallel
+
 class States{
 	public:
 		State (*values);
 		int label;
-		int size;
+		std::atomic<int> size;
 
 		// t_index is the array stored all the offset of traces in states.
 		// e.g. t_index[0] = 0 means the 0-th trace is located at position 0 in values;
@@ -25,7 +38,7 @@ class States{
 		// Apperately, we have :
 		//						t_index[p_index] == size
 		// Thus, size is redundant in this context.
-		int p_index;
+		std::atomic<int> p_index;
 
 		inline int getTraceSize() {
 			return p_index;
@@ -48,22 +61,78 @@ class States{
 			return label; 
 		}
 
+		/** @brief map all the states which have not been mapped yet.
+		 *		   Each state is mapped exactly once, no matter how many times this is called.
+		 *	@return int the number of states newly mapped
+		 */
+		int ensureMapped();
+
+		/** @brief get the mapped features of the i-th state. ensureMapped should be called first.
+		 *		   The pointer stays valid for the lifetime of this object, even after states are added,
+		 *		   and it can be got without holding ContextState::states_mutex.
+		 */
+		inline double* getMapped(int i) {
+			assert((i >= 0) && (i < mapped_size));
+			return mapped_blocks[i / mapped_block_size][i % mapped_block_size];
+		}
+
+		inline int getMappedSize() {
+			return mapped_size;
+		}
+
 	public:
-		States() : max_size(Mitems) {
+		States() : max_size(Mitems), max_traces(Mitems) {
 			values = new double[Mitems][Nv];
 			t_index = new int[Mitems];
+			MemoryTracker::add(MEM_STATES, Mitems * (sizeof(State) + sizeof(int)));
 			t_index[0] = 0;
 			p_index = 0;
 			size = 0;
+			mapped_size = 0;
+			mapped_block_num = 0;
 		}
 
 		~States();
 
 		bool initFromFile(int num, std::ifstream& fin);
 
+		/// write the states, the traces and their hashes into a snapshot, see checkpoint.h
+		void save(std::ostream& out) const;
+
+		/** @brief replace the content of this set by the one saved, before any state is mapped
+		 *	@return false if the snapshot is broken, or out of memory
+		 */
+		bool load(std::istream& in);
+
+		/** @brief drop all the states, with their hashes and mapped features, the capacity is kept.
+		 *		   Nothing should point to the mapped states any more, e.g. a training set.
+		 */
+		void clear();
+
+		/** @brief add a trace of len states. States already in this set are skipped.
+		 *		   A trace identical to one added before is skipped as a whole: its hash is known,
+		 *		   and all its states are in this set, as two traces may have the same hash.
+		 *	@return int the number of states really added, -1 if out of memory
+		 */
 		int addStates(State st[], int len);
 
-		void dumpTrace(int num);
+		/// rolling hash of a whole trace
+		static unsigned long long traceHash(State st[], int len) {
+			unsigned long long h = 14695981039346656037ULL;
+			for (int i = 0; i < len; i++) {
+				for (int j = 0; j < Nv; j++) {
+					unsigned long long bits;
+					double v = st[i][j] + 0.0;	// +0.0 turns -0.0 into 0.0
+					memcpy(&bits, &v, sizeof(bits));
+					h = (h ^ bits) * 1099511628211ULL;
+				}
+				h = (h ^ (h >> 29)) * 0x9E3779B97F4A7C15ULL;
+			}
+			return h ^ static_cast<unsigned long long>(len);
+		}
+
+		/// write trace num into out, as part of a message
+		void dumpTrace(int num, std::ostream& out);
 
 		friend std::ostream& operator << (std::ostream& out, const States& ss);
 
@@ -78,7 +147,32 @@ class States{
 		static inline void stateCpy(State* dst, State* src, int length = 1) {
 			memcpy(dst, src, sizeof(State) * length);
 		}
+		/** @brief make room for states_needed states and traces_needed traces in all.
+		 *		   The capacity is doubled, or grown to the exact need when the doubling does not fit the memory budget.
+		 *	@return false if out of memory
+		 */
+		bool reserve(int states_needed, int traces_needed);
+
+		/// whether all the len states of st are in this set
+		bool hasStates(State st[], int len) const;
+
 		int max_size;
+		int max_traces;
+
+		// approximate bytes taken by one entry of trace_hashes, counting its node and bucket
+		static const int trace_hash_bytes = 32;
+
+		// mapped states are kept in fixed size blocks, which are never moved,
+		// so that the training sets can point into them directly.
+		// The table of blocks never moves either, so that getMapped needs no lock.
+		static const int mapped_block_size = 4096;
+		static const int max_mapped_blocks = 1 << 14;
+
+		// hashes of all the traces added, see addStates
+		std::unordered_set<unsigned long long> trace_hashes;
+		MState* mapped_blocks[max_mapped_blocks];
+		int mapped_block_num;
+		std::atomic<int> mapped_size;
 };
 
 #endif
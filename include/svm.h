@@ -2,7 +2,10 @@
 #define _SVM_H_
 #include "ml_algo.h"
 #include "svm_core.h"
+#include "context_state.h"
+#include "checkpoint.h"
 #include "string.h"
+#include <algorithm>
 
 
 class SVM : public MLalgo
@@ -13,7 +16,7 @@ class SVM : public MLalgo
 		//svm_model* last_model;
 		int max_size;
 
-		MState* raw_mapped_data;
+		// data points to mapped states owned by gsets, see States::getMapped
 		double** data; // [max_items * 2];
 		double* label; // [max_items * 2];
 		int etimes;
@@ -29,27 +32,24 @@ class SVM : public MLalgo
 			int valid_size = problem.l;
 
 			// enlarge max_size exponentially to cover all the data.
+			int previous_max_size = max_size;
 			while (new_size >= max_size) max_size *= 2;
+			// under a memory budget, grow to the exact size needed when doubling does not fit
+			if (!MemoryTracker::reserve(static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double))))
+				max_size = new_size + 1;
+			MemoryTracker::add(MEM_TRAINSET, static_cast<long long>(max_size - previous_max_size)
+					* (sizeof(double*) + sizeof(double)));
 			//std::cout << " ---> " << max_size << "\n";
 
-			MState * new_raw_mapped_data = new MState[max_size];
-			memmove(new_raw_mapped_data, raw_mapped_data, valid_size * sizeof(MState*));
-			delete []raw_mapped_data;
-			raw_mapped_data = new_raw_mapped_data;
-
-			//double ** new_data = new double*[max_size];
-			//memmove(new_data, data, valid_size * sizeof(double**));
+			double ** new_data = new double*[max_size];
+			memmove(new_data, data, valid_size * sizeof(double*));
 			delete []data;
-			//data = new_data;
-			data = new double*[max_size];
-			for (int i = 0; i < valid_size; i++)
-				data[i] = raw_mapped_data[i];
+			data = new_data;
 
 			double* new_label = new double[max_size];
-			memmove(new_label, label, valid_size * sizeof(double*));
-			delete label;
+			memmove(new_label, label, valid_size * sizeof(double));
+			delete []label;
 			label = new_label;
-			//label = new double[max_size];
 
 			problem.x = (svm_node**)(data);
 			problem.y = label;
@@ -70,9 +70,12 @@ class SVM : public MLalgo
 					svm_set_print_string_function(f);
 				model = NULL;
 
+				// under a memory budget, start small and grow on demand, see resize
+				if (!MemoryTracker::reserve(static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double))))
+					max_size = std::min(max_size, Mitems);
 				data = new double*[max_size];
-				raw_mapped_data = new MState[max_size];
 				label = new double[max_size];
+				MemoryTracker::add(MEM_TRAINSET, static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double)));
 				etimes = 0;
 				for (int i = 0; i < max_size; i++)
 					label[i] = -1;
@@ -94,41 +97,31 @@ class SVM : public MLalgo
 
 			~SVM() {
 				if (model != NULL) svm_free_and_destroy_model(&model);
-#ifdef __PRT_DEBUG
-				std::cout << "SVM deleted model\n";
-#endif
-				if (raw_mapped_data != NULL) delete []raw_mapped_data;
-#ifdef __PRT_DEBUG
-				std::cout << "SVM deleted raw_mapped_data\n";
-#endif
+				IIF_LOG(LOG_SVM, LOG_DEBUG) << "SVM deleted model\n";
 				if (data != NULL) delete []data;
-#ifdef __PRT_DEBUG
-				std::cout << "SVM deleted data\n";
-#endif
+				IIF_LOG(LOG_SVM, LOG_DEBUG) << "SVM deleted data\n";
 				if (label != NULL) delete []label;
-#ifdef __PRT_DEBUG
-				std::cout << "SVM deleted label\n";
-#endif
+				MemoryTracker::sub(MEM_TRAINSET, static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double)));
+				IIF_LOG(LOG_SVM, LOG_DEBUG) << "SVM deleted label\n";
 			}
 
 
 			int makeTrainingSet(States* gsets, int& pre_psize, int& pre_nsize) {
+				std::lock_guard<std::mutex> lock(current_context->states_mutex);
 				//std::cout << "max-size=" << max_size << std::endl;
 				int cur_psize = gsets[POSITIVE].getSize();
 				int cur_nsize = gsets[NEGATIVE].getSize();
+				// only the states added since last call are mapped here
+				gsets[POSITIVE].ensureMapped();
+				gsets[NEGATIVE].ensureMapped();
 #ifndef __TRAINSET_SIZE_RESTRICTED
-				bool rebuild_data = false;
-				if (cur_psize + cur_nsize > max_size) {
+				if (cur_psize + cur_nsize > max_size)
 					resize(cur_psize + cur_nsize);
-					rebuild_data = true;
-				}
 #endif
 
-#ifdef __PRT
-				std::cout << "++[" << cur_psize - pre_psize << "|"
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "++[" << cur_psize - pre_psize << "|"
 					<< cur_nsize - pre_nsize  << "] ==> ["
 					<< cur_psize << "+|" << cur_nsize << "-]";
-#endif
 
 				int ret = cur_psize + cur_nsize - pre_psize - pre_nsize;
 #ifdef __TRAINSET_SIZE_RESTRICTED
@@ -136,67 +129,38 @@ class SVM : public MLalgo
 					int pstart = cur_psize > restricted_trainset_size? cur_psize - restricted_trainset_size : 0;
 					int plength = cur_psize - pstart;
 					for (int i = 0; i < plength; i++) {
-						mappingData(gsets[POSITIVE].values[pstart + i], raw_mapped_data[i], 4);
-						data[i] = raw_mapped_data[i];
+						data[i] = gsets[POSITIVE].getMapped(pstart + i);
 						label[i] = 1;
 					}
 					int nstart = cur_nsize > restricted_trainset_size? cur_nsize - restricted_trainset_size : 0;
 					int nlength = cur_nsize - nstart;
 					for (int i = 0; i < nlength; i++) {
-						mappingData(gsets[NEGATIVE].values[nstart + i], raw_mapped_data[plength + i], 4);
-						data[plength + i] = raw_mapped_data[plength + i];
+						data[plength + i] = gsets[NEGATIVE].getMapped(nstart + i);
 						label[plength + i] = -1;
 					}
 					pre_psize = cur_psize;
 					pre_nsize = cur_nsize;
 					cur_psize = plength;
 					cur_nsize = nlength;
-#ifdef __PRT
-					std::cout << RED << " RESTRICTED[" << plength << "+|" << nlength << "-]" << NORMAL;
-#endif
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << " RESTRICTED[" << plength << "+|" << nlength << "-]" << NORMAL;
 					ret = plength + nlength;
 				}
 #else
-				// rebuild data pointer due to realloction of raw_mapped_data
-				/*if (rebuild_data == true) {
-					for (int i = 0; i < pre_psize; i++) {
-						data[i] = raw_mapped_data[i];
-						label[i] = 1;
-					}
-					for (int i = 0; i < pre_nsize; i++) {
-						data[cur_psize + i] = raw_mapped_data[cur_psize + i];
-						label[i] = -1;
-					}
-					rebuild_data = false;
-					std::cout << "special for rebuild-data...done\n";
-				} else*/
-				{
-					// data :  0 | positive states | negative states ...
-					// label:    | 1, 1, ..., 1, . | -1, -1, ..., -1, -1, -1, ...
-					// move negative states from old OFFSET: [pre_positive_size] to new OFFSET: [cur_positive_size]
-					memmove(data + cur_psize, data + pre_psize, pre_nsize * sizeof(double*));
-				}
-
-				//std::cout << "build new data...\n";
-				// add new positive states at OFFSET: [pre_positive_size]
+				// data :  0 | states in the order they are added ...
+				// label:    | 1, 1, -1, ..., 1, -1, -1, ...
+				// Existing entries never move, only new states are appended at OFFSET: [pre_psize + pre_nsize].
+				// svm_train groups the states by label itself, and save_to_file writes positives first.
 				int cur_index = pre_psize + pre_nsize;
-				for (int i = 0 ; i < cur_psize - pre_psize; i++) {
-					mappingData(gsets[POSITIVE].values[pre_psize + i], raw_mapped_data[cur_index + i], 4);
-					data[pre_psize + i] = raw_mapped_data[cur_index + i];
-					label[pre_psize + i] = 1;
+				for (int i = pre_psize; i < cur_psize; i++) {
+					data[cur_index] = gsets[POSITIVE].getMapped(i);
+					label[cur_index++] = 1;
 				}
-
-				// add new negative states at OFFSET: [cur_positive_size + pre_negative_size]
-				cur_index = cur_psize + pre_nsize;
-				for (int i = 0 ; i < cur_nsize - pre_nsize; i++) {
-					mappingData(gsets[NEGATIVE].values[pre_nsize + i], raw_mapped_data[cur_index + i], 4);
-					data[cur_index + i] = raw_mapped_data[cur_index + i];
-					label[cur_index + i] = -1;
+				for (int i = pre_nsize; i < cur_nsize; i++) {
+					data[cur_index] = gsets[NEGATIVE].getMapped(i);
+					label[cur_index++] = -1;
 				}
 				//std::cout << "build new data...done\n";
 
-				//memmove(raw_mapped_data + cur_psize, raw_mapped_data + pre_psize, pre_nsize * sizeof(MState));
-
 				pre_psize = cur_psize;
 				pre_nsize = cur_nsize;
 #endif
@@ -213,11 +177,57 @@ class SVM : public MLalgo
 				return ret;
 			}
 
+			/// write the degree tried and the labels of the training set in its order into a snapshot, see checkpoint.h
+			void saveTrainingSet(std::ostream& out) const {
+				writeBinary(out, etimes);
+				writeBinary(out, problem.l);
+				for (int i = 0; i < problem.l; i++)
+					writeBinary(out, static_cast<signed char>(label[i] > 0 ? 1 : -1));
+			}
+
+			/** @brief rebuild the training set saved by saveTrainingSet, from the states sets restored with it.
+			 *		   The states are put in the same order, so the next training gives the same model.
+			 */
+			bool loadTrainingSet(std::istream& in, States* gsets) {
+				int et, l;
+				if (!readBinary(in, et) || !readBinary(in, l) || (l < 0))
+					return false;
+				std::lock_guard<std::mutex> lock(current_context->states_mutex);
+				gsets[POSITIVE].ensureMapped();
+				gsets[NEGATIVE].ensureMapped();
+				if (l >= max_size)
+					resize(l + 1);
+				int np = 0, nn = 0;
+				for (int i = 0; i < l; i++) {
+					signed char y;
+					if (!readBinary(in, y))
+						return false;
+					if (y > 0) {
+						if (np >= gsets[POSITIVE].getMappedSize())
+							return false;
+						data[i] = gsets[POSITIVE].getMapped(np++);
+						label[i] = 1;
+					} else {
+						if (nn >= gsets[NEGATIVE].getMappedSize())
+							return false;
+						data[i] = gsets[NEGATIVE].getMapped(nn++);
+						label[i] = -1;
+					}
+				}
+#ifdef __DS_ENABLED
+				problem.np = np;
+				problem.nn = nn;
+#endif
+				problem.l = l;
+				etimes = et;
+				return true;
+			}
+
 			int train() {
 				if (problem.y == NULL || problem.x == NULL) return -1;
 				const char* error_msg = svm_check_parameter(&problem, &param);
 				if (error_msg) { 
-					std::cout << "ERROR: " << error_msg << std::endl; 
+					IIF_LOG(LOG_SVM, LOG_ERROR) << "ERROR: " << error_msg << std::endl; 
 					return -1; 
 				}
 
@@ -253,65 +263,59 @@ class SVM : public MLalgo
 
 
 			double checkTrainingSet() {
+				PROFILE_SCOPE(PHASE_CHECK);
 				if (problem.l <= 0) return 0;
 				int pass = 0;
-#ifdef __PRT_POLYSVM
-				std::cout << RED << BOLD << " PREDICT WRONGLY>>> >>" << NORMAL << BLUE;
-#endif
+				bool debug = Logger::enabled(LOG_SVM, LOG_DEBUG);
+				std::ostringstream wrong;
 				for (int i = 0; i < problem.l; i++) {
-#ifdef __PRT_POLYSVM
-					double predict_result = predict((double*)problem.x[i]);
-					if (predict_result * problem.y[i] < 0) {
-						std::cout << RED << BOLD << "([" << problem.x[i][0];
-						for (int j = 1; j < Nv; j++)
-							std::cout << "," << problem.x[i][j];
-						std::cout << "]" << problem.y[i] << "->" << predict_result << ")  >>";
+					if (debug) {
+						double predict_result = predict((double*)problem.x[i]);
+						if (predict_result * problem.y[i] < 0) {
+							wrong << RED << BOLD << "([" << problem.x[i][0];
+							for (int j = 1; j < Nv; j++)
+								wrong << "," << problem.x[i][j];
+							wrong << "]" << problem.y[i] << "->" << predict_result << ")  >>";
+						}
 					}
-#endif
 					pass += (predict((double*)problem.x[i]) * problem.y[i] >= 0) ? 1 : 0;
 				}
-#ifdef __PRT_POLYSVM
-				std::cout << RED << BOLD << " >>>>>END CHECKING\n" << NORMAL;
-#endif
+				IIF_LOG(LOG_SVM, LOG_DEBUG) << RED << BOLD << " PREDICT WRONGLY>>> >>" << NORMAL << BLUE
+					<< wrong.str() << RED << BOLD << " >>>>>END CHECKING\n" << NORMAL;
 				return static_cast<double>(pass) / problem.l;
 			}
 
 			int checkQuestionTraces(States& qset) {
-#ifdef __PRT
-				std::cout << " [" << qset.traces_num() << "]";
-#endif
+				std::lock_guard<std::mutex> lock(current_context->states_mutex);
+				bool debug = Logger::enabled(LOG_LEARN, LOG_DEBUG);
+				// the whole check is one message, which is written on return
+				LogRecord record(LOG_DEBUG);
+				std::ostream& out = record.stream();
+				if (debug) out << " [" << qset.traces_num() << "]";
 				for (int i = 0; i < qset.p_index; i++) {
 					int pre = -1, cur = 0;
-#ifdef __PRT
-					std::cout << ".";
-#endif
+					if (debug) out << ".";
 					for (int j = qset.t_index[i]; j < qset.t_index[i + 1]; j++) {
 						cur = predict(qset.values[j]);
 						//std::cout << ((cur >= 0) ? "+" : "-");
 						if ((pre >= 0) && (cur < 0)) {
 							// deal with wrong question trace.
 							// Trace back to print out the whole trace and the predicted labels.
-#ifdef __PRT
-							std::cerr << RED << "\t[FAIL]\n \t  Predict wrongly on Question traces.\n";
-							qset.dumpTrace(i);
-#endif
-							for (int j = qset.t_index[i]; j < qset.t_index[i + 1]; j++) {
-								cur = predict(qset.values[j]);
-#ifdef __PRT
-								std::cout << ((cur >= 0) ? "+" : "-");
-#endif
+							if (debug) {
+								out << RED << "\t[FAIL]\n \t  Predict wrongly on Question traces.\n";
+								qset.dumpTrace(i, out);
+								for (int j = qset.t_index[i]; j < qset.t_index[i + 1]; j++) {
+									cur = predict(qset.values[j]);
+									out << ((cur >= 0) ? "+" : "-");
+								}
+								out << std::endl << NORMAL;
 							}
-#ifdef __PRT
-							std::cout << std::endl << NORMAL;
-#endif
 							return -1;
 						}
 						pre = cur;
 					}
 				}
-#ifdef __PRT
-				std::cout << " [PASS]";
-#endif
+				if (debug) out << " [PASS]";
 				return 0;
 			}
 
@@ -350,7 +354,10 @@ class SVM : public MLalgo
 
 			int trainLinear() {
 				Polynomial poly;
-				model = svm_train(&problem, &param);
+				{
+					PROFILE_SCOPE(PHASE_SVM_TRAIN);
+					model = svm_train(&problem, &param);
+				}
 				svm_model_visualization(model, &poly);
 				cl = poly;
 				return 0;
@@ -358,17 +365,16 @@ class SVM : public MLalgo
 
 			int trainPoly() {
 				Polynomial poly;
-#ifdef __PRT_POLYSVM
-				std::cout << RED  << "\ntrying from etimes = " << etimes << " $$$$$$ "<< NORMAL;
-#endif
+				IIF_LOG(LOG_SVM, LOG_DEBUG) << RED  << "\ntrying from etimes = " << etimes << " $$$$$$ "<< NORMAL;
 				while (etimes <= 4) {
 					setEtimes(etimes);
-					model = svm_train(&problem, &param);
+					{
+						PROFILE_SCOPE(PHASE_SVM_TRAIN);
+						model = svm_train(&problem, &param);
+					}
 					svm_model_visualization(model, &poly);
 					double pass_rate = checkTrainingSet();
-#ifdef __PRT_POLYSVM
-					std::cout << BLUE << "   [" << etimes << "] " << pass_rate*100 << "% --> " << NORMAL << poly << std::endl;
-#endif
+					IIF_LOG(LOG_SVM, LOG_DEBUG) << BLUE << "   [" << etimes << "] " << pass_rate*100 << "% --> " << NORMAL << poly << std::endl;
 					if (pass_rate == 1)
 						break;
 					etimes++;
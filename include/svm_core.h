@@ -14,7 +14,7 @@
 #define LIBSVM_VERSION 320
 
 extern int libsvm_version;
-extern int DIMENSION;
+extern thread_local int DIMENSION;
 
 int setDimension(int d);
 
@@ -49,11 +49,15 @@ struct svm_problem
 	bool save_to_file(const char* filepath) {
 		std::ofstream fout(filepath);
 		fout << l << "\t" << np << "\t" << nn << "\n";
-		for (int i = 0; i < l; i++) {
-			fout << y[i];
-			for (int j = 0; j < Nv; j++)
-				fout << "\t" << j << ":" << (x[i][j]).value;
-			fout << "\n";
+		// States::initFromFile reads positives first, while x may mix the labels
+		for (int pass = 0; pass < 2; pass++) {
+			for (int i = 0; i < l; i++) {
+				if ((y[i] > 0) != (pass == 0)) continue;
+				fout << y[i];
+				for (int j = 0; j < Nv; j++)
+					fout << "\t" << j << ":" << (x[i][j]).value;
+				fout << "\n";
+			}
 		}
 		fout.close();
 		return true;
@@ -155,6 +159,8 @@ double svm_predict_values(const struct svm_model *model, const struct svm_node *
 double svm_predict(const struct svm_model *model, const struct svm_node *x);
 double svm_predict_probability(const struct svm_model *model, const struct svm_node *x, 
 		double* prob_estimates);
+// the kernel value of two dense nodes of DIMENSION features
+double svm_kernel_function(const struct svm_node *x, const struct svm_node *y, const struct svm_parameter *param);
 
 void svm_free_model_content(struct svm_model *model_ptr);
 void svm_free_and_destroy_model(struct svm_model **model_ptr_ptr);
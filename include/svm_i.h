@@ -4,6 +4,8 @@
 #include "svm.h"
 #include "color.h"
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 
 class SVM_I : public MLalgo //SVM
@@ -15,7 +17,7 @@ class SVM_I : public MLalgo //SVM
 
 		int max_size;
 
-		MState* raw_mapped_data;
+		// data points to mapped states owned by gsets, see States::getMapped
 		double** data; // [max_items * 2];
 		double* label; // [max_items * 2];
 
@@ -26,7 +28,13 @@ class SVM_I : public MLalgo //SVM
 			int valid_size = problem.l;
 
 			// enlarge max_size exponentially to cover all the data.
+			int previous_max_size = max_size;
 			while (new_size >= max_size) max_size *= 2;
+			// under a memory budget, grow to the exact size needed when doubling does not fit
+			if (!MemoryTracker::reserve(static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double))))
+				max_size = new_size + 1;
+			MemoryTracker::add(MEM_TRAINSET, static_cast<long long>(max_size - previous_max_size)
+					* (sizeof(double*) + sizeof(double)));
 
 			double** new_data = new double*[max_size];
 			memmove(new_data, data, valid_size * sizeof(double**));
@@ -34,17 +42,26 @@ class SVM_I : public MLalgo //SVM
 			data = new_data;
 
 			double* new_label = new double[max_size];
-			memmove(new_label, label, valid_size * sizeof(double*));
-			delete label;
+			memmove(new_label, label, valid_size * sizeof(double));
+			delete []label;
 			label = new_label;
+
+			problem.x = (svm_node**)(data);
+			problem.y = label;
 			return 0;
 		}
 
 	public:
 		svm_problem problem;
-		MState* negative_mapped_data; 
+		// negatives are the mapped states [negative_start, negative_start + negative_size) of negative_set
+		States* negative_set;
+		int negative_start;
 		int negative_size;
 
+		inline double* negative(int i) {
+			return negative_set->getMapped(negative_start + i);
+		}
+
 #ifdef __TRAINSET_SIZE_RESTRICTED
 		SVM_I(int type = 0, void (*f) (const char*) = NULL, int size = restricted_trainset_size+1) : max_size(2 * size) {
 #else
@@ -58,9 +75,12 @@ class SVM_I : public MLalgo //SVM
 				model = NULL;
 				//polys = new Polynomial[max_poly];
 
-				raw_mapped_data = new MState[max_size];
+				// under a memory budget, start small and grow on demand, see resize
+				if (!MemoryTracker::reserve(static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double))))
+					max_size = std::min(max_size, Mitems);
 				data = new double*[max_size];
 				label = new double[max_size];
+				MemoryTracker::add(MEM_TRAINSET, static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double)));
 				for (int i = 0; i < max_size; i++)
 					label[i] = -1;
 				problem.l = 0;
@@ -74,84 +94,72 @@ class SVM_I : public MLalgo //SVM
 
 				etimes = 0;
 				poly_num = 0;
-				negative_mapped_data = new MState[max_size];
+				negative_set = NULL;
+				negative_start = 0;
 				negative_size = 0;
+				for (int j = 0; j < Nv; j++)
+					positive_sum[j] = 0;
 			}
 
 		~SVM_I() {
 			if (model != NULL) svm_free_and_destroy_model(&model);
-#ifdef __PRT_DEBUG
-			std::cout << "SVM_I deleted model\n";
-#endif
-			if (raw_mapped_data != NULL) delete []raw_mapped_data;
-#ifdef __PRT_DEBUG
-			std::cout << "SVM_I deleted raw_mapped_data\n";
-#endif
-			if (negative_mapped_data != NULL) delete []negative_mapped_data;
-#ifdef __PRT_DEBUG
-			std::cout << "SVM_I deleted negative_mapped_data\n";
-#endif
+			IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "SVM_I deleted model\n";
 			if (data != NULL) delete []data;
-#ifdef __PRT_DEBUG
-			std::cout << "SVM_I deleted data\n";
-#endif
+			IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "SVM_I deleted data\n";
 			if (label != NULL) delete []label;
-#ifdef __PRT_DEBUG
-			std::cout << "SVM_I deleted label\n";
-#endif
+			MemoryTracker::sub(MEM_TRAINSET, static_cast<long long>(max_size) * (sizeof(double*) + sizeof(double)));
+			IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "SVM_I deleted label\n";
 		}
 
 		int makeTrainingSet(States* gsets, int& pre_psize, int& pre_nsize) {
+			std::lock_guard<std::mutex> lock(current_context->states_mutex);
 			int cur_psize = gsets[POSITIVE].getSize();
 			int cur_nsize = gsets[NEGATIVE].getSize();
+			// only the states added since last call are mapped here
+			gsets[POSITIVE].ensureMapped();
+			gsets[NEGATIVE].ensureMapped();
+			negative_set = &gsets[NEGATIVE];
 
-			//if (cur_psize + 1 >= max_size)
-			//	resize(cur_psize + 1);
-
-#ifdef __PRT
-			std::cout << "++[" << cur_psize - pre_psize << "|"
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "++[" << cur_psize - pre_psize << "|"
 				<< cur_nsize - pre_nsize  << "] ==> ["
 				<< cur_psize << "+|" << cur_nsize << "-]";
-#endif
 
 			int ret = cur_psize + cur_nsize - pre_psize - pre_nsize;
 #ifdef __TRAINSET_SIZE_RESTRICTED
 			int pstart = cur_psize > restricted_trainset_size ? cur_psize - restricted_trainset_size : 0;
 			int plength = cur_psize - pstart;
+			for (int j = 0; j < Nv; j++)
+				positive_sum[j] = 0;
 			for (int i = 0; i < plength; i++) {
-				mappingData(gsets[POSITIVE].values[pstart + i], raw_mapped_data[i], 4);
-				data[i] = raw_mapped_data[i];
+				data[i] = gsets[POSITIVE].getMapped(pstart + i);
 				label[i] = 1;
+				for (int j = 0; j < Nv; j++)
+					positive_sum[j] += data[i][j];
 			}
 			int nstart = cur_nsize > restricted_trainset_size ? cur_nsize - restricted_trainset_size : 0;
 			int nlength = cur_nsize - nstart;
-			for (int i = 0; i < nlength; i++) {
-				mappingData(gsets[NEGATIVE].values[nstart + i], negative_mapped_data[i], 4);
-			}
+			negative_start = nstart;
 			negative_size = nlength;
 			pre_psize = cur_psize;
 			pre_nsize = cur_nsize;
 			cur_psize = plength;
 			cur_nsize = nlength;
-#ifdef __PRT
-			std::cout << RED << " RESTRICTED[" << cur_psize << "+|" << cur_nsize << "-]" << NORMAL;
-#endif
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << " RESTRICTED[" << cur_psize << "+|" << cur_nsize << "-]" << NORMAL;
 			ret = plength + nlength;
 #else
 			// prepare new training data set
 			// training set & label layout:
 			// data :  0 | positive states ...
 			// add new positive states at OFFSET: [pre_psize]
-			int cur_index = pre_psize;
-			for (int i = 0; i < cur_psize - pre_psize; i++) {
-				mappingData(gsets[POSITIVE].values[pre_psize + i], raw_mapped_data[cur_index + i], 4);
-				data[cur_index + i] = raw_mapped_data[cur_index + i];
-				label[cur_index + i] = 1;
-			}
-			cur_index = pre_nsize;
-			for (int i = 0; i < cur_nsize - pre_nsize; i++) {
-				mappingData(gsets[NEGATIVE].values[pre_nsize + i], negative_mapped_data[cur_index + i], 4);
+			if (cur_psize + Mviolators_per_step >= max_size)
+				resize(cur_psize + Mviolators_per_step);
+			for (int i = pre_psize; i < cur_psize; i++) {
+				data[i] = gsets[POSITIVE].getMapped(i);
+				label[i] = 1;
+				for (int j = 0; j < Nv; j++)
+					positive_sum[j] += data[i][j];
 			}
+			negative_start = 0;
 			negative_size = cur_nsize;
 			pre_psize = cur_psize;
 			pre_nsize = cur_nsize;
@@ -166,38 +174,76 @@ class SVM_I : public MLalgo //SVM
 			return ret;
 		}
 
+		/** @brief put back the training set of a resumed learner, see BaseLearner::loadRounds.
+		 *		   It is made of the first psize positive and nsize negative states, as makeTrainingSet left it.
+		 */
+		bool loadTrainingSet(States* gsets, int psize, int nsize) {
+			std::lock_guard<std::mutex> lock(current_context->states_mutex);
+			gsets[POSITIVE].ensureMapped();
+			gsets[NEGATIVE].ensureMapped();
+			if ((psize > gsets[POSITIVE].getMappedSize()) || (nsize > gsets[NEGATIVE].getMappedSize()))
+				return false;
+			negative_set = &gsets[NEGATIVE];
+#ifndef __TRAINSET_SIZE_RESTRICTED
+			// a restricted training set is rebuilt as a whole by each makeTrainingSet
+			if (psize + Mviolators_per_step >= max_size)
+				resize(psize + Mviolators_per_step);
+			for (int j = 0; j < Nv; j++)
+				positive_sum[j] = 0;
+			for (int i = 0; i < psize; i++) {
+				data[i] = gsets[POSITIVE].getMapped(i);
+				label[i] = 1;
+				for (int j = 0; j < Nv; j++)
+					positive_sum[j] += data[i][j];
+			}
+			negative_start = 0;
+			negative_size = nsize;
+#ifdef __DS_ENABLED
+			problem.np = psize;
+			problem.nn = nsize;
+#endif
+			problem.l = psize;
+#endif
+			return true;
+		}
+
 
 		int train() {
-			if (problem.y == NULL || problem.x == NULL || negative_mapped_data == NULL) return -1;
+			if (problem.y == NULL || problem.x == NULL || negative_set == NULL) return -1;
 
 			for (cl.size = 0; cl.size < cl.max_size;) {
-				int misidx = -1;
-				int ret = getMisclassified(misidx);
+				int ret = getMisclassified(cluster);
 				if (ret == -1) return -1;  // something wrong in misclassified.
-				if ((ret == 0) && (misidx == -1)) {	// can divide all the negative points correctly
+				if ((ret == 0) && cluster.empty()) {	// can divide all the negative points correctly
 
-#ifdef __PRT_SVM_I
-					std::cout << GREEN << "finish classified..." << NORMAL << std::endl;
-#endif				
+					IIF_LOG(LOG_SVM_I, LOG_DEBUG) << GREEN << "finish classified..." << NORMAL << std::endl;
 					cl.simplify();
 					//cl.roundoff();
 					return 0;
 				}
 
-#ifdef __PRT_SVM_I
-				std::cout << "." << cl.size << ">"; // << std::endl;
-#endif
-				// there is some point which is misclassified by current dividers.
-				if (stepTrain(misidx) < 0) {
-					std::cout << "Can not classify state [index" << misidx << "](" << negative_mapped_data[misidx][0];
-					for (int i = 1; i < Nv; i++) {
-						std::cout << ", " << negative_mapped_data[misidx][i];
+				IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "." << cl.size << ">"; // << std::endl;
+				// there are some points which are misclassified by current dividers.
+				// try to cut them off together, and halve the cluster until one conjunct can do it.
+				int stepped = -1;
+				while (!cluster.empty()) {
+					stepped = stepTrain(cluster);
+					if ((stepped >= 0) || (cluster.size() == 1)) break;
+					cluster.resize(cluster.size() / 2);
+				}
+				if (stepped < 0) {
+					int misidx = cluster[0];
+					if (Logger::enabled(LOG_SVM_I, LOG_INFO)) {
+						LogRecord record(LOG_INFO);
+						record.stream() << "Can not classify state [index" << misidx << "](" << negative(misidx)[0];
+						for (int i = 1; i < Nv; i++)
+							record.stream() << ", " << negative(misidx)[i];
+						record.stream() << ") against other " << problem.l << " positive states.\n";
 					}
-					std::cout << ") against other " << problem.l << " positive states.\n";
 					return -1;
 				}
 			}
-			std::cout << RED << "Can not divide all the data by SVM-I with"
+			IIF_LOG(LOG_SVM_I, LOG_INFO) << RED << "Can not divide all the data by SVM-I with"
 				" equations number limit to " << cl.size  << "." << NORMAL << std::endl;
 			//std::cerr << RED << "You need to increase the limit by modifying [classname::methodname]"
 			//	"=SVM-I::SVM-I(..., int equ = **) " << NORMAL << std::endl;
@@ -206,6 +252,7 @@ class SVM_I : public MLalgo //SVM
 
 		double checkTrainingSet()
 		{
+			PROFILE_SCOPE(PHASE_CHECK);
 			int total = problem.l + negative_size;
 			int pass = 0;
 			for (int i = 0; i < problem.l; i++) {
@@ -217,22 +264,22 @@ class SVM_I : public MLalgo //SVM
 				   */
 				int presult = predict((double*)problem.x[i]);
 				if (presult == 0) {
-					std::cout << "predict error in checkTrainingSet function.\n";
+					IIF_LOG(LOG_SVM_I, LOG_INFO) << "predict error in checkTrainingSet function.\n";
 					return 0;
 				}
 				pass += (presult == 1) ? 1 : 0;
 			}
 			for (int i = 0; i < negative_size; i++) {
 				/*
-				   std::cout << negative_mapped_data[i][0];
+				   std::cout << negative(i)[0];
 				   for (int j = 1; j < Nv; j++)
-				   std::cout << "," << negative_mapped_data[i][j];
-				   std::cout << GREEN << "-1" << "->" << predict(negative_mapped_data[i]) << NORMAL << " ";
+				   std::cout << "," << negative(i)[j];
+				   std::cout << GREEN << "-1" << "->" << predict(negative(i)) << NORMAL << " ";
 				   */
-				//pass += (predict(negative_mapped_data[i]) < 0) ? 1 : 0;
-				int presult = predict(negative_mapped_data[i]);
+				//pass += (predict(negative(i)) < 0) ? 1 : 0;
+				int presult = predict(negative(i));
 				if (presult == 0) {
-					std::cout << "predict error in checkTrainingSet function.\n";
+					IIF_LOG(LOG_SVM_I, LOG_INFO) << "predict error in checkTrainingSet function.\n";
 					return 0;
 				}
 				pass += (presult == -1) ? 1 : 0;
@@ -243,25 +290,18 @@ class SVM_I : public MLalgo //SVM
 
 		bool pointwiseSimplify()
 		{
-#ifdef __PRT_DEBUG
-			std::cout << "point wise simplify classifiers...\n";
-#endif
+			PROFILE_SCOPE(PHASE_SIMPLIFY);
+			IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "point wise simplify classifiers...\n";
 			for(int i = 0; i < cl.size; i++) {
-#ifdef __PRT_DEBUG
-				std::cout << "try [" << i << "] " << cl.polys[i] << "-->";
-#endif
+				IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "try [" << i << "] " << cl.polys[i] << "-->";
 				if (cl.size <= 1) return true;
 				if(partialCheckTrainingSet(i) == 1) {
 					cl.polys[i--] = cl.polys[--cl.size];
-#ifdef __PRT_DEBUG
-					std::cout << RED << "removed\n" << NORMAL;
-#endif
+					IIF_LOG(LOG_SVM_I, LOG_DEBUG) << RED << "removed\n" << NORMAL;
 				}
-#ifdef __PRT_DEBUG
 				else {
-					std::cout << GREEN << "keeped.\n" << NORMAL;
+					IIF_LOG(LOG_SVM_I, LOG_DEBUG) << GREEN << "keeped.\n" << NORMAL;
 				}
-#endif
 			}
 			return true;
 		}
@@ -273,15 +313,15 @@ class SVM_I : public MLalgo //SVM
 			for (int i = 0; i < problem.l; i++) {
 				int presult = partialPredict((double*)problem.x[i], removed_cl);
 				if (presult == 0) {
-					std::cout << "predict error in partialCheckTrainingSet function.\n";
+					IIF_LOG(LOG_SVM_I, LOG_INFO) << "predict error in partialCheckTrainingSet function.\n";
 					return 0;
 				}
 				pass += (presult == 1) ? 1 : 0;
 			}
 			for (int i = 0; i < negative_size; i++) {
-				int presult = partialPredict(negative_mapped_data[i], removed_cl);
+				int presult = partialPredict(negative(i), removed_cl);
 				if (presult == 0) {
-					std::cout << "predict error in partialCheckTrainingSet function.\n";
+					IIF_LOG(LOG_SVM_I, LOG_INFO) << "predict error in partialCheckTrainingSet function.\n";
 					return 0;
 				}
 				pass += (presult == -1) ? 1 : 0;
@@ -290,41 +330,36 @@ class SVM_I : public MLalgo //SVM
 		}
 
 		int checkQuestionTraces(States& qset) {
-#ifdef __PRT
-			std::cout << " [" << qset.traces_num() << "]";
-#endif
+			std::lock_guard<std::mutex> lock(current_context->states_mutex);
+			bool debug = Logger::enabled(LOG_LEARN, LOG_DEBUG);
+			// the whole check is one message, which is written on return
+			LogRecord record(LOG_DEBUG);
+			std::ostream& out = record.stream();
+			if (debug) out << " [" << qset.traces_num() << "]";
 			for (int i = 0; i < qset.p_index; i++) {
 				int pre = -1, cur = 0;
-#ifdef __PRT
-				std::cout << ".";
-#endif
+				if (debug) out << ".";
 				for (int j = qset.t_index[i]; j < qset.t_index[i + 1]; j++) {
 					cur = predict(qset.values[j]);
 					//std::cout << ((cur >= 0) ? "+" : "-");
 					if ((pre >= 0) && (cur < 0)) {
 						// deal with wrong question trace.
 						// Trace back to print out the whole trace and the predicted labels.
-#ifdef __PRT
-						std::cerr << RED << "\t[FAIL]\n \t  Predict wrongly on Question traces.\n";
-						qset.dumpTrace(i);
-#endif
-						for (int j = qset.t_index[i]; j < qset.t_index[i + 1]; j++) {
-							cur = predict(qset.values[j]);
-#ifdef __PRT
-							std::cout << ((cur >= 0) ? "+" : "-");
-#endif
+						if (debug) {
+							out << RED << "\t[FAIL]\n \t  Predict wrongly on Question traces.\n";
+							qset.dumpTrace(i, out);
+							for (int j = qset.t_index[i]; j < qset.t_index[i + 1]; j++) {
+								cur = predict(qset.values[j]);
+								out << ((cur >= 0) ? "+" : "-");
+							}
+							out << std::endl << NORMAL;
 						}
-#ifdef __PRT
-						std::cout << std::endl << NORMAL;
-#endif
 						return -1;
 					}
 					pre = cur;
 				}
 			}
-#ifdef __PRT
-			std::cout << " [PASS]";
-#endif
+			if (debug) out << " [PASS]";
 			return 0;
 		}
 
@@ -339,17 +374,13 @@ class SVM_I : public MLalgo //SVM
 					if ((similar_vector[j] == false) && (cl[i]->isSimilar(*pre_cl[j]) == true))  {	
 						// the equation in last has not been set
 						// and it is similar to the current equation 
-#ifdef __PRT
-						std::cout << GREEN <<  "<" << i << ":" << j << ">" << NORMAL;
-#endif 
+						IIF_LOG(LOG_LEARN, LOG_DEBUG) << GREEN <<  "<" << i << ":" << j << ">" << NORMAL;
 						similar_vector[j] = true;
 						break;
 					} 
-#ifdef __PRT
 					else {
-						std::cout << RED << "<" << i << ":" << j << ">" << NORMAL;
+						IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "<" << i << ":" << j << ">" << NORMAL;
 					}
-#endif 
 				}
 			}
 			for (int i = 0; i < pre_cl.size; i++) {
@@ -430,74 +461,91 @@ class SVM_I : public MLalgo //SVM
 	private:
 		double checkStepTrainingData() {
 			int pass = 0;
+			bool debug = Logger::enabled(LOG_SVM_I, LOG_DEBUG);
+			LogRecord record(LOG_DEBUG);
 			for (int i = 0; i < problem.l; i++) {
 				pass += (predict((double*)(problem.x[i])) * problem.y[i] >= 0) ? 1 : 0;
-#ifdef __PRT_SVM_I
-				double predict_result = predict((double*)(problem.x[i]));
-				if (predict_result * problem.y[i] < 0) {
-					std::cout << RED << "Predict fault on: [" << problem.x[i][0];
-					for (int j = 1; j < Nv; j++)
-						std::cout << "," << problem.x[i][j];
-					std::cout << "]" << predict_result << ":" << problem.y[i] << NORMAL;
+				if (debug) {
+					double predict_result = predict((double*)(problem.x[i]));
+					if (predict_result * problem.y[i] < 0) {
+						record.stream() << RED << "Predict fault on: [" << problem.x[i][0];
+						for (int j = 1; j < Nv; j++)
+							record.stream() << "," << problem.x[i][j];
+						record.stream() << "]" << predict_result << ":" << problem.y[i] << NORMAL;
+					}
 				}
-#endif
 			}
-#ifdef __PRT_SVM_I
-			std::cout << "\t";
-			std::cout << "\nCheck on training set result: " << pass << "/" << problem.l << "..";
-#endif
+			if (debug)
+				record.stream() << "\t" << "\nCheck on training set result: " << pass << "/" << problem.l << "..";
 			return (double)pass / problem.l;
 		}
 
-		int stepTrain(int negative_index) {
-			if ((negative_index < 0) || (negative_index >= negative_size))
+		/** @brief train one more conjunct which separates the given negatives from all the positives
+		 *	@param negatives indices of negative states, at most Mviolators_per_step of them
+		 *	@return int 0 if such a conjunct is found and added to cl, -1 otherwise
+		 */
+		int stepTrain(const std::vector<int>& negatives) {
+			int added = negatives.size();
+			if ((added <= 0) || (added > Mviolators_per_step))
 				return -1;
-			label[problem.l] = -1;
-			data[problem.l] = negative_mapped_data[negative_index];
-			problem.l++;
+			for (int i = 0; i < added; i++) {
+				if ((negatives[i] < 0) || (negatives[i] >= negative_size))
+					return -1;
+			}
+			for (int i = 0; i < added; i++) {
+				label[problem.l] = -1;
+				data[problem.l] = negative(negatives[i]);
+				problem.l++;
+			}
 
-#ifdef __PRT_SVM_I
-			std::cout << " NEW TRAINING SET:";
-			for (int i = 0; i < problem.l; i++) {
-				std::cout << "(" << problem.x[i][0].value;
-				for (int j = 1; j < Nv; j++)
-					std::cout << "," << problem.x[i][j].value;
-				std::cout << ")";
-				if (problem.y[i] == 1) std::cout << "+";
-				if (problem.y[i] == -1) std::cout << "-";
-				std::cout << "|";
+			if (Logger::enabled(LOG_SVM_I, LOG_DEBUG)) {
+				LogRecord record(LOG_DEBUG);
+				record.stream() << " NEW TRAINING SET:";
+				for (int i = 0; i < problem.l; i++) {
+					record.stream() << "(" << problem.x[i][0].value;
+					for (int j = 1; j < Nv; j++)
+						record.stream() << "," << problem.x[i][j].value;
+					record.stream() << ")";
+					if (problem.y[i] == 1) record.stream() << "+";
+					if (problem.y[i] == -1) record.stream() << "-";
+					record.stream() << "|";
+				}
+				record.stream() << std::endl;
 			}
-			std::cout << std::endl;
-#endif			
 
 			double precision = 0;
 			int et;
 			for (et = 1; et <= 4; et++) {
 				setEtimes(et);
-				model = svm_train(&problem, &param);
+				{
+					PROFILE_SCOPE(PHASE_SVM_TRAIN);
+					model = svm_train(&problem, &param);
+				}
 				Polynomial poly;
 				svm_model_visualization(model, &poly);
 				//cl += poly;
 				if (cl.add(poly, CONJUNCT) <= 0) {
-					std::cout << "Exceed the max number of polynomials.\n";
+					IIF_LOG(LOG_SVM_I, LOG_INFO) << "Exceed the max number of polynomials.\n";
+					svm_free_and_destroy_model(&model);
+					problem.l -= added;
 					return -1;
 				}
 				precision = checkStepTrainingData();
 				svm_free_and_destroy_model(&model);
 
-#ifdef __PRT_SVM_I
-				std::cout << GREEN <<  poly << "\n" << NORMAL;
-				//std::cout << cl;
-				std::cout << " precision=[" << precision * 100 << "%]." << std::endl;
-				if (precision < 1) {
-					std::cout << "[" << problem.x[problem.l - 1][0].value;
-					for (int j = 1; j < Nv; j++)
-						std::cout << "," << problem.x[problem.l - 1][j].value;
-					std::cout << "] " << problem.y[problem.l - 1] << " --> ";
-					std::cout << poly << " ";
-					std::cout << " --> precision=[" << precision * 100 << "%]." << std::endl;
+				if (Logger::enabled(LOG_SVM_I, LOG_DEBUG)) {
+					LogRecord record(LOG_DEBUG);
+					record.stream() << GREEN <<  poly << "\n" << NORMAL;
+					//std::cout << cl;
+					record.stream() << " precision=[" << precision * 100 << "%]." << std::endl;
+					if (precision < 1) {
+						record.stream() << "[" << problem.x[problem.l - 1][0].value;
+						for (int j = 1; j < Nv; j++)
+							record.stream() << "," << problem.x[problem.l - 1][j].value;
+						record.stream() << "] " << problem.y[problem.l - 1] << " --> " << poly << " "
+							<< " --> precision=[" << precision * 100 << "%]." << std::endl;
+					}
 				}
-#endif
 				//if (precision < 1) std::cout << "CAN NOT DIVIDE THE PICKED NEGATIVE FROM POSITIVES...\n";
 				//std::cout << "\n On whole set precision: " << predictOnProblem() * 100 << "%\n";
 				//std::cout << " <et=" << et << ",Precision=" << precision << ",cl.size=" << cl.size << ">" << cl;
@@ -506,9 +554,9 @@ class SVM_I : public MLalgo //SVM
 				cl.size--;
 			}
 			//std::cin.get();
-			problem.l--;
+			problem.l -= added;
 			if (et > 4) {
-				std::cout << "et = " << et << "\n";
+				IIF_LOG(LOG_SVM_I, LOG_INFO) << "et = " << et << "\n";
 				return -1;
 			}
 			//cl.resolveUniImplication();
@@ -519,37 +567,104 @@ class SVM_I : public MLalgo //SVM
 			return 0;
 		}
 
-		// negative points may be misclassified.
-		int getMisclassified(int& idx) {
-			idx = 0;
+		/// theta[0] + theta[1..n] * row[0..n-1], unrolled so that the compiler can vectorize it
+		static inline double evaluateMapped(const double* theta, const double* row, int n) {
+			double s0 = theta[0], s1 = 0, s2 = 0, s3 = 0;
+			const double* t = theta + 1;
+			int k = 0;
+			for (; k + 4 <= n; k += 4) {
+				s0 += t[k] * row[k];
+				s1 += t[k + 1] * row[k + 1];
+				s2 += t[k + 2] * row[k + 2];
+				s3 += t[k + 3] * row[k + 3];
+			}
+			for (; k < n; k++)
+				s0 += t[k] * row[k];
+			return (s0 + s1) + (s2 + s3);
+		}
+
+		static inline double distance2(const double* a, const double* b) {
+			double d = 0;
+			for (int i = 0; i < Nv; i++)
+				d += (a[i] - b[i]) * (a[i] - b[i]);
+			return d;
+		}
+
+		/** @brief find the negative states which are accepted by the current conjunction.
+		 *
+		 *	All the negatives are evaluated against one conjunct at a time,
+		 *	and only those still accepted are kept for the next conjunct.
+		 *	The violator closest to the center of positives is picked as seed,
+		 *	so that the next conjunct lies tight against the positives and cuts off the most violators.
+		 *	The seed and its nearest violators form the cluster to be trained next.
+		 *
+		 *	@param cluster set by callee, at most Mviolators_per_step negative indices, empty if none is misclassified
+		 *	@return int 0 if no error
+		 */
+		int getMisclassified(std::vector<int>& cluster) {
+			cluster.clear();
 			if (cl.size < 0) return -1;
-			if (cl.size == 0) return 0;
 
-			//int start = rand() % negative_size;
-			int start = 0;
-			for (int i = 0; i < negative_size; i++) {
-				int k = (i + start) % negative_size;
-				if (predict(negative_mapped_data[k]) >= 0) {
-#ifdef __PRT_SVM_I
-					std::cout << "\n [FAIL] @" << k << ": (" << negative_mapped_data[k][0];
-					for (int j = 1; j < Nv; j++)
-						std::cout << "," << negative_mapped_data[k][j];
-					std::cout << ")  \t add it to training set... ==>" << std::endl;
-#endif
-					//std::cout << RED << "x@" << k << " " << NORMAL;
-					idx = k;
-					return 0;
+			violators.resize(negative_size);
+			for (int i = 0; i < negative_size; i++)
+				violators[i] = i;
+			int alive = negative_size;
+			for (int c = 0; (c < cl.size) && (alive > 0); c++) {
+				const double* theta = cl[c]->theta;
+				int n = cl[c]->getDims() - 1;
+				int kept = 0;
+				for (int i = 0; i < alive; i++) {
+					int k = violators[i];
+					if (evaluateMapped(theta, negative(k), n) >= 0)
+						violators[kept++] = k;
 				}
+				alive = kept;
 			}
 
-			// there should be no negatives misclassified.
-#ifdef __PRT_SVM_I
-			std::cout << "\n [PASS] @all";
-#endif
-			idx = -1;
-			//std::cout << RED << "x@" << -1 << " " << NORMAL;
+			if (alive == 0) {
+				IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "\n [PASS] @all";
+				return 0;
+			}
+
+			double center[Nv];
+			for (int j = 0; j < Nv; j++)
+				center[j] = (problem.l > 0) ? positive_sum[j] / problem.l : 0;
+			int seed_index = violators[0];
+			double seed_distance = distance2(center, negative(seed_index));
+			for (int i = 1; i < alive; i++) {
+				double d = distance2(center, negative(violators[i]));
+				if (d < seed_distance) {
+					seed_distance = d;
+					seed_index = violators[i];
+				}
+			}
+			const double* seed = negative(seed_index);
+			int num = (alive < Mviolators_per_step) ? alive : Mviolators_per_step;
+			distances.resize(alive);
+			for (int i = 0; i < alive; i++)
+				distances[i] = std::make_pair(distance2(seed, negative(violators[i])), violators[i]);
+			if (num < alive)
+				std::nth_element(distances.begin(), distances.begin() + num - 1, distances.end());
+			std::sort(distances.begin(), distances.begin() + num);
+			for (int i = 0; i < num; i++)
+				cluster.push_back(distances[i].second);
+
+			if (Logger::enabled(LOG_SVM_I, LOG_DEBUG)) {
+				LogRecord record(LOG_DEBUG);
+				record.stream() << "\n [FAIL] " << alive << " misclassified, @" << cluster[0] << ": (" << seed[0];
+				for (int j = 1; j < Nv; j++)
+					record.stream() << "," << seed[j];
+				record.stream() << ")  \t add " << num << " of them to training set... ==>" << std::endl;
+			}
 			return 0;
 		}
+
+		// sum of all positive states in the training set, kept up to date by makeTrainingSet
+		double positive_sum[Nv];
+		// buffers reused by train and getMisclassified
+		std::vector<int> cluster;
+		std::vector<int> violators;
+		std::vector<std::pair<double, int> > distances;
 };
 
 #endif /* _SVM_I_H */
@@ -0,0 +1,101 @@
+/** @file time_budget.h
+ *  @brief The wall-clock budget of a run, shared cooperatively by its learners and their rounds.
+ *
+ *  iifContext::learn starts the budget with its timeout, see iifContext::setTimeBudget.
+ *  Each learner is given a slice of what remains, split evenly among the learners not run yet,
+ *  so the time a learner does not use goes to the next ones. A learner checks its slice
+ *  at the beginning of each round, and gives up once it is over, see BaseLearner::outOfTime.
+ *
+ *  Within a slice, each round is left an equal share of the rounds the learner still needs to converge.
+ *  The share is spent on sampling and on training (training includes checking the classifier).
+ *  The cost of one execution of the target and the training time of the last round are measured,
+ *  and the samples of the round are reduced when the samples asked for would not fit into what the
+ *  training leaves, see BaseLearner::budgetSamples. Far from the deadline nothing is reduced,
+ *  so a run which fits into its budget draws the same samples as without one.
+ *
+ *  The SVM solver stops at the end of the slice as well, as if it reached its maximum number of iterations,
+ *  see TimeBudget::overdue.
+ *
+ *  Each classifier separating its whole training set is offered as a candidate. The budget keeps the best one,
+ *  i.e. the one converged the most rounds in a row, the latest on a tie, which learn() writes out
+ *  if the budget runs out before any learner succeeds.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#ifndef _TIME_BUDGET_H_
+#define _TIME_BUDGET_H_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+class BaseLearner;
+
+class TimeBudget {
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		TimeBudget();
+
+		/** @brief start the budget of a run, and forget the candidate of the previous one
+		 *	@param seconds 0 or less for no budget
+		 */
+		void start(double seconds);
+
+		bool limited() const {
+			return is_limited;
+		}
+
+		/// the seconds left, a large number if there is no budget
+		double remaining() const;
+
+		bool expired() const {
+			return is_limited && (Clock::now() >= deadline);
+		}
+
+		/// the end of the slice of a learner, when learners are still to run including it
+		Clock::time_point slice(int learners) const;
+
+		/// a round executed the target samples times in seconds
+		void recordSampling(int samples, double seconds);
+
+		/// the seconds of one execution of the target on average, 0 until it is measured
+		double sampleCost() const;
+
+		/** @brief offer the classifier of a learner, which separates its training set, as a candidate
+		 *	@param converged_time the number of rounds in a row it has been the same
+		 */
+		void offer(BaseLearner* learner, const std::string& candidate, int converged_time);
+
+		/// the best candidate offered, and its learner, false if there is none
+		bool best(BaseLearner*& learner, std::string& candidate) const;
+
+		/// set the end of the slice of the learner running on the calling thread, see BaseLearner::beginRound
+		static void setThreadDeadline(Clock::time_point end) {
+			thread_deadline = end;
+		}
+
+		/// whether the learner running on the calling thread is out of its slice, checked by the SVM solver
+		static bool overdue() {
+			return (thread_deadline != Clock::time_point::max()) && (Clock::now() >= thread_deadline);
+		}
+
+	private:
+		static thread_local Clock::time_point thread_deadline;
+
+		bool is_limited;
+		Clock::time_point deadline;
+
+		mutable std::mutex mutex;
+		/// the cost of one execution, as a moving average over the rounds
+		double sample_cost;
+		BaseLearner* best_learner;
+		std::string best_candidate;
+		int best_converged;
+
+		TimeBudget(const TimeBudget&);
+		TimeBudget& operator= (const TimeBudget&);
+};
+
+#endif
@@ -0,0 +1,146 @@
+#!/bin/bash
+red="\e[31m"
+green="\e[32m"
+yellow="\e[33m"
+blue="\e[34m"
+bold="\e[1m"
+normal="\e[0m"
+
+##########################################################################
+# A cache of the invariants verified, so that an unchanged loop is not learnt again.
+#
+# An entry is keyed by the content of the cfg, with its blanks collapsed and its empty lines dropped,
+# the sampling parameter of the run, and the version of the engine, i.e. a hash of the sources
+# which make the invariant candidate (src/, include/ and the tools building the target).
+# It is the folder <cache>/<key>/, which holds
+#	inv		the invariant
+#	var		the variables file of the loop, used by verify.sh
+#	status	"proved", the version of the verifier which proved it, and the date
+# where the version of the verifier is a hash of verify.sh, its tools and klee.
+#
+# ./result_cache.sh lookup cfg_prefix [sampling]
+#	writes the invariant of the entry into tmp/<prefix>.inv, and exits with
+#	0 if the entry is proved by this verifier, 3 if by another one, so that only verify.sh has to run again,
+#	1 if there is no entry.
+# ./result_cache.sh store cfg_prefix [sampling]
+#	stores tmp/<prefix>.inv once verify.sh proved it.
+#
+# The cache is the folder IIF_RESULT_CACHE, where 1 stands for tmp/cache.
+# run_once.sh and run_iterative.sh use it when IIF_RESULT_CACHE is set.
+##########################################################################
+if [ $# -lt 2 ]
+then
+	echo "./result_cache.sh needs more parameters"
+	echo "./result_cache.sh lookup|store cofig_prefix [sampling]"
+	echo "try it again..."
+	exit 1
+fi
+
+dir_cfg="cfg/"
+dir_temp="tmp/"
+dir_tool="tools/"
+
+command=$1
+prefix=$2
+sampling=$3
+file_cfg=$prefix".cfg"
+path_cfg=$dir_cfg""$file_cfg
+path_var=$dir_temp""$prefix".var"
+path_inv=$dir_temp""$prefix".inv"
+
+dir_cache=$IIF_RESULT_CACHE
+if [ -z "$dir_cache" ] || [ "$dir_cache" = "1" ]; then
+	dir_cache=$dir_temp"cache"
+fi
+
+
+# the cfg with its blanks collapsed and its empty lines dropped, so that its layout does not change the key
+function func_normalizedCfg(){
+sed 's/[[:space:]]\+/ /g; s/^ //; s/ $//' $path_cfg | grep -v '^$'
+}
+
+# the version of the engine, a hash of the sources which make the invariant candidate
+function func_engineVersion(){
+cat src/*.cpp $(ls include/*.h | grep -v '/config.h$') config.h.in cmake.in \
+	tools/src/cfg2test.cpp tools/src/cfg2init.cpp build_project.sh gen_init.sh 2>/dev/null | sha1sum | cut -d' ' -f1
+}
+
+# the version of the verifier, a hash of verify.sh, the tools it runs and the version of klee
+function func_verifierVersion(){
+(
+	cat verify.sh $dir_tool"smt2_bv2int.sh" $dir_tool"src/cfg2verif.cpp" $dir_tool"src/smt2solver.cpp" \
+		$dir_tool"src/model_parser.cpp" 2>/dev/null
+	if command -v klee > /dev/null 2>&1; then
+		klee --version 2>&1 | head -n 3
+	fi
+) | sha1sum | cut -d' ' -f1
+}
+
+function func_key(){
+(
+	func_normalizedCfg
+	echo "sampling="$sampling
+	echo "engine="$(func_engineVersion)
+) | sha1sum | cut -d' ' -f1
+}
+
+
+if [ ! -f $path_cfg ]; then
+	echo -e $red$bold"Can not find "$path_cfg$normal
+	exit 1
+fi
+mkdir -p $dir_temp
+entry=$dir_cache"/"$(func_key)
+
+##########################################################################
+# look up the invariant of the loop
+##########################################################################
+if [ "$command" = "lookup" ]; then
+	if [ ! -s $entry"/inv" ] || [ ! -s $entry"/status" ]; then
+		exit 1
+	fi
+	cp $entry"/inv" $path_inv
+	cp $entry"/var" $path_var 2>/dev/null
+	read status verifier proved_at < $entry"/status"
+	if [ "$status" != "proved" ]; then
+		exit 1
+	fi
+	echo -n -e $blue"Found the invariant of the loop in "$entry" >>> "$normal
+	cat $path_inv
+	echo ""
+	if [ "$verifier" != "$(func_verifierVersion)" ]; then
+		echo -e $yellow"It was proved by another verifier, verifying it again..."$normal
+		exit 3
+	fi
+	echo -e $green"It was proved at "$proved_at", the invariant can be "$yellow
+	cat $path_inv
+	echo -e "\n"$normal
+	exit 0
+fi
+
+##########################################################################
+# store the invariant just proved by verify.sh
+##########################################################################
+if [ "$command" = "store" ]; then
+	if [ ! -s $path_inv ]; then
+		exit 1
+	fi
+	# written aside and moved in place, so that concurrent runs never read half an entry
+	mkdir -p $dir_cache
+	entry_tmp=$(mktemp -d $dir_cache"/.entry.XXXXXX")
+	chmod 755 $entry_tmp
+	cp $path_inv $entry_tmp"/inv"
+	cp $path_var $entry_tmp"/var" 2>/dev/null
+	echo "proved "$(func_verifierVersion)" "$(date +%Y-%m-%dT%H:%M:%S) > $entry_tmp"/status"
+	rm -rf $entry
+	mv $entry_tmp $entry
+	if [ $? -ne 0 ]; then
+		rm -rf $entry_tmp
+		exit 1
+	fi
+	echo -e $blue"The invariant is stored in "$entry$normal
+	exit 0
+fi
+
+echo "./result_cache.sh: unknown command "$command
+exit 1
@@ -43,13 +43,38 @@ path_dataset=$dir_temp""$file_dataset
 #rm -f $path_cnt
 rm -f $path_dataset
 rm -f $path_cnt_lib
+# the verification results memoized by verify.sh hold for this run only
+rm -rf $dir_temp""$prefix".vc"
+# profile and timeline of this run, see include/profiler.h
+rm -f $dir_temp""$prefix".prof.csv"
+rm -f $dir_temp""$prefix".trace.json"
 
 ##########################################################################
 # BEGINNING 
 ##########################################################################
-cd tools
-./make_tools.sh
-cd ..
+# bench_suite.sh builds the tools once for all the jobs it runs at the same time
+if [ -z "$IIF_PREBUILT_TOOLS" ]; then
+	cd tools
+	./make_tools.sh
+	cd ..
+fi
+
+# with IIF_RESULT_CACHE set, an unchanged loop takes its invariant from the cache, see result_cache.sh
+# an invariant proved by another verifier is only verified again
+if [ -n "$IIF_RESULT_CACHE" ] && [ $# -lt 3 ]; then
+	./result_cache.sh lookup $prefix $2
+	cache_ret=$?
+	if [ $cache_ret -eq 0 ]; then
+		exit 0
+	fi
+	if [ $cache_ret -eq 3 ]; then
+		./verify.sh $prefix
+		if [ $? -eq 0 ]; then
+			./result_cache.sh store $prefix $2
+			exit 0
+		fi
+	fi
+fi
 
 ./build_project.sh $prefix $path_cnt $path_dataset $2
 
@@ -68,6 +93,8 @@ fi
 
 
 iteration=1
+# with IIF_SEED set, the whole run is repeatable, while each iteration still samples differently
+seed_base=$IIF_SEED
 echo -e $blue"Running the project to generate invariant candidiate..."$normal
 while [ $iteration -le 128 ]; do
 	echo -n -e $green$bold"--------------------------------------------- Iteration "
@@ -77,6 +104,9 @@ while [ $iteration -le 128 ]; do
 	# Run the target to get Invariant Candidates
 	##########################################################################
 	cd build
+	if [ -n "$seed_base" ]; then
+		export IIF_SEED=$(($seed_base + $iteration - 1))
+	fi
 	./$prefix
 	ret=$?
 	if [ $ret -ne 0 ]; then
@@ -91,6 +121,9 @@ while [ $iteration -le 128 ]; do
 	#**********************************************************************************************
 	./verify.sh $prefix
 	if [ $? -eq 0 ]; then
+		if [ -n "$IIF_RESULT_CACHE" ]; then
+			./result_cache.sh store $prefix $2
+		fi
 		echo ""
 		echo "=====================time========================="
 		#echo -n -e $green$bold"------------------------------------------------------------- Iteration "
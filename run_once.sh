@@ -43,12 +43,57 @@ path_dataset=$dir_temp""$file_dataset
 #rm -f $path_cnt
 rm -f $path_dataset
 rm -f $path_cnt_lib
+# the verification results memoized by verify.sh hold for this run only
+rm -rf $dir_temp""$prefix".vc"
 ##########################################################################
 # BEGINNING 
 ##########################################################################
-cd tools
-./make_tools.sh
-cd ..
+# bench_suite.sh builds the tools once for all the jobs it runs at the same time
+if [ -z "$IIF_PREBUILT_TOOLS" ]; then
+	cd tools
+	./make_tools.sh
+	cd ..
+fi
+
+# with IIF_RESULT_CACHE set, an unchanged loop takes its invariant from the cache, see result_cache.sh
+# an invariant proved by another verifier is only verified again
+if [ -n "$IIF_RESULT_CACHE" ] && [ $# -lt 3 ]; then
+	./result_cache.sh lookup $prefix $2
+	cache_ret=$?
+	if [ $cache_ret -eq 0 ]; then
+		exit 0
+	fi
+	if [ $cache_ret -eq 3 ]; then
+		./verify.sh $prefix
+		if [ $? -eq 0 ]; then
+			./result_cache.sh store $prefix $2
+			exit 0
+		fi
+	fi
+fi
+
+# with IIF_DAEMON=<socket>, the loop is learnt by a running daemon instead, see daemon/iifd.cpp
+# it falls back to the build when the daemon can not run it, e.g. the loop has another number of variables
+daemon_ret=3
+if [ -n "$IIF_DAEMON" ] && [ $# -lt 2 ]; then
+	echo -e $blue"Submitting the loop to the daemon on "$IIF_DAEMON"..."$normal
+	cd build
+	./iifd --socket=$IIF_DAEMON --submit=../$path_cfg --name=$prefix
+	daemon_ret=$?
+	cd ..
+fi
+if [ $daemon_ret -ne 3 ]; then
+	if [ $daemon_ret -ne 0 ]; then
+		echo -e $red$bold"can not get an invariant candidate, read log file to find out more."$normal$normal
+		exit 1
+	fi
+	./verify.sh $prefix
+	ret=$?
+	if [ $ret -eq 0 ] && [ -n "$IIF_RESULT_CACHE" ]; then
+		./result_cache.sh store $prefix
+	fi
+	exit $ret
+fi
 
 #./build_project.sh $prefix
 ./build_project.sh $prefix $path_cnt $path_dataset $2
@@ -82,5 +127,9 @@ cd ..
 # verification phase
 #**********************************************************************************************
 ./verify.sh $prefix
+ret=$?
+if [ $ret -eq 0 ] && [ -n "$IIF_RESULT_CACHE" ]; then
+	./result_cache.sh store $prefix $2
+fi
 
-exit $?
+exit $ret
@@ -0,0 +1,86 @@
+/** @file checkpoint.cpp
+ *  @brief The values shared by all the snapshots, see checkpoint.h.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "checkpoint.h"
+#include "classifier.h"
+#include <cstdlib>
+
+void writeString(std::ostream& out, const std::string& s) {
+	writeBinary(out, static_cast<int>(s.size()));
+	out.write(s.data(), s.size());
+}
+
+bool readString(std::istream& in, std::string& s) {
+	int n;
+	if (!readBinary(in, n) || (n < 0))
+		return false;
+	s.resize(n);
+	return (n == 0) || in.read(&s[0], n);
+}
+
+void writeClassifier(std::ostream& out, const Classifier& cl) {
+	writeBinary(out, cl.size);
+	for (int i = 0; i < cl.size; i++) {
+		Polynomial* poly = cl[i];
+		writeBinary(out, poly->getEtimes());
+		out.write(reinterpret_cast<const char*>(poly->theta), poly->getDims() * sizeof(double));
+		writeBinary(out, cl.cts[i].getType());
+	}
+}
+
+bool readClassifier(std::istream& in, Classifier& cl) {
+	int size;
+	if (!readBinary(in, size) || (size < 0) || (size > cl.max_size))
+		return false;
+	cl.clear();
+	for (int i = 0; i < size; i++) {
+		int etimes, type;
+		Polynomial poly;
+		if (!readBinary(in, etimes) || (etimes < 1) || (etimes > 4))
+			return false;
+		poly.setEtimes(etimes);
+		if (!in.read(reinterpret_cast<char*>(poly.theta), poly.getDims() * sizeof(double)) || !readBinary(in, type))
+			return false;
+		cl.add(poly, type);
+	}
+	return true;
+}
+
+// rand() draws from one of these states once seedRandom is called.
+// A state read back goes into the other one, as setstate saves the position of the current state into it.
+static const int random_state_size = 128;	// the same generator as the default state of rand()
+static char random_states[2][random_state_size];
+static int random_current = 0;
+static bool random_seeded = false;
+
+void seedRandom(unsigned int seed) {
+	initstate(seed, random_states[random_current], random_state_size);
+	random_seeded = true;
+}
+
+void writeRandomState(std::ostream& out) {
+	writeBinary(out, random_seeded);
+	if (!random_seeded)
+		return;
+	// makes the current position part of the state
+	setstate(random_states[random_current]);
+	out.write(random_states[random_current], random_state_size);
+}
+
+bool readRandomState(std::istream& in) {
+	bool seeded;
+	if (!readBinary(in, seeded))
+		return false;
+	if (!seeded)
+		return true;
+	int next = 1 - random_current;
+	if (!in.read(random_states[next], random_state_size))
+		return false;
+	setstate(random_states[next]);
+	random_current = next;
+	random_seeded = true;
+	return true;
+}
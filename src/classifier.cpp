@@ -4,17 +4,22 @@
  *  @bug no known bugs found.
  */
 #include "classifier.h"
+#include "memtrack.h"
+#include <algorithm>
+#include <vector>
 
 Classifier:: Classifier(int maxsize) {
 	max_size = maxsize;
 	polys = new Polynomial[max_size];
 	cts = new Connector[max_size];
+	MemoryTracker::add(MEM_CLASSIFIER, max_size * (sizeof(Polynomial) + sizeof(Connector)));
 	size = 0;
 }
 
 Classifier::~Classifier() { 
 	if (polys) delete []polys;
 	if (cts) delete []cts;
+	MemoryTracker::sub(MEM_CLASSIFIER, max_size * (sizeof(Polynomial) + sizeof(Connector)));
 } 
 
 int Classifier::clear() {
@@ -49,7 +54,7 @@ Classifier& Classifier::operator+= (Polynomial& poly) {
 	int res = add(poly, CONJUNCT);
 	//assert(res >= 1);
 	if (res <= 0)
-		std::cout << "Bug here?\n";
+		IIF_LOG(LOG_INFER, LOG_INFO) << "Bug here?\n";
 	return *this;
 }
 
@@ -88,18 +93,13 @@ int Classifier::add(Polynomial& poly, int type) {
 }
 
 bool Classifier::simplify() {
+	PROFILE_SCOPE(PHASE_SIMPLIFY);
 	if (size <= 1) return true;
-#ifdef __PRT_INFER
-	std::cout << YELLOW << "Simplify classifier..." << NORMAL << *this << "\n";
-#endif
+	IIF_LOG(LOG_INFER, LOG_DEBUG) << YELLOW << "Simplify classifier..." << NORMAL << *this << "\n";
 	for (int i = 0; (i < size) && (size >= 2); i++) {
-#ifdef __PRT_INFER
-		std::cout << BLUE << "Checking" << NORMAL << " all the others => " << polys[i] << " ";
-#endif
+		IIF_LOG(LOG_INFER, LOG_DEBUG) << BLUE << "Checking" << NORMAL << " all the others => " << polys[i] << " ";
 		if (checkRedundancy(i) == true) {
-#ifdef __PRT_INFER
-			std::cout << GREEN << "TRUE\n" << NORMAL;
-#endif
+			IIF_LOG(LOG_INFER, LOG_DEBUG) << GREEN << "TRUE\n" << NORMAL;
 #if 1
 			//polys[i--] = polys[--size];
 			polys[i] = polys[size-1];
@@ -112,24 +112,18 @@ bool Classifier::simplify() {
 			i--;
 #endif
 		} else {
-#ifdef __PRT_INFER
-			std::cout << RED << "FALSE\n" << NORMAL;
-#endif
+			IIF_LOG(LOG_INFER, LOG_DEBUG) << RED << "FALSE\n" << NORMAL;
 		}
 	}
 
-#ifdef __PRT_INFER
-	std::cout << "after simplification..." << *this << "\n";
-#endif
+	IIF_LOG(LOG_INFER, LOG_DEBUG) << "after simplification..." << *this << "\n";
 	return true;
 }
 
 bool Classifier::checkRedundancy(int l) {
 	if (l < 0 || l >= size) return false; 
 #if (linux || __MACH__)
-#ifdef __PRT_QUERY
-	std::cout << RED << "\n-------------checking redundancy-------------\n" << NORMAL;
-#endif
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << RED << "\n-------------checking redundancy-------------\n" << NORMAL;
 	z3::config cfg;
 	cfg.set("auto_config", true);
 	z3::context c(cfg);
@@ -145,26 +139,22 @@ bool Classifier::checkRedundancy(int l) {
 
 
 	z3::expr query = implies(hypo, conc);
-#ifdef __PRT_QUERY
-	std::cout << "hypo: " << hypo << std::endl;
-	std::cout << "conc: " << conc << std::endl;
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "hypo: " << hypo << std::endl;
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "conc: " << conc << std::endl;
 	//std::cout << "Query : " << query << std::endl;
 	//std::cout << "Answer: ";
-#endif
 
+	PROFILE_SCOPE(PHASE_Z3);
+	PROFILE_COUNT(COUNT_Z3_QUERIES, 1);
 	z3::solver s(c);
 	s.add(!query);
 	z3::check_result ret = s.check();
 
 	if (ret == unsat) {
-#ifdef __PRT_QUERY
-		std::cout << "True" << std::endl;
-#endif
+		IIF_LOG(LOG_QUERY, LOG_DEBUG) << "True" << std::endl;
 		return true;
 	} else {
-#ifdef __PRT_QUERY
-		std::cout << "False" << std::endl;
-#endif
+		IIF_LOG(LOG_QUERY, LOG_DEBUG) << "False" << std::endl;
 		return false;
 	}
 #endif
@@ -200,7 +190,7 @@ bool Classifier::factor(Polynomial& poly) {
 			double delta = B * B - 4 * A * C;
 			//std::cout << "A=" << A << " B=" << B << " C= " << C << " delta=" << delta << std::endl;
 			if (delta < 0) {
-				std::cout << RED << "Delta shouldnot be less than 0.\n";
+				IIF_LOG(LOG_INFER, LOG_INFO) << RED << "Delta shouldnot be less than 0.\n";
 				return false;
 			}
 			double x1, x2;
@@ -247,9 +237,7 @@ bool Classifier::roundoff() {
 // checkint whether the last polynomial can infer the others
 bool Classifier::resolveUniImplication() {
 	if (size <= 1) return false;
-#ifdef __PRT_SVM_I
-	std::cout << "Resolving implication in Classifier, size = " << size;
-#endif
+	IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "Resolving implication in Classifier, size = " << size;
 	for (int i = 0; i < size - 1; i++) {
 		//std::cout << RED << "\t??" << polys[size - 1] << " ==> " << polys[i] << "??";
 		if (polys[size - 1].uniImply(polys[i]) == true) {
@@ -262,9 +250,7 @@ bool Classifier::resolveUniImplication() {
 			//std::cout << "\tX\n" << NORMAL;
 		}
 	}
-#ifdef __PRT_SVM_I
-	std::cout << "->" << size << std::endl;
-#endif
+	IIF_LOG(LOG_SVM_I, LOG_DEBUG) << "->" << size << std::endl;
 	return true;
 }
 #endif
@@ -281,6 +267,30 @@ std::string Classifier::toString() const {
 	return stm.str();
 }
 
+std::string Classifier::canonical() const {
+	if (size <= 0)
+		return "true";
+	bool conjunction = true;
+	for (int i = 1; i < size; i++)
+		if (cts[i].getType() != CONJUNCT)
+			conjunction = false;
+	std::vector<std::string> forms;
+	for (int i = 0; i < size; i++)
+		forms.push_back(polys[i].canonical());
+	std::ostringstream stm;
+	if (conjunction) {
+		std::sort(forms.begin(), forms.end());
+		forms.erase(std::unique(forms.begin(), forms.end()), forms.end());
+		for (size_t i = 0; i < forms.size(); i++)
+			stm << ((i > 0) ? " && " : "") << forms[i];
+	} else {
+		stm << forms[0];
+		for (int i = 1; i < size; i++)
+			stm << cts[i] << forms[i];
+	}
+	return stm.str();
+}
+
 std::ostream& operator << (std::ostream& out, const Classifier& cs) {
 	out << cs.toString();
 	return out;
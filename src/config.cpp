@@ -3,17 +3,10 @@
 #include "instrumentation.h"
 #include <iostream>
 #include <stdlib.h>
-
-extern int assume_times, assert_times;
-int(*target_program)(int*) = NULL;
-
-int minv = -1 * base_step, maxv = base_step;
-std::string* variables;
-VariablePowerArray* vparray;
-int vnum;
-#ifdef __PRT_STATISTICS
-int random_samples = 0, selective_samples = 0;
-#endif
+#include <ctime>
+#include <string>
+#include <cerrno>
+#include <sys/stat.h>
 
 bool check_target_program(int (*func)(int*))
 {
@@ -22,12 +15,12 @@ bool check_target_program(int (*func)(int*))
 	int a[Nv];
 	for (int i = 0; i < Nv; i++)
 	    a[i] = sol[i];
-	assume_times = 0;
-	assert_times = 0;
+	current_context->assume_times = 0;
+	current_context->assert_times = 0;
 	func(a);
-	if (assume_times != 1)
+	if (current_context->assume_times != 1)
 		return false;
-	if (assert_times != 1)
+	if (current_context->assert_times != 1)
 		return false;
 	return true;
 }
@@ -37,12 +30,33 @@ bool register_program(int (*func)(int*), const char* func_name)
 {
 	if (check_target_program(func) == false) {
 		if (func_name == NULL) {
-			std::cout << "The target is not a valid program to test.\n";
+			IIF_LOG(LOG_LEARN, LOG_ERROR) << "The target is not a valid program to test.\n";
 		} else {
-			std::cout << func_name << " is not a valid program to test.\n";
+			IIF_LOG(LOG_LEARN, LOG_ERROR) << func_name << " is not a valid program to test.\n";
 		}
 		return false;
 	}
-	target_program = func;
+	current_context->target_program = func;
 	return true;
 }
+
+unsigned int randomSeed()
+{
+	const char* seed = getenv("IIF_SEED");
+	if ((seed != NULL) && (*seed != '\0'))
+		return static_cast<unsigned int>(strtoul(seed, NULL, 10));
+	return static_cast<unsigned int>(time(NULL));
+}
+
+bool makeFolders(const char* path)
+{
+	std::string folder = path;
+	// each parent in turn, then the folder itself
+	for (size_t slash = folder.find('/', 1); ; slash = folder.find('/', slash + 1)) {
+		std::string part = folder.substr(0, slash);
+		if (!part.empty() && (mkdir(part.c_str(), 0755) != 0) && (errno != EEXIST))
+			return false;
+		if (slash == std::string::npos)
+			return true;
+	}
+}
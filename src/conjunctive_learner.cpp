@@ -25,124 +25,131 @@ ConjunctiveLearner::~ConjunctiveLearner() {
 
 int ConjunctiveLearner::learn()
 {
-	std::cout << YELLOW << ">>>> Conjunctive Learner-----------------------\n" << NORMAL;  
+	IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << ">>>> Conjunctive Learner-----------------------\n" << NORMAL;  
 	Solution inputs;
-	srand(time(NULL)); // initialize seed for rand() function
+	// the rounds go on from a checkpoint if they are restored, rand() is then restored as well
+	if (!resumeRounds())
+		seedRandom(randomSeed()); // initialize seed for rand() function, see IIF_SEED
 
-	int rnd;
 	//bool lastSimilar = false;
 	bool converged = false;
-	int converged_time = 0;
-	Classifier pre_cl;
-	int pre_psize = 0, pre_nsize = 0; // , pre_question_size = 0;
 	double pass_rate = 1;
 
-	for (rnd = 1; ((rnd <= max_iteration) && (pass_rate >= 1)); rnd++) {
+	for (; ((rnd <= max_iteration) && (pass_rate >= 1)); rnd++) {
+		if (cancelled()) {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Cancelled, another learner has succeeded.\n" << NORMAL;
+			return -1;
+		}
+		if (outOfTime()) {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Out of time, see TimeBudget.\n" << NORMAL;
+			return -1;
+		}
+		beginRound();
+		Profiler::round("conjunctive", rnd);
 		int zero_times = 0;
 		//std::cout << "[" << rnd << "]";
 		int nexe = (rnd == 1) ? Nexe_init : Nexe_after;
-#ifdef __PRT
+		int randn = Nexe_rand;
+		if (!budgetSamples(randn, nexe)) {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Out of time, see TimeBudget.\n" << NORMAL;
+			return -1;
+		}
 		int step = 1;
-		std::cout << RED << "[" << rnd << "]" << NORMAL;
-		std::cout << "SVM-I----------------------------------------------------------"
-			"------------------------------------------------";
-		std::cout << "\n\t(" << step++ << ") execute programs... [" << nexe + Nexe_rand << "] ";
-#else
-		std::cout << RED << "[" << rnd;
-#endif
+		if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "[" << rnd << "]" << NORMAL;
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "SVM-I----------------------------------------------------------"
+				"------------------------------------------------";
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\n\t(" << step++ << ") execute programs... [" << nexe + randn << "] ";
+		} else {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "[" << rnd;
+		}
 init_svm_i:
-		selectiveSampling(Nexe_rand, nexe, &pre_cl);
+		selectiveSampling(randn, nexe, &pre_cl);
+		if (counterExample())
+			return -2;
 
 		if ((rnd == 1) && (gsets[POSITIVE].traces_num() == 0 || gsets[NEGATIVE].traces_num() == 0)) {
-#ifdef __PRT
-			if (gsets[POSITIVE].traces_num() == 0) 
-				std::cout << RED << "\tZero Positive trace, execute program again." << NORMAL << std::endl;
-			if (gsets[NEGATIVE].traces_num() == 0) 
-				std::cout << RED << "\tZero Negative trace, execute program again." << NORMAL << std::endl;
-#else
-			std::cout << "+";
-#endif
+			if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+				if (gsets[POSITIVE].traces_num() == 0) 
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "\tZero Positive trace, execute program again." << NORMAL << std::endl;
+				if (gsets[NEGATIVE].traces_num() == 0) 
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "\tZero Negative trace, execute program again." << NORMAL << std::endl;
+			} else {
+				IIF_LOG(LOG_LEARN, LOG_INFO) << "+";
+			}
+			if (outOfTime()) {
+				IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Out of time, see TimeBudget.\n" << NORMAL;
+				return -1;
+			}
 			if (++zero_times >= Nretry_init) {
 				if (gsets[POSITIVE].traces_num() == 0) 
-					std::cout << RED << "Can not get any positive trace. " << std::endl;
+					IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "Can not get any positive trace. " << std::endl;
 				else
-					std::cout << RED << "Can not get any negative trace. " << std::endl;
-				std::cout << " re-Run the system again OR modify your loop program.\n" << NORMAL;
-				exit(-1);
+					IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "Can not get any negative trace. " << std::endl;
+				IIF_LOG(LOG_LEARN, LOG_INFO) << " re-Run the system again OR modify your loop program.\n" << NORMAL;
+				return -1;
 			}
-			if (maxv <= 100000) {maxv+=base_step;}
-			if (minv >= -100000) {minv-=base_step;}
+			if (context->maxv <= 100000) {context->maxv+=base_step;}
+			if (context->minv >= -100000) {context->minv-=base_step;}
 			goto init_svm_i;
 		}
 
-#ifdef __PRT
-		std::cout << "\t(" << step++ << ") prepare training data... ";
-#else
-		if (zero_times == 0) {
-			std::cout << "]" << NORMAL;
+		if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << step++ << ") prepare training data... ";
+		} else {
+			if (zero_times == 0) {
+				IIF_LOG(LOG_LEARN, LOG_INFO) << "]" << NORMAL;
+			}
 		}
-#endif
-#ifdef __PRT_STATISTICS
-		std::cout << "[#r" << random_samples << ",#s" << selective_samples << "]\n    ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "[#r" << context->random_samples << ",#s" << context->selective_samples << "]\n    ";
 		if (svm_i->makeTrainingSet(gsets, pre_psize, pre_nsize) == 0) {
 			if (++zero_times < Nretry_init)
 				goto init_svm_i;
 		}
 		//while (pre_psize + pre_nsize >= density * pow(maxv-minv, Nv)) {
-		while (gsets[POSITIVE].getSize() + gsets[NEGATIVE].getSize() >= density * pow(maxv-minv, Nv)) {
-			if (maxv <= 100000) {maxv+=base_step;}
-			if (minv >= -100000) {minv-=base_step;}
+		while (gsets[POSITIVE].getSize() + gsets[NEGATIVE].getSize() >= density * pow(context->maxv-context->minv, Nv)) {
+			if (context->maxv <= 100000) {context->maxv+=base_step;}
+			if (context->minv >= -100000) {context->minv-=base_step;}
 		}
 
-#ifdef __PRT
-		std::cout << "\n\t(" << step++ << ") start training... ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\n\t(" << step++ << ") start training... ";
 #ifdef __DS_ENABLED
-		std::cout << "[" << svm_i->problem.np << "+:" << svm_i->negative_size << "-]";
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "[" << svm_i->problem.np << "+:" << svm_i->negative_size << "-]";
 #endif
 		int ret = svm_i->train();
 		if (ret == -1) {
-			std::cerr << RED << "[FAIL] ..... Can not divided by SVM_I." << std::endl << NORMAL;
+			IIF_LOG(LOG_LEARN, LOG_ERROR) << RED << "[FAIL] ..... Can not divided by SVM_I." << std::endl << NORMAL;
 			return -1;
 		}
 		//svm_i->cl.roundoff();
-		std::cout << "|-->> " << YELLOW << *svm_i << std::endl << NORMAL;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "|-->> " << YELLOW << *svm_i << std::endl << NORMAL;
 
 		/*
 		 *	check on its own training data.
 		 *	There should be no prediction errors.
 		 */
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") checking training traces.";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") checking training traces.";
 		pass_rate = svm_i->checkTrainingSet();
 
-#ifdef __PRT
-		if (pass_rate == 1) 
-			std::cout << GREEN << " [" << pass_rate * 100 << "%]" << NORMAL;
-		else 
-			std::cout << RED << " [" << pass_rate * 100 << "%]" << NORMAL;
-#endif
+		if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+			if (pass_rate == 1) 
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << GREEN << " [" << pass_rate * 100 << "%]" << NORMAL;
+			else 
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << " [" << pass_rate * 100 << "%]" << NORMAL;
+		}
 
 		if (pass_rate < 1) {
-			std::cerr << RED << "[FAIL] ..... Can not divided by SVM_I." << std::endl << NORMAL;
+			IIF_LOG(LOG_LEARN, LOG_ERROR) << RED << "[FAIL] ..... Can not divided by SVM_I." << std::endl << NORMAL;
 			rnd++;
 			break;	
 		}
-#ifdef __PRT
-		std::cout << GREEN << " [PASS]" << std::endl << NORMAL;
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << GREEN << " [PASS]" << std::endl << NORMAL;
 
 #ifdef __QUESTION_TRACE_CHECK_ENABLED
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") check Question Traces:   ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") check Question Traces:   ";
 		if (svm_i->checkQuestionTraces(gsets[QUESTION]) != 0)
 			continue;
-#ifdef __PRT
-		std::cout << "\n";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\n";
 #endif
 		svm_i->pointwiseSimplify();
 
@@ -151,25 +158,21 @@ init_svm_i:
 		 *	We only admit convergence if the three consecutive round are converged.
 		 *	This is to prevent in some round the points are too right to adjust the classifier.
 		 */
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") check convergence:        ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") check convergence:        ";
 
 		if (svm_i->converged(pre_cl) == true) {
 			converged_time++;
-#ifdef __PRT
-			std::cout << "[";
-			for (int j = 0; j < converged_std - converged_time; j++)
-				std::cout << "F";
-			for (int j = 0; j < converged_time; j++)
-				std::cout << "T";
-			std::cout << "]  ";
-#endif
+			if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "[";
+				for (int j = 0; j < converged_std - converged_time; j++)
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << "F";
+				for (int j = 0; j < converged_time; j++)
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << "T";
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "]  ";
+			}
 
 			if (converged_time >= converged_std) {
-#ifdef __PRT
-				std::cout << "[SUCCESS] rounding off" << std::endl;
-#endif
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "[SUCCESS] rounding off" << std::endl;
 				converged = true;
 				rnd++;
 				break;
@@ -177,31 +180,30 @@ init_svm_i:
 		} else {
 			converged_time = 0;
 		}
-#ifdef __PRT
-		std::cout << "[FAIL] neXt round " << std::endl;
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "[FAIL] neXt round " << std::endl;
 
+		offerCandidate(svm_i->cl);
 		pre_cl = svm_i->cl;
 		svm_i->cl.clear();
 	} // end of SVM_I training procedure
 
 
-	std::cout << "---------------------------------------------------\n";
-	std::cout << "Finish running svm_i for " << rnd - 1 << " times." << std::endl;
+	IIF_LOG(LOG_LEARN, LOG_INFO) << "---------------------------------------------------\n";
+	IIF_LOG(LOG_LEARN, LOG_INFO) << "Finish running svm_i for " << rnd - 1 << " times." << std::endl;
 
 	int ret = 0;
 	if ((converged) && (rnd <= max_iteration)) {
 		//svm_i->pointwiseSimplify();
 		svm_i->cl.roundoff();
 		svm_i->cl.simplify();
-		std::cout << YELLOW << "  Hypothesis Invairant(Conjunctive): { ";
-		std::cout << GREEN << svm_i->cl << YELLOW;
-		std::cout << " }" << NORMAL << std::endl;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Hypothesis Invairant(Conjunctive): { ";
+		IIF_LOG(LOG_LEARN, LOG_INFO) << GREEN << svm_i->cl << YELLOW;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << " }" << NORMAL << std::endl;
 	}
 
 	if ((pass_rate < 1) || (rnd > max_iteration)) {
 		//std::cout << RED << "  Cannot divided by SVM_I perfectly.\n" << NORMAL;
-		std::cout << pass_rate << "\t" << rnd << std::endl;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << pass_rate << "\t" << rnd << std::endl;
 		ret = -1;
 	}
 
@@ -215,6 +217,15 @@ std::string ConjunctiveLearner::invariant(int n) {
 	return svm_i->cl.toString();
 }
 
+std::string ConjunctiveLearner::canonicalInvariant(int n) {
+	return svm_i->cl.canonical();
+}
+
+bool ConjunctiveLearner::loadRounds(std::istream& in) {
+	restored = BaseLearner::loadRounds(in) && svm_i->loadTrainingSet(gsets, pre_psize, pre_nsize);
+	return restored;
+}
+
 int ConjunctiveLearner::save2file(const char* dsfilename) {
 	printStatistics();
 	//std::ofstream fout("../tmp/svm.ds");
@@ -229,11 +240,11 @@ int ConjunctiveLearner::save2file(const char* dsfilename) {
 	for (int i = 0; i < svm_i->negative_size; i++) {
 		fout << -1;
 		for (int j = 0; j < Nv; j++)
-			fout << "\t" << j << ":" << svm_i->negative_mapped_data[i][j];
+			fout << "\t" << j << ":" << svm_i->negative(i)[j];
 		fout << "\n";
 	}
 	fout.close();
 	//std::cout << "save to file succeed. ../tmp/svm.ds\n";
-	std::cout << "save the training dataset to file " << dsfilename << "\n";
+	IIF_LOG(LOG_LEARN, LOG_INFO) << "save the training dataset to file " << dsfilename << "\n";
 	return 0;
 }
@@ -0,0 +1,38 @@
+/** @file context_state.cpp
+ *  @brief Implementation of the state of an inference context.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "context_state.h"
+#include "instrumentation.h"
+#include "sampler.h"
+#include "sample_library.h"
+
+ContextState::ContextState() : target_program(NULL), loop_program(NULL), variables(NULL), vnum(0),
+	minv(-1 * base_step), maxv(base_step), random_samples(0), selective_samples(0), cached_samples(0),
+	deterministic_target(false), sample_library(NULL), counter_example(false),
+	passP(false), passQ(false), assume_times(0), assert_times(0), state_index(0), record_fast_limit(MstatesIn1trace * 9 / 10),
+	sampling_policy(SAMPLE_LEGACY), sampling_k(MstatesIn1trace), sampling_classifier(NULL),
+	trace_length(0), stride(1), last_kept(true), last_sign(0) {
+	executed_inputs = new InputSet();
+	execution_cache = new ExecutionCache();
+}
+
+ContextState::~ContextState() {
+	delete executed_inputs;
+	delete execution_cache;
+	if (sample_library != NULL)
+		delete sample_library;
+	if (variables != NULL)
+		delete []variables;
+}
+
+static ContextState default_context;
+
+ContextState* defaultContext() {
+	return &default_context;
+}
+
+// constant initialized, so that accessing it costs no more than a global
+thread_local ContextState* current_context = &default_context;
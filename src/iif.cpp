@@ -11,60 +11,78 @@ LearnerNode::~LearnerNode() {
 }
 
 iifContext::iifContext (States* ss) {
+	state = new ContextState();
+	current_context = state;
 	gsets = ss;
 	first = NULL;
 	last = NULL;
-	variables = NULL;
-	vnum = 0;
+	timeout = 3600;
+	portfolio = false;
+	profiled = false;
+	checkpoint_interval = 60;
+	checkpoint_saved = 0;
+	running = NULL;
+	resumed = NULL;
 }
 
 iifContext::iifContext(const char* vfilename, int (*func)(int*), 
 		const char* func_name, const char* dataset_fname, int timeout) {
+	std::string names[Nv];
+	int vnum = 0;
 	std::ifstream vfile(vfilename);
 	vfile >> vnum;
+	for (int i = 0; i < Nv; i++) {
+		vfile >> names[i];
+	}
+	vfile.close();
+	this->timeout = timeout;
+	init(names, dataset_fname);
+	state->vnum = vnum;
+	register_program(func, func_name);
+	seedRandom(randomSeed()); // initialize seed for rand() function, see IIF_SEED
+	setLogLevel(getenv("IIF_LOG"));
+}
+
+iifContext::iifContext(const LoopProgram& program, const char* dataset_fname, int timeout) {
+	this->timeout = timeout;
+	init(&program.getNames()[0], dataset_fname);
+	state->loop_program = &program;
+	register_program(runLoopProgram, "The loop");
+	// compiled before the seed is set, so that a native loop draws the same inputs as an interpreted one
+	if ((getenv("IIF_JIT") != NULL) && (atoi(getenv("IIF_JIT")) != 0))
+		setJit(true);
+	seedRandom(randomSeed()); // initialize seed for rand() function, see IIF_SEED
+	setLogLevel(getenv("IIF_LOG"));
+	IIF_LOG(LOG_LEARN, LOG_DEBUG) << "bytecode of the loop:\n" << program.disassemble();
+}
+
+void iifContext::init(const std::string* names, const char* dataset_fname) {
+	// the context is current on this thread from now on, until another one is created
+	state = new ContextState();
+	current_context = state;
+	state->vnum = Nv;
+	std::string*& variables = state->variables;
 	variables = new std::string[Cv0to4];
-	vparray = new VariablePowerArray[Cv0to4];
 	variables[0] = '1';
-	for (int i = 0; i < Cv0to4; i++) {
-		for(int j = 0; j < Nv; j++) {
-			vparray[i][j] = 0;
-		}
-	}
 	for (int i = 1; i <= Nv; i++) {
-		vfile >> variables[i];
-		vparray[i][i-1] = 1;
-	}
-	vfile.close();
-	int index = Nv+1;
-	for (int i = 0; i < Nv; i++) {
-		for (int j = i; j < Nv; j++) {
-			vparray[index][i]++;
-			vparray[index][j]++;
-			variables[index++] = /*"(" +*/ variables[i+1] + "*" + variables[j+1] /*+ ")"*/;
-		}
-	}
-	for (int i = 0; i < Nv; i++) {
-		for (int j = i; j < Nv; j++) {
-			for (int k = j; k < Nv; k++) {
-				vparray[index][i]++;
-				vparray[index][j]++;
-				vparray[index][k]++;
-				variables[index++] = /*"(" +*/ variables[i+1] + "*" + variables[j+1] 
-					+ "*" + variables[k+1] /*+ ")"*/;
-			}
-		}
+		variables[i] = names[i - 1];
 	}
-	for (int i = 0; i < Nv; i++) {
-		for (int j = i; j < Nv; j++) {
-			for (int k = j; k < Nv; k++) {
-				for (int l = k; l < Nv; l++) {
-					vparray[index][i]++;
-					vparray[index][j]++;
-					vparray[index][k]++;
-					vparray[index][l]++;
-					variables[index++] = /*"(" +*/ variables[i+1] + "*" + variables[j+1] 
-						+ "*" + variables[k+1] + "*" + variables[l+1]/* + ")"*/;
-				}
+	// the budget applies from the first allocation of the states sets
+	if (getenv("IIF_MEM_BUDGET") != NULL)
+		setMemoryBudget(atoi(getenv("IIF_MEM_BUDGET")));
+	portfolio = (getenv("IIF_PORTFOLIO") != NULL) && (atoi(getenv("IIF_PORTFOLIO")) != 0);
+	profiled = false;
+	if (getenv("IIF_TIME_BUDGET") != NULL)
+		setTimeBudget(atoi(getenv("IIF_TIME_BUDGET")));
+	if (getenv("IIF_SAMPLE_LIB") != NULL)
+		setSampleLibrary(getenv("IIF_SAMPLE_LIB"));
+	// higher degree monomials are named after the exponent table, e.g. x*x*y
+	for (int index = Nv + 1; index < Cv0to4; index++) {
+		for (int j = 0; j < Nv; j++) {
+			for (int power = monomial::exponent(index, j); power > 0; power--) {
+				if (!variables[index].empty())
+					variables[index] += "*";
+				variables[index] += variables[j + 1];
 			}
 		}
 	}
@@ -88,9 +106,12 @@ iifContext::iifContext(const char* vfilename, int (*func)(int*),
 	}
 	first = NULL;
 	last = NULL;
-	register_program(func, func_name);
-	this->timeout = timeout;
-	srand(time(NULL)); // initialize seed for rand() function
+	checkpoint_interval = 60;
+	checkpoint_saved = 0;
+	running = NULL;
+	resumed = NULL;
+	if (getenv("IIF_CHECKPOINT") != NULL)
+		setCheckpoint(getenv("IIF_CHECKPOINT"), (getenv("IIF_CHECKPOINT_INTERVAL") != NULL) ? atoi(getenv("IIF_CHECKPOINT_INTERVAL")) : 60);
 }
 
 iifContext::~iifContext() {
@@ -104,14 +125,15 @@ iifContext::~iifContext() {
 		p = pp;
 	}
 	delete []gsets;
-	if (variables != NULL)
-		delete []variables;
-	if (vparray != NULL)
-		delete vparray;
+	if (current_context == state)
+		current_context = defaultContext();
+	delete state;
 }
 
 
 iifContext& iifContext::addLearner(const char* learnerName) {
+	// the learner is bound to the context current at its construction
+	ContextBinding bind(state);
 	BaseLearner* newLearner = NULL;
 	if (strcmp(learnerName, "linear") == 0)
 		newLearner = new LinearLearner(gsets);
@@ -141,15 +163,403 @@ iifContext& iifContext::addLearner(const char* learnerName) {
 	return *this;
 }
 
+iifContext& iifContext::setTraceSampling(const char* policyName, int k) {
+	int policy = -1;
+	if (strcmp(policyName, "legacy") == 0)
+		policy = SAMPLE_LEGACY;
+	else if (strcmp(policyName, "reservoir") == 0)
+		policy = SAMPLE_RESERVOIR;
+	else if (strcmp(policyName, "stride") == 0)
+		policy = SAMPLE_STRIDE;
+	else if (strcmp(policyName, "firstlast") == 0)
+		policy = SAMPLE_FIRST_LAST;
+	else if (strcmp(policyName, "signchange") == 0)
+		policy = SAMPLE_SIGN_CHANGE;
+
+	ContextBinding bind(state);
+	if (::setTraceSampling(policy, k) == false)
+		IIF_LOG(LOG_LEARN, LOG_WARN) << "Unknown trace sampling policy " << policyName << ", keep the current one.\n";
+	return *this;
+}
+
+iifContext& iifContext::setDeterministic(bool deterministic) {
+	state->deterministic_target = deterministic;
+	if (!deterministic)
+		state->execution_cache->clear();
+	return *this;
+}
+
+iifContext& iifContext::setLogLevel(const char* spec) {
+	if (Logger::configure(spec) == false)
+		IIF_LOG(LOG_LEARN, LOG_WARN) << "Unrecognized log level in " << spec << ", ignore that part.\n";
+	return *this;
+}
+
+iifContext& iifContext::setMemoryBudget(int megabytes) {
+	MemoryTracker::setBudget((megabytes > 0) ? static_cast<long long>(megabytes) << 20 : 0);
+	return *this;
+}
+
+iifContext& iifContext::setPortfolio(bool portfolio) {
+	this->portfolio = portfolio;
+	return *this;
+}
+
+iifContext& iifContext::setTimeBudget(int seconds) {
+	timeout = (seconds > 0) ? seconds : 0;
+	return *this;
+}
+
+iifContext& iifContext::setSampleLibrary(const char* folder) {
+	if ((folder == NULL) || (*folder == '\0'))
+		sample_folder.clear();
+	else
+		sample_folder = (strcmp(folder, "1") == 0) ? "../tmp/lib" : folder;
+	return *this;
+}
+
+iifContext& iifContext::setLoopKey(const char* key) {
+	loop_key = (key != NULL) ? key : "";
+	return *this;
+}
+
+void iifContext::loadSampleLibrary(BaseLearner* learner, bool replay) {
+	if (sample_folder.empty() || loop_key.empty())
+		return;
+	if (state->sample_library == NULL)
+		state->sample_library = new SampleLibrary(sample_folder, loop_key);
+	std::vector<SampleLibrary::Execution> executions;
+	if (!state->sample_library->load(executions) || !replay)
+		return;
+	int executed = learner->runSampleLibrary(executions);
+	IIF_LOG(LOG_LEARN, LOG_INFO) << BLUE << "Sample library " << state->sample_library->path() << ": "
+		<< executions.size() << " executions, " << executions.size() - executed << " reused, "
+		<< executed << " executed again. [" << gsets[POSITIVE].getSize() << "+|" << gsets[NEGATIVE].getSize() << "-]"
+		<< NORMAL << std::endl;
+}
+
+iifContext& iifContext::setJit(bool jit) {
+	ContextBinding bind(state);
+	if (state->loop_program == NULL) {
+		IIF_LOG(LOG_LEARN, LOG_WARN) << "Only the loop of a LoopProgram can be compiled, keep the current one.\n";
+		return *this;
+	}
+	if (!jit) {
+		register_program(runLoopProgram, "The loop");
+		return *this;
+	}
+	std::string message;
+	LoopFunction func = compileLoopProgram(*state->loop_program, message);
+	if (func == NULL)
+		IIF_LOG(LOG_LEARN, LOG_WARN) << "Can not compile the loop, " << message << ", interpret it instead.\n";
+	else
+		register_program(func, "The compiled loop");
+	return *this;
+}
+
+iifContext& iifContext::setCheckpoint(const char* filename, int interval) {
+	checkpoint_file = (filename != NULL) ? filename : "";
+	checkpoint_interval = (interval > 0) ? interval : 0;
+	return *this;
+}
+
+// the first bytes of a snapshot, and its last ones, which tell it is complete
+static const char checkpoint_magic[] = "IIFCKPT1";
+static const char checkpoint_end[] = "IIFCKEND";
+static const int checkpoint_magic_size = 8;
+
+bool iifContext::saveCheckpoint(const char* filename) {
+	ContextBinding bind(state);
+	int index = -1, learners = 0;
+	for (LearnerNode* p = first; p != NULL; p = p->next, learners++)
+		if (p == running)
+			index = learners;
+
+	// written aside and renamed, so that a run stopped meanwhile leaves the last snapshot
+	std::string partial = std::string(filename) + ".tmp";
+	std::ofstream out(partial.c_str(), std::ios::binary);
+	out.write(checkpoint_magic, checkpoint_magic_size);
+	writeBinary(out, static_cast<int>(Nv));
+	writeBinary(out, state->vnum);
+	for (int i = 1; i <= Nv; i++)
+		writeString(out, state->variables[i]);
+	writeBinary(out, learners);
+	writeBinary(out, index);
+
+	writeRandomState(out);
+	writeBinary(out, static_cast<int>(state->minv));
+	writeBinary(out, static_cast<int>(state->maxv));
+	writeBinary(out, static_cast<int>(state->random_samples));
+	writeBinary(out, static_cast<int>(state->selective_samples));
+	writeBinary(out, static_cast<int>(state->cached_samples));
+	writeBinary(out, state->deterministic_target);
+	writeBinary(out, state->sampling_policy);
+	writeBinary(out, state->sampling_k);
+	state->executed_inputs->save(out);
+	state->execution_cache->save(out);
+	for (int i = 0; i < 3; i++)
+		gsets[i].save(out);
+	if (running != NULL)
+		running->learner->saveRounds(out);
+	out.write(checkpoint_end, checkpoint_magic_size);
+	out.close();
+	if (!out || (rename(partial.c_str(), filename) != 0)) {
+		remove(partial.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool iifContext::loadCheckpoint(const char* filename) {
+	ContextBinding bind(state);
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin)
+		return false;
+	std::stringstream in;
+	in << fin.rdbuf();
+	std::string content = in.str();
+	if ((content.size() < 2 * checkpoint_magic_size) || (content.compare(0, checkpoint_magic_size, checkpoint_magic) != 0)
+			|| (content.compare(content.size() - checkpoint_magic_size, checkpoint_magic_size, checkpoint_end) != 0)) {
+		IIF_LOG(LOG_LEARN, LOG_WARN) << filename << " is not a complete snapshot, start from scratch.\n";
+		return false;
+	}
+	in.seekg(checkpoint_magic_size);
+
+	// the snapshot should be of the same loop, with the same learners
+	int nv, vnum, learners, index;
+	bool same = readBinary(in, nv) && (nv == Nv) && readBinary(in, vnum) && (vnum == state->vnum);
+	for (int i = 1; same && (i <= Nv); i++) {
+		std::string name;
+		same = readString(in, name) && (name == state->variables[i]);
+	}
+	int count = 0;
+	for (LearnerNode* p = first; p != NULL; p = p->next)
+		count++;
+	same = same && readBinary(in, learners) && (learners == count) && readBinary(in, index) && (index < count);
+	if (!same) {
+		IIF_LOG(LOG_LEARN, LOG_WARN) << filename << " is a snapshot of another loop or other learners, start from scratch.\n";
+		return false;
+	}
+
+	// what the snapshot replaces, put back if it turns out to be broken
+	std::stringstream backup;
+	writeRandomState(backup);
+	state->executed_inputs->save(backup);
+	state->execution_cache->save(backup);
+	for (int i = 0; i < 3; i++)
+		gsets[i].save(backup);
+	bool deterministic_target = state->deterministic_target;
+	int sampling_policy = state->sampling_policy, sampling_k = state->sampling_k;
+
+	int minv, maxv, random_samples, selective_samples, cached_samples;
+	bool ok = readRandomState(in) && readBinary(in, minv) && readBinary(in, maxv)
+		&& readBinary(in, random_samples) && readBinary(in, selective_samples) && readBinary(in, cached_samples)
+		&& readBinary(in, state->deterministic_target)
+		&& readBinary(in, state->sampling_policy) && readBinary(in, state->sampling_k)
+		&& state->executed_inputs->load(in) && state->execution_cache->load(in);
+	for (int i = 0; ok && (i < 3); i++)
+		ok = gsets[i].load(in);
+	resumed = first;
+	for (int i = 0; i < index; i++)
+		resumed = resumed->next;
+	if (ok && (index >= 0))
+		ok = resumed->learner->loadRounds(in);
+	if (!ok) {
+		// the states sets may be partly replaced, so they are put back, and the run starts from scratch
+		readRandomState(backup);
+		state->executed_inputs->load(backup);
+		state->execution_cache->load(backup);
+		for (int i = 0; i < 3; i++) {
+			gsets[i].clear();
+			gsets[i].load(backup);
+		}
+		state->deterministic_target = deterministic_target;
+		state->sampling_policy = sampling_policy;
+		state->sampling_k = sampling_k;
+		resumed = NULL;
+		IIF_LOG(LOG_LEARN, LOG_WARN) << filename << " is broken, it is removed, start from scratch.\n";
+		remove(filename);
+		return false;
+	}
+	state->minv = minv;
+	state->maxv = maxv;
+	state->random_samples = random_samples;
+	state->selective_samples = selective_samples;
+	state->cached_samples = cached_samples;
+	IIF_LOG(LOG_LEARN, LOG_INFO) << "Resume from " << filename << ", learner " << index + 1 << " of " << count
+		<< ", [" << gsets[POSITIVE].getSize() << "+|" << gsets[NEGATIVE].getSize() << "-]\n";
+	return true;
+}
+
+void iifContext::onRound(BaseLearner* learner) {
+	if (checkpoint_path.empty())
+		return;
+	time_t now = time(NULL);
+	if ((checkpoint_saved != 0) && (now - checkpoint_saved < checkpoint_interval))
+		return;
+	if (saveCheckpoint(checkpoint_path.c_str()))
+		checkpoint_saved = now;
+	else
+		IIF_LOG(LOG_LEARN, LOG_WARN) << "Can not write the snapshot " << checkpoint_path << "\n";
+}
+
+struct PortfolioResult {
+	std::atomic<bool> done;
+	std::mutex mutex;
+	LearnerNode* winner;
+};
+
+static void runPortfolioLearner(ContextState* state, LearnerNode* node, PortfolioResult* result) {
+	ContextBinding bind(state);
+	int ret = node->learner->learn();
+	Profiler::endLearner();
+	if (ret == 0) {
+		std::lock_guard<std::mutex> lock(result->mutex);
+		if (result->winner == NULL) {
+			result->winner = node;
+			result->done = true;
+		}
+	} else if (ret == -2) {
+		// a counter example stops the other learners as well, learn() returns -2
+		result->done = true;
+	}
+}
+
+LearnerNode* iifContext::learnPortfolio() {
+	PortfolioResult result;
+	result.done = false;
+	result.winner = NULL;
+	std::vector<std::thread> threads;
+	for (LearnerNode* p = first; p != NULL; p = p->next) {
+		p->learner->setCancelFlag(&result.done);
+		// all the learners share the whole budget
+		p->learner->setTimeSlice(state->budget.slice(1));
+		threads.push_back(std::thread(runPortfolioLearner, state, p, &result));
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	for (LearnerNode* p = first; p != NULL; p = p->next)
+		p->learner->setCancelFlag(NULL);
+	return result.winner;
+}
+
+#ifdef __linux__
+// the alarm is process-wide, the learn() calls running share it
+static std::mutex alarm_mutex;
+static int alarm_users = 0, alarm_unbounded = 0;
+static time_t alarm_deadline = 0;
+/// the contexts of the learn() calls running
+static std::vector<ContextState*> alarm_contexts;
+
+void iifContext::sig_alrm(int signo) {
+	std::cout << "\nTIMEOUT!\n";
+	// the executions of the runs are kept, unless the alarm has interrupted the thread changing them
+	if (alarm_mutex.try_lock()) {
+		for (size_t i = 0; i < alarm_contexts.size(); i++) {
+			ContextBinding bind(alarm_contexts[i]);
+			if (alarm_contexts[i]->sample_library != NULL)
+				alarm_contexts[i]->sample_library->flushIfIdle();
+		}
+		alarm_mutex.unlock();
+	}
+	exit(-1);
+}
+
+/** @brief let the alarm go off seconds from now at the earliest, never if seconds is 0.
+ *		   It goes off at the latest deadline of the learn() calls running, never if one of them has no timeout.
+ */
+static void armAlarm(int seconds, ContextState* state) {
+	std::lock_guard<std::mutex> lock(alarm_mutex);
+	alarm_users++;
+	alarm_contexts.push_back(state);
+	if (seconds > 0)
+		alarm_deadline = std::max(alarm_deadline, time(NULL) + seconds);
+	else
+		alarm_unbounded++;
+	alarm((alarm_unbounded > 0) ? 0 : std::max<time_t>(alarm_deadline - time(NULL), 1));
+}
+
+/// end the share of armAlarm(seconds, state), the alarm is cancelled once no learn() is running
+static void disarmAlarm(int seconds, ContextState* state) {
+	std::lock_guard<std::mutex> lock(alarm_mutex);
+	alarm_users--;
+	alarm_contexts.erase(std::find(alarm_contexts.begin(), alarm_contexts.end(), state));
+	if (seconds <= 0)
+		alarm_unbounded--;
+	if (alarm_users == 0)
+		alarm_deadline = 0;
+	alarm(((alarm_users == 0) || (alarm_unbounded > 0)) ? 0 : std::max<time_t>(alarm_deadline - time(NULL), 1));
+}
+
+/// the alarm of a budget of timeout seconds, with some slack as the learners stop by themselves before it
+static int alarmSeconds(int timeout) {
+	return (timeout > 0) ? timeout + timeout / 10 + 10 : 0;
+}
+#endif
+
+int iifContext::finish(LearnerNode* p, const char* invfilename) {
+	BaseLearner* learner = (p != NULL) ? p->learner : NULL;
+	std::string candidate;
+	if ((learner == NULL) && !state->counter_example && state->budget.expired()) {
+		if (state->budget.best(learner, candidate))
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "TIMEOUT! The best candidate so far: {  " << GREEN << candidate
+				<< YELLOW << "  }" << NORMAL << std::endl;
+		else
+			IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "TIMEOUT! No candidate found." << NORMAL << std::endl;
+	}
+	if (learner != NULL) {
+		char filename[256]; 
+#ifdef __DS_ENABLED
+		sprintf(filename, "%s.ds", (char*)invfilename);
+		learner->save2file(filename);
+#endif
+		sprintf(filename, "%s.inv", (char*)invfilename);
+		std::ofstream invFile(filename);
+		std::string invariant = (p != NULL) ? learner->invariant(0) : candidate;
+		invFile << invariant;
+		invFile.close();
+		// the invariant and its canonical form, by which verify.sh memoizes its verification
+		sprintf(filename, "%s.canon", (char*)invfilename);
+		if (p != NULL) {
+			std::ofstream canonFile(filename);
+			canonFile << invariant << "\n" << learner->canonicalInvariant(0) << "\n";
+			canonFile.close();
+		} else {
+			remove(filename);
+		}
+	}
+	// the counter examples replayed are among the executions, so the next runs start from them as well
+	if ((state->sample_library != NULL) && !state->sample_library->flush())
+		IIF_LOG(LOG_LEARN, LOG_WARN) << "Can not write the sample library " << state->sample_library->path() << "\n";
+	// the run is over, the next one starts from scratch
+	if (!checkpoint_path.empty())
+		remove(checkpoint_path.c_str());
+	running = NULL;
+	// the SVM trained outside of learn(), e.g. by a test, has no deadline
+	TimeBudget::setThreadDeadline(TimeBudget::Clock::time_point::max());
+	IIF_LOG(LOG_LEARN, LOG_INFO) << MemoryTracker::summary() << "\n";
+	if (profiled)
+		Profiler::close();
+	profiled = false;
+#ifdef __linux__
+	disarmAlarm(alarmSeconds(timeout), state);
+#endif
+	if (state->counter_example)
+		return -2;
+	return (learner != NULL) ? 0 : -1;
+}
+
 int iifContext::learn(const char* last_cnt_fname, const char* invfilename, int times) {
-#ifdef linux
+#ifdef __linux__
 	// we only support timeout in LINUX system
 	// Because don't know how to easily implement the same function in windows system...:( 
+	// The learners stop by themselves once the budget runs out, see TimeBudget.
+	// The alarm is left for a round which does not return, e.g. on a loop which does not terminate.
 	if (signal(SIGALRM, sig_alrm) == SIG_ERR)
-		exit(-1);
-	alarm(timeout);
+		return -1;
+	// it is disarmed by finish()
+	armAlarm(alarmSeconds(timeout), state);
 #endif
-#ifdef __PRT_STATISTICS
 #if 0
 	std::ofstream of1("../tmp/statistics", std::ofstream::app);
 	struct timeval tv;
@@ -161,34 +571,59 @@ int iifContext::learn(const char* last_cnt_fname, const char* invfilename, int t
 	of1 << buf << "\t\t";
 	of1.close();
 #endif
-#endif
+
+	ContextBinding bind(state);
+	state->budget.start(timeout);
+	state->counter_example = false;
+
+	// per round timing goes to <invfilename>.prof.csv
+	profiled = Profiler::open(invfilename);
 
 	LearnerNode* p = first;
-	char filename[256]; 
-	if (p && last_cnt_fname) 
-#ifdef __PRT
+	bool multiple = (p != NULL) && (p->next != NULL);
+	// the learners running in parallel have no common round to save
+	checkpoint_path.clear();
+	if (!checkpoint_file.empty() && !(portfolio && multiple))
+		checkpoint_path = (checkpoint_file == "1") ? std::string(invfilename) + ".ckpt" : checkpoint_file;
+	if ((resumed == NULL) && !checkpoint_path.empty() && loadCheckpoint(checkpoint_path.c_str()))
+		checkpoint_saved = time(NULL);
+
+	// the executions restored by a snapshot are only marked as known
+	if (p != NULL)
+		loadSampleLibrary(p->learner, resumed == NULL);
+
+	if (resumed != NULL) {
+		// the counter examples are already in the states restored
+		p = resumed;
+		resumed = NULL;
+	} else if (p && last_cnt_fname) {
 		//std::cout << "Test on counter example ...\n";
-#endif
 		p->learner->runCounterExampleFile(last_cnt_fname);
-#ifdef __PRT
 		//std::cout << "Test on counter example DONE...\n";
-#endif
+	}
+	// the counter examples and the sample library may already violate the postcondition
+	if (state->counter_example)
+		return finish(NULL, invfilename);
 
-	while (p) {
-		if (p->learner->learn() == 0) {
-#ifdef __DS_ENABLED
-			//p->learner->save2file(filename);
-			sprintf(filename, "%s.ds", (char*)invfilename);
-			p->learner->save2file(filename);
-#endif
-			sprintf(filename, "%s.inv", (char*)invfilename);
-			std::ofstream invFile(filename);
-			invFile << p->learner->invariant(0);
-			invFile.close();
-			return 0;
-		} else {
-			p = p->next;
-		}
+	if (portfolio && multiple)
+		return finish(learnPortfolio(), invfilename);
+
+	for (LearnerNode* node = first; node != NULL; node = node->next)
+		node->learner->setRoundListener(checkpoint_path.empty() ? NULL : this);
+	int learners = 0;
+	for (LearnerNode* node = p; node != NULL; node = node->next)
+		learners++;
+	// each learner gets its share of what is left, what it does not use goes to the next ones
+	while (p && !state->budget.expired()) {
+		running = p;
+		p->learner->setTimeSlice(state->budget.slice(learners--));
+		int ret = p->learner->learn();
+		if (ret == 0)
+			return finish(p, invfilename);
+		// no invariant exists, the next learners would find the same counter example
+		if (ret == -2)
+			break;
+		p = p->next;
 	}
-	return -1;
+	return finish(NULL, invfilename);
 }
@@ -5,90 +5,232 @@
 #include "instrumentation.h"
 #include <assert.h>
 
-bool _passP = false;
-bool _passQ = false;
-int assume_times = 0;
-int assert_times = 0;
 char lt[4][10] =  { "Negative", "Question", "Positive", "Bugtrace"};
 char(*LabelTable)[10] = &lt[1];
 
-double program_states[MstatesIn1trace * 2][Nv];
-int state_index;
-
 #include "color.h"
-int addStateInt(int first ...)
+#include "classifier.h"
+#include <algorithm>
+
+// all the book keeping of an execution is kept by the current context, see ContextState
+
+bool setTraceSampling(int policy, int k)
 {
-	if (state_index >= 0.9 * MstatesIn1trace)
-		if (rand() % (100 * state_index / MstatesIn1trace) > 1)
-			return 0;
-	if (state_index >= 0.999 * MstatesIn1trace)
-		return 0;
-	va_list ap;
-	va_start(ap, first);
-	program_states[state_index][0] = first;
-	for (int i = 1; i < Nv; i++) {
-		program_states[state_index][i] = va_arg(ap, int);
+	ContextState* c = current_context;
+	if ((policy < SAMPLE_LEGACY) || (policy > SAMPLE_SIGN_CHANGE))
+		return false;
+	if (k < 2) k = 2;
+	if (k > MstatesIn1trace) k = MstatesIn1trace;
+	c->sampling_policy = policy;
+	c->sampling_k = k;
+	return true;
+}
+
+static inline void storeState(int pos, const double* state)
+{
+	ContextState* c = current_context;
+	for (int i = 0; i < Nv; i++)
+		c->program_states[pos][i] = state[i];
+}
+
+static int classifyState(const double* state)
+{
+	ContextState* c = current_context;
+	double v[Nv];
+	for (int i = 0; i < Nv; i++)
+		v[i] = state[i];
+	for (int i = 0; i < c->sampling_classifier->size; i++)
+		if (Polynomial::calc(*(*c->sampling_classifier)[i], v) < 0)
+			return -1;
+	return 1;
+}
+
+/// move the kept states into the order given by order[0, n)
+static void reorderStates(const int* order, int n)
+{
+	ContextState* c = current_context;
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < Nv; j++)
+			c->reorder_buffer[i][j] = c->program_states[order[i]][j];
+	memcpy(c->program_states, c->reorder_buffer, n * sizeof(double) * Nv);
+}
+
+static bool seqLess(int a, int b) { return current_context->state_seq[a] < current_context->state_seq[b]; }
+
+int addState(const double* state)
+{
+	ContextState* c = current_context;
+	// states recorded inline by iif_record are all kept
+	if (c->trace_length < c->state_index)
+		c->trace_length = c->state_index;
+	int seq = c->trace_length++;
+	bool kept = false;
+
+	switch (c->sampling_policy) {
+		case SAMPLE_LEGACY:
+			if (c->state_index >= 0.9 * MstatesIn1trace)
+				if (rand() % (100 * c->state_index / MstatesIn1trace) > 1)
+					return 0;
+			if (c->state_index >= 0.999 * MstatesIn1trace)
+				return 0;
+			storeState(c->state_index++, state);
+			kept = true;
+			break;
+
+		case SAMPLE_RESERVOIR:
+			if (c->record_fast_limit > 0) {
+				for (int i = 0; i < c->state_index; i++)
+					c->state_seq[i] = i;
+			}
+			if (c->state_index < c->sampling_k) {
+				c->state_seq[c->state_index] = seq;
+				storeState(c->state_index++, state);
+				kept = true;
+			} else {
+				int j = rand() % (seq + 1);
+				if (j < c->sampling_k) {
+					c->state_seq[j] = seq;
+					storeState(j, state);
+					kept = true;
+				}
+			}
+			break;
+
+		case SAMPLE_STRIDE:
+			// the i-th kept state is always the (i * stride)-th state of the trace
+			if (seq % c->stride != 0)
+				break;
+			if (c->state_index >= c->sampling_k) {
+				int half = (c->state_index + 1) / 2;
+				for (int i = 1; i < half; i++)
+					storeState(i, c->program_states[2 * i]);
+				c->state_index = half;
+				c->stride *= 2;
+				if (seq % c->stride != 0)
+					break;
+			}
+			storeState(c->state_index++, state);
+			kept = true;
+			break;
+
+		case SAMPLE_FIRST_LAST:
+			// the first k states are recorded inline, the last k are kept in a ring after them
+			storeState(c->sampling_k + (seq - c->sampling_k) % c->sampling_k, state);
+			if (c->state_index < 2 * c->sampling_k)
+				c->state_index++;
+			kept = true;
+			break;
+
+		case SAMPLE_SIGN_CHANGE:
+			{
+				int sign = (c->sampling_classifier != NULL) ? classifyState(state) : 0;
+				bool changed = (seq == 0) || (c->sampling_classifier == NULL) || (sign != c->last_sign);
+				c->last_sign = sign;
+				if (!changed)
+					break;
+				// keep both sides of the change
+				if ((seq > 0) && !c->last_kept && (c->state_index < c->sampling_k))
+					storeState(c->state_index++, c->last_state);
+				if (c->state_index < c->sampling_k) {
+					storeState(c->state_index++, state);
+					kept = true;
+				}
+			}
+			break;
 	}
-	va_end(ap);
 
-#ifdef __PRT_TRACE
-	std::cout << BLUE << "(" << program_states[state_index][0];
-	for (int i = 1; i < Nv; i++) {
-		std::cout << "," << program_states[state_index][i];
+	if (c->sampling_policy != SAMPLE_LEGACY) {
+		c->record_fast_limit = 0;
+		for (int i = 0; i < Nv; i++)
+			c->last_state[i] = state[i];
+		c->last_kept = kept;
 	}
-	std::cout << ")" << NORMAL;
-#endif
 
-	state_index++;
-	if (state_index >= MstatesIn1trace) {
-		std::cout << RED << "\nToo many states (>" << MstatesIn1trace << 
-			") in one execution. Stop here.\n" << NORMAL;
-		exit(-1);
+	if (kept && Logger::enabled(LOG_STATES, LOG_TRACE)) {
+		LogRecord record(LOG_TRACE);
+		record.stream() << BLUE << "(" << state[0];
+		for (int i = 1; i < Nv; i++) {
+			record.stream() << "," << state[i];
+		}
+		record.stream() << ")" << NORMAL;
 	}
 	return 0;
 }
 
-int addStateDouble(double first, ...)
+/// put the kept states back into their order in the trace, and make sure the last state is kept
+static void finishTrace()
 {
-	if (state_index >= 0.9 * MstatesIn1trace)
-		if (rand() % (100 * state_index / MstatesIn1trace) > 1)
-			return 0;
-	if (state_index >= 0.999 * MstatesIn1trace)
-		return 0;
+	ContextState* c = current_context;
+	if (c->sampling_policy == SAMPLE_LEGACY)
+		return;
+	int order[MstatesIn1trace * 2];
+	if ((c->sampling_policy == SAMPLE_RESERVOIR) && (c->trace_length > c->sampling_k)) {
+		for (int i = 0; i < c->state_index; i++)
+			order[i] = i;
+		std::sort(order, order + c->state_index, seqLess);
+		reorderStates(order, c->state_index);
+	}
+	if ((c->sampling_policy == SAMPLE_FIRST_LAST) && (c->trace_length > 2 * c->sampling_k)) {
+		int oldest = (c->trace_length - c->sampling_k) % c->sampling_k;
+		for (int i = 0; i < c->sampling_k; i++)
+			order[i] = i;
+		for (int i = 0; i < c->sampling_k; i++)
+			order[c->sampling_k + i] = c->sampling_k + (oldest + i) % c->sampling_k;
+		reorderStates(order, c->state_index);
+	}
+	if (!c->last_kept)
+		storeState(c->state_index++, c->last_state);
+}
+
+int addStateInt(int first ...)
+{
+	double state[Nv];
 	va_list ap;
 	va_start(ap, first);
-	program_states[state_index][0] = first;
+	state[0] = first;
 	for (int i = 1; i < Nv; i++) {
-		program_states[state_index][i] = va_arg(ap, double);
+		state[i] = va_arg(ap, int);
 	}
 	va_end(ap);
+	return addState(state);
+}
 
-#ifdef __PRT_TRACE
-	std::cout << BLUE << "(" << program_states[state_index][0];
+int addStateDouble(double first, ...)
+{
+	double state[Nv];
+	va_list ap;
+	va_start(ap, first);
+	state[0] = first;
 	for (int i = 1; i < Nv; i++) {
-		std::cout << "," << program_states[state_index][i];
-	}
-	std::cout << ")" << NORMAL;
-#endif
-
-	state_index++;
-	if (state_index >= MstatesIn1trace) {
-		std::cout << RED << "\nToo many states (>" << MstatesIn1trace << 
-			") in one execution. Stop here.\n" << NORMAL;
-		exit(-1);
+		state[i] = va_arg(ap, double);
 	}
-	return 0;
+	va_end(ap);
+	return addState(state);
 }
 
 
 int beforeLoop()
 {
 	//std::cout << "---> before_loop";
-	state_index = 0;
-	_passP = false;
-	_passQ = false;
-	assume_times = 0;
-	assert_times = 0;
+	ContextState* c = current_context;
+	c->state_index = 0;
+	c->trace_length = 0;
+	c->stride = 1;
+	c->last_kept = true;
+	c->last_sign = 0;
+	if (c->sampling_policy == SAMPLE_LEGACY)
+		c->record_fast_limit = MstatesIn1trace * 9 / 10;
+	else if (c->sampling_policy == SAMPLE_SIGN_CHANGE)
+		c->record_fast_limit = 0;
+	else
+		c->record_fast_limit = c->sampling_k;
+	// every state goes through addState to be logged
+	if (Logger::enabled(LOG_STATES, LOG_TRACE))
+		c->record_fast_limit = 0;
+	c->passP = false;
+	c->passQ = false;
+	c->assume_times = 0;
+	c->assert_times = 0;
 	//std::cout << "[done]";
 	return 0;
 }
@@ -96,14 +238,16 @@ int beforeLoop()
 
 int afterLoop(States* gsets)
 {
+	ContextState* c = current_context;
 	int label = 0;
-	assert(assume_times == 1);
-	assert(assert_times == 1);
-	if (_passP && _passQ) {
+	finishTrace();
+	assert(c->assume_times == 1);
+	assert(c->assert_times == 1);
+	if (c->passP && c->passQ) {
 		label = POSITIVE;
-	} else if (!_passP && !_passQ) {
+	} else if (!c->passP && !c->passQ) {
 		label = NEGATIVE; 
-	} else if (!_passP && _passQ) {
+	} else if (!c->passP && c->passQ) {
 #ifdef __QAS_POSITIVE
 		//std::cout << "?->+ ";
 		label = POSITIVE; 
@@ -114,47 +258,51 @@ int afterLoop(States* gsets)
 		//std::cout << "?->? ";
 		label = QUESTION; 
 #endif
-	} else if (_passP && !_passQ) {
+	} else if (c->passP && !c->passQ) {
 		label = CNT_EMPL;
-		std::cout << RED << "\ncounter-example trace:  ";
-		for (int i = 0; i < state_index; i++) {
-			std::cout << "(" << program_states[i][0];
-			for (int j = 1; j < Nv; j++)
-				std::cout << "," << program_states[i][j];
-			std::cout << ")->";
+		if (Logger::enabled(LOG_STATES, LOG_INFO)) {
+			LogRecord record(LOG_INFO);
+			record.stream() << RED << "\ncounter-example trace:  ";
+			for (int i = 0; i < c->state_index; i++) {
+				record.stream() << "(" << c->program_states[i][0];
+				for (int j = 1; j < Nv; j++)
+					record.stream() << "," << c->program_states[i][j];
+				record.stream() << ")->";
+			}
+			record.stream() << "END[x]" << NORMAL << std::endl;
 		}
-		std::cout << "END[x]" << NORMAL << std::endl;
 	}
 
-#ifdef __PRT_TRACE
-	std::cout << BLUE << "TRACE: ";
-	for (int i = 0; i < state_index; i++) {
-		std::cout << "(" << program_states[i][0];
-		for (int j = 1; j < Nv; j++)
-			std::cout << "," << program_states[i][j];
-		std::cout << ")->";
+	if (Logger::enabled(LOG_STATES, LOG_TRACE)) {
+		LogRecord record(LOG_TRACE);
+		record.stream() << BLUE << "TRACE: ";
+		for (int i = 0; i < c->state_index; i++) {
+			record.stream() << "(" << c->program_states[i][0];
+			for (int j = 1; j < Nv; j++)
+				record.stream() << "," << c->program_states[i][j];
+			record.stream() << ")->";
+		}
+		record.stream() << "END[" << label << "]" << NORMAL << std::endl;
 	}
-	std::cout << "END[" << label << "]" << NORMAL << std::endl;
-#endif
 
 	if (label == POSITIVE || label == NEGATIVE || label == QUESTION)
-		gsets[label].addStates(program_states, state_index);
+		gsets[label].addStates(c->program_states, c->state_index);
 	return label;
 }
 
 void printRunResult(int rr) {
 	switch (rr) {
 		case NEGATIVE:
-			std::cout << "-";
+			IIF_LOG(LOG_SAMPLE, LOG_INFO) << "-";
 			return;
 		case QUESTION:
-			std::cout << "?";
+			IIF_LOG(LOG_SAMPLE, LOG_INFO) << "?";
 			return;
 		case POSITIVE:
-			std::cout << "+";
+			IIF_LOG(LOG_SAMPLE, LOG_INFO) << "+";
 			return;
 		case CNT_EMPL:
-			std::cout << "x";
+			IIF_LOG(LOG_SAMPLE, LOG_INFO) << "x";
 			return;
 	}
 }
@@ -167,4 +315,4 @@ int mDouble(double* p)
 	return mInt(a);
 }
 
-int mInt(int* p) { return target_program(p); }
+int mInt(int* p) { return current_context->target_program(p); }
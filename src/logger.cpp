@@ -0,0 +1,192 @@
+/** @file logger.cpp
+ *  @brief Implementation of the asynchronous logger.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "logger.h"
+#include <iostream>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+static const char* level_names[] = { "error", "warn", "info", "debug", "trace" };
+static const char* topic_names[LOG_TOPIC_NUM] = { "learn", "sample", "states", "svm", "svm_i",
+	"poly", "solve", "query", "infer" };
+
+int Logger::levels[LOG_TOPIC_NUM] = { LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO,
+	LOG_INFO, LOG_INFO, LOG_INFO, LOG_INFO };
+
+/*
+ * The writer state is allocated on first use and never freed,
+ * so that messages logged during static destruction or from atexit handlers are still written.
+ */
+struct LogWriter {
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::condition_variable drained;
+	std::deque<std::pair<int, std::string> > queue;
+	bool writing;
+	bool stopped;
+	std::thread thread;
+
+	LogWriter() : writing(false), stopped(false) {}
+
+	void run() {
+		std::deque<std::pair<int, std::string> > batch;
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			ready.wait(lock, [this] { return stopped || !queue.empty(); });
+			if (queue.empty() && stopped) break;
+			batch.swap(queue);
+			writing = true;
+			lock.unlock();
+			bool out = false, err = false;
+			for (size_t i = 0; i < batch.size(); i++) {
+				if (batch[i].first == LOG_ERROR) {
+					std::cerr << batch[i].second;
+					err = true;
+				} else {
+					std::cout << batch[i].second;
+					out = true;
+				}
+			}
+			if (out) std::cout.flush();
+			if (err) std::cerr.flush();
+			batch.clear();
+			lock.lock();
+			writing = false;
+			drained.notify_all();
+		}
+	}
+};
+
+static LogWriter* writer = NULL;
+static std::once_flag writer_once;
+
+static void stopWriter() {
+	// exit can be called by a signal handler which interrupted a logging call,
+	// so do not wait forever for the lock
+	std::unique_lock<std::mutex> lock(writer->mutex, std::defer_lock);
+	for (int tries = 0; !lock.try_lock(); tries++) {
+		if (tries >= 1000) return;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	writer->stopped = true;
+	lock.unlock();
+	writer->ready.notify_one();
+	if (writer->thread.joinable())
+		writer->thread.join();
+}
+
+static void startWriter() {
+	writer = new LogWriter();
+	writer->thread = std::thread(&LogWriter::run, writer);
+	atexit(stopWriter);
+}
+
+static void enqueue(int level, const std::string& text) {
+	if (text.empty()) return;
+	std::call_once(writer_once, startWriter);
+	{
+		std::lock_guard<std::mutex> lock(writer->mutex);
+		if (writer->stopped) {
+			// the writer thread is gone at exit, write it directly
+			(level == LOG_ERROR ? std::cerr : std::cout) << text << std::flush;
+			return;
+		}
+		writer->queue.push_back(std::make_pair(level, text));
+	}
+	writer->ready.notify_one();
+}
+
+/*
+ * The text of the line the thread is writing, queued once the line ends,
+ * so that the lines of threads logging at the same time do not interleave.
+ * What is left when the thread ends is queued as it is.
+ */
+struct PendingLine {
+	std::string text;
+
+	~PendingLine() { enqueue(LOG_INFO, text); }
+};
+
+static thread_local PendingLine pending;
+
+void Logger::push(int level, const std::string& text) {
+	if (text.empty()) return;
+	if (level == LOG_ERROR) {
+		enqueue(level, text);
+		return;
+	}
+	size_t end = text.find_last_of('\n');
+	if (end == std::string::npos) {
+		pending.text += text;
+		return;
+	}
+	pending.text.append(text, 0, end + 1);
+	enqueue(level, pending.text);
+	pending.text.assign(text, end + 1, std::string::npos);
+}
+
+void Logger::flush() {
+	if (!pending.text.empty()) {
+		enqueue(LOG_INFO, pending.text);
+		pending.text.clear();
+	}
+	if (writer == NULL) return;
+	std::unique_lock<std::mutex> lock(writer->mutex);
+	writer->drained.wait(lock, [] { return writer->stopped || (writer->queue.empty() && !writer->writing); });
+}
+
+void Logger::setLevel(int level) {
+	for (int i = 0; i < LOG_TOPIC_NUM; i++)
+		levels[i] = level;
+}
+
+void Logger::setLevel(int topic, int level) {
+	if ((topic >= 0) && (topic < LOG_TOPIC_NUM))
+		levels[topic] = level;
+}
+
+static int parseLevel(const char* s, size_t len) {
+	for (int i = LOG_ERROR; i <= LOG_TRACE; i++)
+		if ((strlen(level_names[i]) == len) && (strncasecmp(s, level_names[i], len) == 0))
+			return i;
+	return -1;
+}
+
+bool Logger::configure(const char* spec) {
+	if (spec == NULL) return true;
+	bool ok = true;
+	std::string s(spec);
+	size_t begin = 0;
+	while (begin <= s.size()) {
+		size_t end = s.find(',', begin);
+		if (end == std::string::npos) end = s.size();
+		std::string item = s.substr(begin, end - begin);
+		begin = end + 1;
+		if (item.empty()) continue;
+
+		size_t eq = item.find('=');
+		if (eq == std::string::npos) {
+			int level = parseLevel(item.c_str(), item.size());
+			if (level < 0) ok = false;
+			else setLevel(level);
+			continue;
+		}
+		int level = parseLevel(item.c_str() + eq + 1, item.size() - eq - 1);
+		int topic = -1;
+		for (int i = 0; i < LOG_TOPIC_NUM; i++)
+			if (item.compare(0, eq, topic_names[i]) == 0)
+				topic = i;
+		if ((level < 0) || (topic < 0)) ok = false;
+		else setLevel(topic, level);
+	}
+	return ok;
+}
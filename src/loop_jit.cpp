@@ -0,0 +1,141 @@
+/** @file loop_jit.cpp
+ *  @brief Compile the loops into shared objects and load them, see loop_jit.h.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "loop_jit.h"
+#include "context_state.h"
+#include "instrumentation.h"
+#include "logger.h"
+#include "loop_key.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <dlfcn.h>
+#include <unistd.h>
+
+/// the same as iif_record, on the state of the names
+static void jitRecord(const int* values) {
+	ContextState* c = current_context;
+	if (c->state_index < c->record_fast_limit) {
+		double* dst = c->program_states[c->state_index++];
+		for (int i = 0; i < Nv; i++)
+			dst[i] = values[i];
+		return;
+	}
+	double state[Nv];
+	for (int i = 0; i < Nv; i++)
+		state[i] = values[i];
+	addState(state);
+}
+
+static void jitAssume(int pass) {
+	current_context->passP = (pass != 0);
+	current_context->assume_times++;
+}
+
+static void jitAssert(int pass) {
+	current_context->passQ = (pass != 0);
+	current_context->assert_times++;
+}
+
+/// the loops loaded by this process, by the hash of their source, they stay loaded until it exits
+static std::map<std::string, LoopFunction> loaded;
+static std::mutex loaded_mutex;
+
+/// set the hook named name of the object to hook
+static bool setHook(void* handle, const char* name, void* hook) {
+	void** p = (void**)dlsym(handle, name);
+	if (p == NULL)
+		return false;
+	*p = hook;
+	return true;
+}
+
+static LoopFunction load(const std::string& object, std::string& message) {
+	void* handle = dlopen(object.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (handle == NULL) {
+		message = dlerror();
+		return NULL;
+	}
+	LoopFunction func = (LoopFunction)dlsym(handle, "iif_jit_loop");
+	if ((func == NULL) || !setHook(handle, "iif_jit_record", (void*)jitRecord)
+			|| !setHook(handle, "iif_jit_assume", (void*)jitAssume) || !setHook(handle, "iif_jit_assert", (void*)jitAssert)) {
+		message = object + " is not a compiled loop";
+		dlclose(handle);
+		return NULL;
+	}
+	return func;
+}
+
+LoopFunction compileLoopProgram(const LoopProgram& program, std::string& message) {
+	const char* cc = getenv("IIF_JIT_CC");
+	std::string compiler = ((cc != NULL) && (*cc != '\0')) ? cc : "cc -O2";
+	const char* dir = getenv("IIF_JIT_DIR");
+	std::string folder = ((dir != NULL) && (*dir != '\0')) ? dir : "../tmp/jit";
+
+	// the compiler is part of the source kept, so that another compiler does not reuse the object
+	std::string source = "/* " + compiler + " */\n" + program.toC("iif_jit_loop");
+	std::string hash = hashName(fnv1a(source));
+
+	std::lock_guard<std::mutex> lock(loaded_mutex);
+	std::map<std::string, LoopFunction>::iterator it = loaded.find(hash);
+	if (it != loaded.end())
+		return it->second;
+
+	// the object is reused only if the source kept next to it is the same, the hash may collide
+	std::string object = folder + "/" + hash + ".so";
+	std::string csource = folder + "/" + hash + ".c";
+	std::ifstream fin(csource.c_str());
+	std::string kept((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	fin.close();
+	if ((kept == source) && (access(object.c_str(), R_OK) == 0)) {
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "jit: reuse " << object << "\n";
+	} else {
+		// concurrent processes may compile the same loop, the last one replaces the object and its source
+		char partial[64];
+		snprintf(partial, sizeof(partial), ".%d", (int)getpid());
+		if (!makeFolders(folder.c_str())) {
+			message = "can not create " + folder;
+			return NULL;
+		}
+		std::string ctemp = folder + "/" + hash + partial + ".c";
+		{
+			std::ofstream fout(ctemp.c_str());
+			fout << source;
+			if (!fout) {
+				message = "can not write " + ctemp;
+				return NULL;
+			}
+		}
+		std::string command = compiler + " -fPIC -shared -o " + object + partial + " " + ctemp + " 2>&1";
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "jit: compile " << object << "\n";
+		FILE* pipe = popen(command.c_str(), "r");
+		if (pipe == NULL) {
+			message = "can not run " + compiler;
+			return NULL;
+		}
+		std::string output;
+		char buf[256];
+		while (fgets(buf, sizeof(buf), pipe) != NULL)
+			output += buf;
+		int status = pclose(pipe);
+		if ((status != 0) || (rename((object + partial).c_str(), object.c_str()) != 0)
+				|| (rename(ctemp.c_str(), csource.c_str()) != 0)) {
+			unlink((object + partial).c_str());
+			unlink(ctemp.c_str());
+			message = "can not compile " + csource + " by " + compiler + (output.empty() ? "" : ": " + output);
+			return NULL;
+		}
+	}
+
+	LoopFunction func = load(object, message);
+	if (func != NULL)
+		loaded[hash] = func;
+	return func;
+}
@@ -0,0 +1,1079 @@
+/** @file loop_program.cpp
+ *  @brief Parse the loops of cfg files, compile them into register bytecode, and run it, see loop_program.h.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "loop_program.h"
+#include "context_state.h"
+#include "instrumentation.h"
+#include "iif.h"
+#include "loop_key.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cstring>
+#include <climits>
+#include <map>
+
+//**********************************************************************************************
+// cfg
+//**********************************************************************************************
+
+static const char* cfg_keys[] = { "names", "beforeloop", "beforeloopinit", "symbolic", "precondition",
+	"loopcondition", "loop", "postcondition", "afterloop", "sampling", "deterministic", "learners" };
+enum { KEY_NAMES, KEY_BEFORELOOP, KEY_BEFORELOOPINIT, KEY_SYMBOLIC, KEY_PRECONDITION, KEY_LOOPCONDITION,
+	KEY_LOOP, KEY_POSTCONDITION, KEY_AFTERLOOP, KEY_SAMPLING, KEY_DETERMINISTIC, KEY_LEARNERS, KEY_NUM };
+
+static std::vector<std::string> splitWords(const std::string& s) {
+	std::vector<std::string> words;
+	std::istringstream sin(s);
+	std::string word;
+	while (sin >> word)
+		words.push_back(word);
+	return words;
+}
+
+static bool isBlank(const std::string& s) {
+	return s.find_first_not_of(" \t\r\n") == std::string::npos;
+}
+
+
+//**********************************************************************************************
+// int arithmetic of the loops, wrapping around on overflow
+//**********************************************************************************************
+
+static inline int addInt(int a, int b) { return static_cast<int>(static_cast<unsigned>(a) + static_cast<unsigned>(b)); }
+static inline int subInt(int a, int b) { return static_cast<int>(static_cast<unsigned>(a) - static_cast<unsigned>(b)); }
+static inline int mulInt(int a, int b) { return static_cast<int>(static_cast<unsigned>(a) * static_cast<unsigned>(b)); }
+static inline int negInt(int a) { return static_cast<int>(0u - static_cast<unsigned>(a)); }
+static inline int divInt(int a, int b) {
+	if (b == 0) return 0;
+	if (b == -1) return negInt(a);
+	return a / b;
+}
+static inline int modInt(int a, int b) {
+	if ((b == 0) || (b == -1)) return 0;
+	return a % b;
+}
+
+
+//**********************************************************************************************
+// tokens
+//**********************************************************************************************
+
+enum { TOK_END, TOK_NUM, TOK_ID, TOK_OP };
+
+struct Token {
+	int kind;
+	std::string text;
+	int value;
+};
+
+static bool tokenize(const std::string& src, std::vector<Token>& tokens, std::string& message) {
+	static const char* long_ops[] = { "++", "--", "+=", "-=", "*=", "/=", "%=", "==", "!=", "<=", ">=", "&&", "||" };
+	static const char* short_ops = "+-*/%<>=!(){};,";
+	size_t i = 0;
+	while (i < src.size()) {
+		unsigned char ch = src[i];
+		if (isspace(ch)) {
+			i++;
+			continue;
+		}
+		if (src.compare(i, 2, "//") == 0) {
+			while ((i < src.size()) && (src[i] != '\n')) i++;
+			continue;
+		}
+		if (src.compare(i, 2, "/*") == 0) {
+			size_t end = src.find("*/", i + 2);
+			if (end == std::string::npos) {
+				message = "unterminated comment";
+				return false;
+			}
+			i = end + 2;
+			continue;
+		}
+		Token t;
+		t.value = 0;
+		size_t j = i + 1;
+		if (isdigit(ch)) {
+			while ((j < src.size()) && isalnum(static_cast<unsigned char>(src[j]))) j++;
+			t.kind = TOK_NUM;
+			t.text = src.substr(i, j - i);
+			char* end;
+			// constants out of int are cut as the int of the loop would
+			t.value = static_cast<int>(strtoll(t.text.c_str(), &end, 0));
+			if (*end != '\0') {
+				message = "bad number " + t.text;
+				return false;
+			}
+		} else if (isalpha(ch) || (ch == '_')) {
+			while ((j < src.size()) && (isalnum(static_cast<unsigned char>(src[j])) || (src[j] == '_'))) j++;
+			t.kind = TOK_ID;
+			t.text = src.substr(i, j - i);
+		} else {
+			t.kind = TOK_OP;
+			for (size_t k = 0; k < sizeof(long_ops) / sizeof(long_ops[0]); k++)
+				if (src.compare(i, 2, long_ops[k]) == 0) {
+					j = i + 2;
+					break;
+				}
+			if ((j == i + 1) && (strchr(short_ops, ch) == NULL)) {
+				message = std::string("unexpected character ") + static_cast<char>(ch);
+				return false;
+			}
+			t.text = src.substr(i, j - i);
+		}
+		tokens.push_back(t);
+		i = j;
+	}
+	Token end;
+	end.kind = TOK_END;
+	end.text = "the end of the loop";
+	end.value = 0;
+	tokens.push_back(end);
+	return true;
+}
+
+
+//**********************************************************************************************
+// compiler
+//**********************************************************************************************
+
+/// the logical operators of the expression trees, besides the opcodes
+enum { LOGIC_AND = 1000, LOGIC_OR };
+
+/** \class LoopCompiler
+ *  @brief Parses the loop function by recursive descent into expression trees, and emits the bytecode
+ *		   of each statement as soon as it is parsed.
+ *
+ *	While compiling, the operands of the instructions are the registers of the variables,
+ *	or tagged by REG_CONSTANT or REG_TEMP, as the numbers of variables and constants are only known at the end.
+ *	Temporaries only live inside one statement.
+ */
+class LoopCompiler {
+	public:
+		explicit LoopCompiler(LoopProgram& program) : program(program), pos(0), failed(false),
+			local_num(Nv), temp_num(0), temp_max(0) {}
+
+		bool compile(const std::string& source);
+
+	private:
+		enum { REG_CONSTANT = 1 << 20, REG_TEMP = 1 << 21, REG_MASK = (1 << 20) - 1 };
+		enum { N_NUM, N_VAR, N_RAND, N_UNARY, N_BINARY };
+
+		struct Node {
+			int kind;
+			int op;
+			int value;
+			int left;
+			int right;
+		};
+
+		struct Code {
+			int op, a, b, c;
+		};
+
+		struct LoopJumps {
+			std::vector<int> breaks;
+			std::vector<int> continues;
+		};
+
+		int fail(const std::string& what) {
+			if (!failed)
+				program.message = what;
+			failed = true;
+			return -1;
+		}
+
+		const Token& peek() const { return tokens[pos]; }
+		bool isOp(const char* op) const { return (peek().kind == TOK_OP) && (peek().text == op); }
+		bool isWord(const char* word) const { return (peek().kind == TOK_ID) && (peek().text == word); }
+
+		bool accept(const char* op) {
+			if (!isOp(op)) return false;
+			pos++;
+			return true;
+		}
+
+		bool expect(const char* op) {
+			if (accept(op)) return true;
+			fail(std::string("expected ") + op + " near " + peek().text);
+			return false;
+		}
+
+		// expressions
+		int node(int kind, int op, int value, int left, int right);
+		int binary(int op, int left, int right);
+		int parseExpression(int level = 0);
+		int parseUnary();
+		int parsePrimary();
+
+		// emission
+		int emit(int op, int a, int b, int c);
+		int here() const { return static_cast<int>(code.size()); }
+		void patch(std::vector<int>& jumps, int target);
+		int constant(int value);
+		int temp();
+		int emitValue(int n, int dst);
+		void emitCondition(int n, bool when, std::vector<int>& jumps);
+
+		// statements
+		int lookup(const std::string& name);
+		int declare(const std::string& name);
+		int parseVariable();
+		void parseStatement();
+		void parseSimple();
+
+		LoopProgram& program;
+		std::vector<Token> tokens;
+		size_t pos;
+		bool failed;
+		std::vector<Node> nodes;
+		std::vector<Code> code;
+		std::vector<std::map<std::string, int> > scopes;
+		std::vector<LoopJumps> loops;
+		int local_num;
+		int temp_num;
+		int temp_max;
+};
+
+int LoopCompiler::node(int kind, int op, int value, int left, int right) {
+	Node n = { kind, op, value, left, right };
+	nodes.push_back(n);
+	return static_cast<int>(nodes.size()) - 1;
+}
+
+static bool isComparison(int op) {
+	return (op >= LoopProgram::OP_LT) && (op <= LoopProgram::OP_NE);
+}
+
+static int evalBinary(int op, int a, int b) {
+	switch (op) {
+		case LoopProgram::OP_ADD: return addInt(a, b);
+		case LoopProgram::OP_SUB: return subInt(a, b);
+		case LoopProgram::OP_MUL: return mulInt(a, b);
+		case LoopProgram::OP_DIV: return divInt(a, b);
+		case LoopProgram::OP_MOD: return modInt(a, b);
+		case LoopProgram::OP_LT: return a < b;
+		case LoopProgram::OP_LE: return a <= b;
+		case LoopProgram::OP_GT: return a > b;
+		case LoopProgram::OP_GE: return a >= b;
+		case LoopProgram::OP_EQ: return a == b;
+		case LoopProgram::OP_NE: return a != b;
+	}
+	return 0;
+}
+
+int LoopCompiler::binary(int op, int left, int right) {
+	if ((left < 0) || (right < 0)) return -1;
+	// constants are folded, e.g. x = x + 2 * 5
+	if ((nodes[left].kind == N_NUM) && (nodes[right].kind == N_NUM)) {
+		int a = nodes[left].value, b = nodes[right].value;
+		if (op == LOGIC_AND) return node(N_NUM, 0, (a != 0) && (b != 0), -1, -1);
+		if (op == LOGIC_OR) return node(N_NUM, 0, (a != 0) || (b != 0), -1, -1);
+		return node(N_NUM, 0, evalBinary(op, a, b), -1, -1);
+	}
+	return node(N_BINARY, op, 0, left, right);
+}
+
+/// the binary operator of s at the given level of precedence, from || to *, or -1
+static int binaryOperator(const std::string& s, int level) {
+	static const char* texts[] = { "||", "&&", "==", "!=", "<", "<=", ">", ">=", "+", "-", "*", "/", "%" };
+	static const int levels[] = { 0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 5, 5, 5 };
+	static const int ops[] = { LOGIC_OR, LOGIC_AND, LoopProgram::OP_EQ, LoopProgram::OP_NE,
+		LoopProgram::OP_LT, LoopProgram::OP_LE, LoopProgram::OP_GT, LoopProgram::OP_GE,
+		LoopProgram::OP_ADD, LoopProgram::OP_SUB, LoopProgram::OP_MUL, LoopProgram::OP_DIV, LoopProgram::OP_MOD };
+	for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+		if ((levels[i] == level) && (s == texts[i]))
+			return ops[i];
+	return -1;
+}
+
+int LoopCompiler::parseExpression(int level) {
+	if (level > 5)
+		return parseUnary();
+	int left = parseExpression(level + 1);
+	while (!failed && (peek().kind == TOK_OP)) {
+		int op = binaryOperator(peek().text, level);
+		if (op < 0) break;
+		pos++;
+		left = binary(op, left, parseExpression(level + 1));
+	}
+	return failed ? -1 : left;
+}
+
+int LoopCompiler::parseUnary() {
+	if (accept("+"))
+		return parseUnary();
+	if (accept("-")) {
+		int n = parseUnary();
+		if (n < 0) return -1;
+		if (nodes[n].kind == N_NUM) return node(N_NUM, 0, negInt(nodes[n].value), -1, -1);
+		return node(N_UNARY, LoopProgram::OP_NEG, 0, n, -1);
+	}
+	if (accept("!")) {
+		int n = parseUnary();
+		if (n < 0) return -1;
+		if (nodes[n].kind == N_NUM) return node(N_NUM, 0, nodes[n].value == 0, -1, -1);
+		return node(N_UNARY, LoopProgram::OP_NOT, 0, n, -1);
+	}
+	return parsePrimary();
+}
+
+int LoopCompiler::parsePrimary() {
+	const Token& t = peek();
+	if (t.kind == TOK_NUM) {
+		pos++;
+		return node(N_NUM, 0, t.value, -1, -1);
+	}
+	if ((t.kind == TOK_ID) && (t.text == "rand")) {
+		pos++;
+		if (!expect("(") || !expect(")")) return -1;
+		return node(N_RAND, 0, 0, -1, -1);
+	}
+	if (t.kind == TOK_ID) {
+		int reg = lookup(t.text);
+		if (reg < 0) return fail("unknown variable " + t.text);
+		pos++;
+		return node(N_VAR, 0, reg, -1, -1);
+	}
+	if (accept("(")) {
+		int n = parseExpression();
+		if (!expect(")")) return -1;
+		return n;
+	}
+	return fail("unexpected " + t.text);
+}
+
+int LoopCompiler::emit(int op, int a, int b, int c) {
+	Code instr = { op, a, b, c };
+	code.push_back(instr);
+	return here() - 1;
+}
+
+void LoopCompiler::patch(std::vector<int>& jumps, int target) {
+	for (size_t i = 0; i < jumps.size(); i++)
+		code[jumps[i]].c = target;
+	jumps.clear();
+}
+
+int LoopCompiler::constant(int value) {
+	for (size_t i = 0; i < program.constants.size(); i++)
+		if (program.constants[i] == value)
+			return REG_CONSTANT | static_cast<int>(i);
+	program.constants.push_back(value);
+	return REG_CONSTANT | static_cast<int>(program.constants.size() - 1);
+}
+
+int LoopCompiler::temp() {
+	int t = temp_num++;
+	if (temp_num > temp_max) temp_max = temp_num;
+	return REG_TEMP | t;
+}
+
+/// emit the value of node n into dst, or into any register if dst < 0, return the register
+int LoopCompiler::emitValue(int n, int dst) {
+	if (failed || (n < 0)) return 0;
+	const Node nd = nodes[n];
+	int reg;
+	switch (nd.kind) {
+		case N_NUM:
+			reg = constant(nd.value);
+			break;
+		case N_VAR:
+			reg = nd.value;
+			break;
+		case N_RAND:
+			reg = (dst >= 0) ? dst : temp();
+			emit(LoopProgram::OP_RAND, reg, 0, 0);
+			return reg;
+		case N_UNARY: {
+			int src = emitValue(nd.left, -1);
+			reg = (dst >= 0) ? dst : temp();
+			emit(nd.op, reg, src, 0);
+			return reg;
+		}
+		default: {
+			if ((nd.op == LOGIC_AND) || (nd.op == LOGIC_OR)) {
+				reg = (dst >= 0) ? dst : temp();
+				std::vector<int> false_jumps;
+				emitCondition(n, false, false_jumps);
+				emit(LoopProgram::OP_MOVE, reg, constant(1), 0);
+				int end = emit(LoopProgram::OP_JUMP, 0, 0, -1);
+				patch(false_jumps, here());
+				emit(LoopProgram::OP_MOVE, reg, constant(0), 0);
+				code[end].c = here();
+				return reg;
+			}
+			// x + k and x - k, most of the updates of the loops
+			if (((nd.op == LoopProgram::OP_ADD) || (nd.op == LoopProgram::OP_SUB)) && (nodes[nd.right].kind == N_NUM)) {
+				int src = emitValue(nd.left, -1);
+				int k = nodes[nd.right].value;
+				reg = (dst >= 0) ? dst : temp();
+				emit(LoopProgram::OP_ADDI, reg, src, (nd.op == LoopProgram::OP_ADD) ? k : negInt(k));
+				return reg;
+			}
+			if ((nd.op == LoopProgram::OP_ADD) && (nodes[nd.left].kind == N_NUM)) {
+				int src = emitValue(nd.right, -1);
+				reg = (dst >= 0) ? dst : temp();
+				emit(LoopProgram::OP_ADDI, reg, src, nodes[nd.left].value);
+				return reg;
+			}
+			int a = emitValue(nd.left, -1);
+			int b = emitValue(nd.right, -1);
+			reg = (dst >= 0) ? dst : temp();
+			emit(nd.op, reg, a, b);
+			return reg;
+		}
+	}
+	if ((dst >= 0) && (dst != reg)) {
+		emit(LoopProgram::OP_MOVE, dst, reg, 0);
+		return dst;
+	}
+	return reg;
+}
+
+static int negateComparison(int op) {
+	switch (op) {
+		case LoopProgram::OP_LT: return LoopProgram::OP_GE;
+		case LoopProgram::OP_LE: return LoopProgram::OP_GT;
+		case LoopProgram::OP_GT: return LoopProgram::OP_LE;
+		case LoopProgram::OP_GE: return LoopProgram::OP_LT;
+		case LoopProgram::OP_EQ: return LoopProgram::OP_NE;
+	}
+	return LoopProgram::OP_EQ;
+}
+
+/// emit the jumps taken when the truth of node n is when, they are patched by the caller, and fall through otherwise
+void LoopCompiler::emitCondition(int n, bool when, std::vector<int>& jumps) {
+	if (failed || (n < 0)) return;
+	const Node nd = nodes[n];
+	if (nd.kind == N_NUM) {
+		if ((nd.value != 0) == when)
+			jumps.push_back(emit(LoopProgram::OP_JUMP, 0, 0, -1));
+		return;
+	}
+	if ((nd.kind == N_UNARY) && (nd.op == LoopProgram::OP_NOT)) {
+		emitCondition(nd.left, !when, jumps);
+		return;
+	}
+	if ((nd.kind == N_BINARY) && ((nd.op == LOGIC_AND) || (nd.op == LOGIC_OR))) {
+		// jump out as soon as the left side decides
+		bool decides = (nd.op == LOGIC_OR);
+		if (decides == when) {
+			emitCondition(nd.left, when, jumps);
+			emitCondition(nd.right, when, jumps);
+		} else {
+			std::vector<int> skip;
+			emitCondition(nd.left, decides, skip);
+			emitCondition(nd.right, when, jumps);
+			patch(skip, here());
+		}
+		return;
+	}
+	if ((nd.kind == N_BINARY) && isComparison(nd.op)) {
+		int a = emitValue(nd.left, -1);
+		int b = emitValue(nd.right, -1);
+		int op = when ? nd.op : negateComparison(nd.op);
+		jumps.push_back(emit(op - LoopProgram::OP_LT + LoopProgram::OP_JLT, a, b, -1));
+		return;
+	}
+	int reg = emitValue(n, -1);
+	jumps.push_back(emit(when ? LoopProgram::OP_JNZ : LoopProgram::OP_JZ, reg, 0, -1));
+}
+
+int LoopCompiler::lookup(const std::string& name) {
+	for (size_t i = scopes.size(); i > 0; i--) {
+		std::map<std::string, int>::const_iterator it = scopes[i - 1].find(name);
+		if (it != scopes[i - 1].end())
+			return it->second;
+	}
+	return -1;
+}
+
+int LoopCompiler::declare(const std::string& name) {
+	if (scopes.back().count(name) > 0)
+		return fail("redeclaration of " + name);
+	if (local_num >= LoopProgram::max_registers)
+		return fail("too many variables");
+	scopes.back()[name] = local_num;
+	return local_num++;
+}
+
+int LoopCompiler::parseVariable() {
+	if (peek().kind != TOK_ID)
+		return fail("expected a variable near " + peek().text);
+	int reg = lookup(peek().text);
+	if (reg < 0)
+		return fail("unknown variable " + peek().text);
+	pos++;
+	return reg;
+}
+
+/// x = e, x op= e, x++, x--, ++x, --x
+void LoopCompiler::parseSimple() {
+	if (isOp("++") || isOp("--")) {
+		int k = (peek().text == "++") ? 1 : -1;
+		pos++;
+		int reg = parseVariable();
+		if (reg >= 0) emit(LoopProgram::OP_ADDI, reg, reg, k);
+		return;
+	}
+	int reg = parseVariable();
+	if (reg < 0) return;
+	if (accept("++")) {
+		emit(LoopProgram::OP_ADDI, reg, reg, 1);
+		return;
+	}
+	if (accept("--")) {
+		emit(LoopProgram::OP_ADDI, reg, reg, -1);
+		return;
+	}
+	static const char* assigns[] = { "=", "+=", "-=", "*=", "/=", "%=" };
+	static const int ops[] = { -1, LoopProgram::OP_ADD, LoopProgram::OP_SUB, LoopProgram::OP_MUL,
+		LoopProgram::OP_DIV, LoopProgram::OP_MOD };
+	for (int i = 0; i < 6; i++) {
+		if (!accept(assigns[i]))
+			continue;
+		int value = parseExpression();
+		if (value < 0) return;
+		if (ops[i] >= 0)
+			value = binary(ops[i], node(N_VAR, 0, reg, -1, -1), value);
+		emitValue(value, reg);
+		return;
+	}
+	fail("unsupported statement near " + peek().text);
+}
+
+void LoopCompiler::parseStatement() {
+	if (failed) return;
+	temp_num = 0;
+	const Token& t = peek();
+	if (accept("{")) {
+		scopes.push_back(std::map<std::string, int>());
+		while (!failed && !isOp("}")) {
+			if (peek().kind == TOK_END) {
+				fail("expected }");
+				return;
+			}
+			parseStatement();
+		}
+		pos++;
+		scopes.pop_back();
+		return;
+	}
+	if (accept(";"))
+		return;
+	if (t.kind != TOK_ID) {
+		fail("unexpected " + t.text);
+		return;
+	}
+
+	if (t.text == "if") {
+		pos++;
+		if (!expect("(")) return;
+		int cond = parseExpression();
+		if (!expect(")")) return;
+		std::vector<int> false_jumps;
+		emitCondition(cond, false, false_jumps);
+		parseStatement();
+		if (isWord("else")) {
+			pos++;
+			int end = emit(LoopProgram::OP_JUMP, 0, 0, -1);
+			patch(false_jumps, here());
+			parseStatement();
+			code[end].c = here();
+		} else {
+			patch(false_jumps, here());
+		}
+	} else if (t.text == "while") {
+		// the condition is placed after the body, so one iteration takes one jump
+		pos++;
+		if (!expect("(")) return;
+		int cond = parseExpression();
+		if (!expect(")")) return;
+		int to_cond = emit(LoopProgram::OP_JUMP, 0, 0, -1);
+		int body = here();
+		loops.push_back(LoopJumps());
+		parseStatement();
+		if (failed) return;
+		code[to_cond].c = here();
+		patch(loops.back().continues, here());
+		temp_num = 0;
+		std::vector<int> true_jumps;
+		emitCondition(cond, true, true_jumps);
+		patch(true_jumps, body);
+		patch(loops.back().breaks, here());
+		loops.pop_back();
+	} else if (t.text == "do") {
+		pos++;
+		int body = here();
+		loops.push_back(LoopJumps());
+		parseStatement();
+		if (failed) return;
+		if (!isWord("while")) {
+			fail("expected while near " + peek().text);
+			return;
+		}
+		pos++;
+		if (!expect("(")) return;
+		int cond = parseExpression();
+		if (!expect(")") || !expect(";")) return;
+		patch(loops.back().continues, here());
+		temp_num = 0;
+		std::vector<int> true_jumps;
+		emitCondition(cond, true, true_jumps);
+		patch(true_jumps, body);
+		patch(loops.back().breaks, here());
+		loops.pop_back();
+	} else if (t.text == "for") {
+		pos++;
+		if (!expect("(")) return;
+		scopes.push_back(std::map<std::string, int>());
+		if (!isOp(";")) {
+			if (isWord("int")) {
+				pos++;
+				int reg = (peek().kind == TOK_ID) ? declare(peek().text) : fail("expected a variable");
+				if (reg < 0) return;
+				pos++;
+				if (!expect("=")) return;
+				int value = parseExpression();
+				if (value < 0) return;
+				emitValue(value, reg);
+			} else {
+				parseSimple();
+			}
+		}
+		if (!expect(";")) return;
+		int cond = isOp(";") ? node(N_NUM, 0, 1, -1, -1) : parseExpression();
+		if (!expect(";")) return;
+		// the step is compiled after the body, skip it for now
+		size_t step = pos;
+		for (int depth = 0; !(isOp(")") && (depth == 0)); pos++) {
+			if (peek().kind == TOK_END) {
+				fail("expected )");
+				return;
+			}
+			if (isOp("(")) depth++;
+			if (isOp(")")) depth--;
+		}
+		pos++;
+		int to_cond = emit(LoopProgram::OP_JUMP, 0, 0, -1);
+		int body = here();
+		loops.push_back(LoopJumps());
+		parseStatement();
+		if (failed) return;
+		size_t after = pos;
+		patch(loops.back().continues, here());
+		pos = step;
+		temp_num = 0;
+		if (!isOp(")"))
+			parseSimple();
+		if (!expect(")")) return;
+		pos = after;
+		code[to_cond].c = here();
+		temp_num = 0;
+		std::vector<int> true_jumps;
+		emitCondition(cond, true, true_jumps);
+		patch(true_jumps, body);
+		patch(loops.back().breaks, here());
+		loops.pop_back();
+		scopes.pop_back();
+	} else if ((t.text == "break") || (t.text == "continue")) {
+		bool is_break = (t.text == "break");
+		pos++;
+		if (!expect(";")) return;
+		if (loops.empty()) {
+			fail((is_break ? "break" : "continue") + std::string(" out of a loop"));
+			return;
+		}
+		int jump = emit(LoopProgram::OP_JUMP, 0, 0, -1);
+		(is_break ? loops.back().breaks : loops.back().continues).push_back(jump);
+	} else if (t.text == "return") {
+		pos++;
+		if (!isOp(";") && (parseExpression() < 0)) return;
+		if (!expect(";")) return;
+		emit(LoopProgram::OP_END, 0, 0, 0);
+	} else if (t.text == "int") {
+		pos++;
+		do {
+			if (peek().kind != TOK_ID) {
+				fail("expected a variable near " + peek().text);
+				return;
+			}
+			int reg = declare(peek().text);
+			if (reg < 0) return;
+			pos++;
+			if (accept("=")) {
+				int value = parseExpression();
+				if (value < 0) return;
+				emitValue(value, reg);
+			}
+			temp_num = 0;
+		} while (accept(","));
+		expect(";");
+	} else if ((t.text == "iif_assume") || (t.text == "iif_assert")) {
+		int op = (t.text == "iif_assume") ? LoopProgram::OP_ASSUME : LoopProgram::OP_ASSERT;
+		pos++;
+		if (!expect("(")) return;
+		int cond = parseExpression();
+		if (!expect(")") || !expect(";")) return;
+		emit(op, emitValue(cond, -1), 0, 0);
+	} else if (t.text == "iif_record") {
+		pos++;
+		if (expect("(") && expect(")") && expect(";"))
+			emit(LoopProgram::OP_RECORD, 0, 0, 0);
+	} else {
+		parseSimple();
+		expect(";");
+	}
+}
+
+bool LoopCompiler::compile(const std::string& source) {
+	if (!tokenize(source, tokens, program.message))
+		return false;
+	// the names are the parameters of the loop function, in the order of the cfg
+	scopes.push_back(std::map<std::string, int>());
+	for (int i = 0; i < Nv; i++)
+		scopes[0][program.names[i]] = i;
+	while (!failed && (peek().kind != TOK_END))
+		parseStatement();
+	if (failed)
+		return false;
+	emit(LoopProgram::OP_END, 0, 0, 0);
+
+	// registers: variables, constants, temporaries
+	program.constant_base = local_num;
+	int temp_base = local_num + static_cast<int>(program.constants.size());
+	program.register_num = temp_base + temp_max;
+	if (program.register_num > LoopProgram::max_registers) {
+		fail("the loop needs more than " + std::to_string(LoopProgram::max_registers) + " registers");
+		return false;
+	}
+	program.code.resize(code.size());
+	for (size_t i = 0; i < code.size(); i++) {
+		int reg[3] = { code[i].a, code[i].b, code[i].c };
+		// c is a register only for the operators on two registers
+		int nreg = (((code[i].op >= LoopProgram::OP_ADD) && (code[i].op <= LoopProgram::OP_MOD))
+				|| isComparison(code[i].op)) ? 3 : 2;
+		for (int j = 0; j < nreg; j++) {
+			if (reg[j] & REG_CONSTANT)
+				reg[j] = program.constant_base + (reg[j] & REG_MASK);
+			else if (reg[j] & REG_TEMP)
+				reg[j] = temp_base + (reg[j] & REG_MASK);
+		}
+		program.code[i].op = static_cast<short>(code[i].op);
+		program.code[i].a = static_cast<short>(reg[0]);
+		program.code[i].b = static_cast<short>(reg[1]);
+		program.code[i].c = reg[2];
+	}
+	return true;
+}
+
+
+//**********************************************************************************************
+// LoopProgram
+//**********************************************************************************************
+
+LoopProgram::LoopProgram() : deterministic(false), constant_base(Nv), register_num(Nv) {
+}
+
+bool LoopProgram::parseFile(const char* cfgfilename) {
+	std::ifstream fin(cfgfilename);
+	if (!fin) {
+		message = std::string("can not open ") + cfgfilename;
+		return false;
+	}
+	std::ostringstream sout;
+	sout << fin.rdbuf();
+	return parse(sout.str());
+}
+
+bool LoopProgram::parse(const std::string& cfg) {
+	names.clear();
+	learners.clear();
+	key.clear();
+	code.clear();
+	constants.clear();
+	message.clear();
+
+	// a line starting with a key sets it, the other lines continue the last key
+	std::string values[KEY_NUM];
+	int last = -1;
+	std::istringstream sin(cfg);
+	std::string line;
+	while (getline(sin, line)) {
+		size_t eq = line.find('=');
+		int key = KEY_NUM;
+		if (eq != std::string::npos)
+			for (key = 0; key < KEY_NUM; key++)
+				if (line.compare(0, eq, cfg_keys[key]) == 0)
+					break;
+		if (key < KEY_NUM) {
+			values[key] += line.substr(eq + 1);
+			last = key;
+		} else if (last >= 0) {
+			values[last] += "\n" + line;
+		}
+	}
+
+	names = splitWords(values[KEY_NAMES]);
+	if (static_cast<int>(names.size()) != Nv) {
+		message = "the loop has " + std::to_string(names.size()) + " variables, the engine is built with Nv=" + std::to_string(Nv);
+		names.clear();
+		return false;
+	}
+	learners = splitWords(values[KEY_LEARNERS]);
+	// the sections up to afterloop define the executions, see loop_key.h
+	key = loopKey(values, KEY_AFTERLOOP + 1);
+	sampling = values[KEY_SAMPLING];
+	deterministic = (values[KEY_DETERMINISTIC].find("true") != std::string::npos);
+
+	// the body of the loop function generated by cfg2test
+	std::string symbolic = isBlank(values[KEY_SYMBOLIC]) ? "" : values[KEY_SYMBOLIC];
+	std::string source = values[KEY_BEFORELOOP] + "\n" + values[KEY_BEFORELOOPINIT] + "\n";
+	if (!symbolic.empty())
+		source += "int " + symbolic + " = rand()%2;\n";
+	source += "iif_assume(" + values[KEY_PRECONDITION] + ");\n";
+	if (isBlank(values[KEY_LOOPCONDITION]))
+		source += "while(rand() % 8)\n";
+	else
+		source += "while(" + values[KEY_LOOPCONDITION] + ")\n";
+	source += "{\niif_record();\n" + values[KEY_LOOP] + "\n";
+	if (!symbolic.empty())
+		source += symbolic + " = rand()%2;\n";
+	source += "}\niif_record();\niif_assert(" + values[KEY_POSTCONDITION] + ");\n";
+
+	LoopCompiler compiler(*this);
+	if (!compiler.compile(source)) {
+		code.clear();
+		constants.clear();
+		return false;
+	}
+	return true;
+}
+
+bool LoopProgram::writeVarFile(const char* varfilename) const {
+	std::ofstream fout(varfilename);
+	if (!fout) return false;
+	fout << names.size() << std::endl;
+	for (size_t i = 0; i < names.size(); i++)
+		fout << names[i] << std::endl;
+	return true;
+}
+
+void LoopProgram::setup(iif::iifContext& context) const {
+	if (learners.empty() || (learners[0].find("def") != std::string::npos)) {
+		context.addLearner("linear");
+		context.addLearner("poly");
+		context.addLearner("conjunctive");
+	} else {
+		for (size_t i = 0; i < learners.size(); i++) {
+			if (learners[i].find("lin") != std::string::npos)
+				context.addLearner("linear");
+			else if (learners[i].find("poly") != std::string::npos)
+				context.addLearner("poly");
+			else if (learners[i].find("conj") != std::string::npos)
+				context.addLearner("conjunctive");
+		}
+	}
+	if (deterministic)
+		context.setDeterministic(true);
+	context.setLoopKey(key.c_str());
+	// sampling=policy [k], e.g. sampling=reservoir 256
+	if (!isBlank(sampling)) {
+		std::istringstream sin(sampling);
+		std::string policy;
+		int k = 0;
+		sin >> policy >> k;
+		context.setTraceSampling(policy.c_str(), (k > 0) ? k : MstatesIn1trace);
+	}
+}
+
+/// record the state of the names into the current execution, as iif_record does
+static inline void recordState(ContextState* c, const int* r) {
+	if (c->state_index < c->record_fast_limit) {
+		double* dst = c->program_states[c->state_index++];
+		for (int i = 0; i < Nv; i++)
+			dst[i] = r[i];
+		return;
+	}
+	double state[Nv];
+	for (int i = 0; i < Nv; i++)
+		state[i] = r[i];
+	addState(state);
+}
+
+int LoopProgram::run(const int* input) const {
+	int r[max_registers];
+	for (int i = 0; i < Nv; i++)
+		r[i] = input[i];
+	// the variables declared by the loop start from 0
+	for (int i = Nv; i < constant_base; i++)
+		r[i] = 0;
+	for (size_t i = 0; i < constants.size(); i++)
+		r[constant_base + i] = constants[i];
+
+	ContextState* context = current_context;
+	const Instr* start = &code[0];
+	const Instr* pc = start;
+	for (;;) {
+		switch (pc->op) {
+			case OP_MOVE: r[pc->a] = r[pc->b]; break;
+			case OP_ADD: r[pc->a] = addInt(r[pc->b], r[pc->c]); break;
+			case OP_SUB: r[pc->a] = subInt(r[pc->b], r[pc->c]); break;
+			case OP_MUL: r[pc->a] = mulInt(r[pc->b], r[pc->c]); break;
+			case OP_DIV: r[pc->a] = divInt(r[pc->b], r[pc->c]); break;
+			case OP_MOD: r[pc->a] = modInt(r[pc->b], r[pc->c]); break;
+			case OP_ADDI: r[pc->a] = addInt(r[pc->b], pc->c); break;
+			case OP_NEG: r[pc->a] = negInt(r[pc->b]); break;
+			case OP_NOT: r[pc->a] = (r[pc->b] == 0); break;
+			case OP_LT: r[pc->a] = (r[pc->b] < r[pc->c]); break;
+			case OP_LE: r[pc->a] = (r[pc->b] <= r[pc->c]); break;
+			case OP_GT: r[pc->a] = (r[pc->b] > r[pc->c]); break;
+			case OP_GE: r[pc->a] = (r[pc->b] >= r[pc->c]); break;
+			case OP_EQ: r[pc->a] = (r[pc->b] == r[pc->c]); break;
+			case OP_NE: r[pc->a] = (r[pc->b] != r[pc->c]); break;
+			case OP_JUMP: pc = start + pc->c; continue;
+			case OP_JZ: if (r[pc->a] == 0) { pc = start + pc->c; continue; } break;
+			case OP_JNZ: if (r[pc->a] != 0) { pc = start + pc->c; continue; } break;
+			case OP_JLT: if (r[pc->a] < r[pc->b]) { pc = start + pc->c; continue; } break;
+			case OP_JLE: if (r[pc->a] <= r[pc->b]) { pc = start + pc->c; continue; } break;
+			case OP_JGT: if (r[pc->a] > r[pc->b]) { pc = start + pc->c; continue; } break;
+			case OP_JGE: if (r[pc->a] >= r[pc->b]) { pc = start + pc->c; continue; } break;
+			case OP_JEQ: if (r[pc->a] == r[pc->b]) { pc = start + pc->c; continue; } break;
+			case OP_JNE: if (r[pc->a] != r[pc->b]) { pc = start + pc->c; continue; } break;
+			case OP_RAND: r[pc->a] = rand(); break;
+			case OP_RECORD: recordState(context, r); break;
+			case OP_ASSUME:
+				context->passP = (r[pc->a] != 0);
+				context->assume_times++;
+				break;
+			case OP_ASSERT:
+				context->passQ = (r[pc->a] != 0);
+				context->assert_times++;
+				break;
+			case OP_END: return 0;
+		}
+		pc++;
+	}
+}
+
+std::string LoopProgram::disassemble() const {
+	static const char* op_names[] = { "move", "add", "sub", "mul", "div", "mod", "addi", "neg", "not",
+		"lt", "le", "gt", "ge", "eq", "ne", "jump", "jz", "jnz", "jlt", "jle", "jgt", "jge", "jeq", "jne",
+		"rand", "record", "assume", "assert", "end" };
+	std::ostringstream sout;
+	for (int i = 0; i < constant_base; i++)
+		sout << "r" << i << " = " << ((i < static_cast<int>(names.size())) ? names[i] : "local") << "\n";
+	for (size_t i = 0; i < constants.size(); i++)
+		sout << "r" << constant_base + i << " = " << constants[i] << "\n";
+	for (size_t i = 0; i < code.size(); i++) {
+		char line[64];
+		snprintf(line, sizeof(line), "%4d  %-7s %4d %4d %6d\n", static_cast<int>(i), op_names[code[i].op], code[i].a, code[i].b, code[i].c);
+		sout << line;
+	}
+	return sout.str();
+}
+
+/// a register read by the generated C, the constants are written inline
+static std::string cOperand(int reg, int constant_base, const std::vector<int>& constants) {
+	std::ostringstream sout;
+	if ((reg >= constant_base) && (reg < constant_base + static_cast<int>(constants.size()))) {
+		int value = constants[reg - constant_base];
+		if (value == INT_MIN)
+			sout << "(-2147483647 - 1)";
+		else
+			sout << "(" << value << ")";
+	} else {
+		sout << "r" << reg;
+	}
+	return sout.str();
+}
+
+std::string LoopProgram::toC(const std::string& function) const {
+	static const char* arithmetic[] = { NULL, "iif_add", "iif_sub", "iif_mul", "iif_div", "iif_mod" };
+	static const char* comparison[] = { "<", "<=", ">", ">=", "==", "!=" };
+	// only the targets of jumps get a label
+	std::vector<bool> target(code.size() + 1, false);
+	for (size_t i = 0; i < code.size(); i++)
+		if ((code[i].op >= OP_JUMP) && (code[i].op <= OP_JNE))
+			target[code[i].c] = true;
+
+	std::ostringstream sout;
+	sout << "/* the loop on";
+	for (size_t i = 0; i < names.size(); i++)
+		sout << " " << names[i];
+	sout << ", generated from its bytecode, see loop_jit.h */\n"
+		<< "int rand(void);\n"
+		<< "void (*iif_jit_record)(const int* state);\n"
+		<< "void (*iif_jit_assume)(int pass);\n"
+		<< "void (*iif_jit_assert)(int pass);\n"
+		<< "static inline int iif_add(int a, int b) { return (int)((unsigned)a + (unsigned)b); }\n"
+		<< "static inline int iif_sub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }\n"
+		<< "static inline int iif_mul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }\n"
+		<< "static inline int iif_neg(int a) { return (int)(0u - (unsigned)a); }\n"
+		<< "static inline int iif_div(int a, int b) { return (b == 0) ? 0 : (b == -1) ? iif_neg(a) : a / b; }\n"
+		<< "static inline int iif_mod(int a, int b) { return ((b == 0) || (b == -1)) ? 0 : a % b; }\n"
+		<< "int " << function << "(int* input) {\n";
+	for (int i = 0; i < constant_base; i++) {
+		if (i < Nv)
+			sout << "\tint r" << i << " = input[" << i << "];\n";
+		else
+			sout << "\tint r" << i << " = 0;\n";
+	}
+	for (int i = constant_base + static_cast<int>(constants.size()); i < register_num; i++)
+		sout << "\tint r" << i << " = 0;\n";
+	sout << "\tint state[" << Nv << "];\n";
+
+	for (size_t i = 0; i < code.size(); i++) {
+		const Instr& in = code[i];
+		std::string a = "r" + std::to_string(static_cast<long long>(in.a));
+		std::string b = cOperand(in.b, constant_base, constants);
+		std::string c = cOperand(in.c, constant_base, constants);
+		if (target[i])
+			sout << "L" << i << ":\n";
+		sout << "\t";
+		switch (in.op) {
+			case OP_MOVE: sout << a << " = " << b << ";"; break;
+			case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+				sout << a << " = " << arithmetic[in.op] << "(" << b << ", " << c << ");";
+				break;
+			case OP_ADDI: sout << a << " = iif_add(" << b << ", " << in.c << ");"; break;
+			case OP_NEG: sout << a << " = iif_neg(" << b << ");"; break;
+			case OP_NOT: sout << a << " = (" << b << " == 0);"; break;
+			case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE:
+				sout << a << " = (" << b << " " << comparison[in.op - OP_LT] << " " << c << ");";
+				break;
+			case OP_JUMP: sout << "goto L" << in.c << ";"; break;
+			case OP_JZ: sout << "if (" << cOperand(in.a, constant_base, constants) << " == 0) goto L" << in.c << ";"; break;
+			case OP_JNZ: sout << "if (" << cOperand(in.a, constant_base, constants) << " != 0) goto L" << in.c << ";"; break;
+			case OP_JLT: case OP_JLE: case OP_JGT: case OP_JGE: case OP_JEQ: case OP_JNE:
+				sout << "if (" << cOperand(in.a, constant_base, constants) << " " << comparison[in.op - OP_JLT] << " "
+					<< b << ") goto L" << in.c << ";";
+				break;
+			case OP_RAND: sout << a << " = rand();"; break;
+			case OP_RECORD:
+				for (int j = 0; j < Nv; j++)
+					sout << "state[" << j << "] = r" << j << "; ";
+				sout << "iif_jit_record(state);";
+				break;
+			case OP_ASSUME: sout << "iif_jit_assume(" << cOperand(in.a, constant_base, constants) << " != 0);"; break;
+			case OP_ASSERT: sout << "iif_jit_assert(" << cOperand(in.a, constant_base, constants) << " != 0);"; break;
+			case OP_END: sout << "return 0;"; break;
+		}
+		sout << "\n";
+	}
+	// the bytecode always ends by OP_END, a jump may still target the end
+	if (target[code.size()])
+		sout << "L" << code.size() << ":\n\treturn 0;\n";
+	sout << "}\n";
+	return sout.str();
+}
+
+int runLoopProgram(int* input) {
+	return current_context->loop_program->run(input);
+}
@@ -0,0 +1,64 @@
+/** @file memtrack.cpp
+ *  @brief Implementation of the memory tracker.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "memtrack.h"
+#include <vector>
+#include <mutex>
+#include <climits>
+#include <iomanip>
+#include <sstream>
+
+const char* MemoryTracker::names[MEM_NUM] = { "states", "mapped", "trainset", "svm_cache",
+	"classifier", "sampler" };
+std::atomic<long long> MemoryTracker::current[MEM_NUM];
+std::atomic<long long> MemoryTracker::peak[MEM_NUM];
+std::atomic<long long> MemoryTracker::total(0);
+std::atomic<long long> MemoryTracker::total_peak(0);
+std::atomic<long long> MemoryTracker::budget(0);
+
+// function local, so that compactors can be registered by static initializers of other files
+static std::vector<long long (*)(long long)>& compactors() {
+	static std::vector<long long (*)(long long)> list;
+	return list;
+}
+static std::mutex compactors_mutex;
+
+long long MemoryTracker::available() {
+	if (budget <= 0)
+		return LLONG_MAX / 2;
+	return budget - total;
+}
+
+bool MemoryTracker::reserve(long long bytes) {
+	if (bytes <= available())
+		return true;
+	std::lock_guard<std::mutex> lock(compactors_mutex);
+	std::vector<long long (*)(long long)>& list = compactors();
+	for (size_t i = 0; i < list.size(); i++) {
+		list[i](bytes - available());
+		if (bytes <= available())
+			return true;
+	}
+	return false;
+}
+
+bool MemoryTracker::addCompactor(long long (*compactor)(long long needed)) {
+	std::lock_guard<std::mutex> lock(compactors_mutex);
+	compactors().push_back(compactor);
+	return true;
+}
+
+std::string MemoryTracker::summary() {
+	std::ostringstream out;
+	out << std::fixed << std::setprecision(1) << "memory peak " << total_peak / 1048576.0 << "MB";
+	if (budget > 0)
+		out << " of budget " << budget / 1048576.0 << "MB";
+	out << " {";
+	for (int i = 0; i < MEM_NUM; i++)
+		out << " " << names[i] << "=" << peak[i] / 1048576.0;
+	out << " }";
+	return out.str();
+}
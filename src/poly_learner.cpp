@@ -24,121 +24,128 @@ PolyLearner::~PolyLearner() {
 
 int PolyLearner::learn()
 {
-	std::cout << YELLOW << ">>>> Polynomial Learner-----------------------\n" << NORMAL;  
-	int rnd;
+	IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << ">>>> Polynomial Learner-----------------------\n" << NORMAL;  
 	//bool similarLast = false;
 	bool converged = false;
-	int converged_time = 0;
-	Classifier pre_cl;
-	int pre_psize = 0, pre_nsize = 0;
+	// the rounds go on from a checkpoint if they are restored
+	resumeRounds();
 
 	double pass_rate = 1;
 	svm->setKernel(1);
 
-	for (rnd = 1; ((rnd <= max_iteration) /*&& (pass_rate >= 1)*/); rnd++) {
+	for (; ((rnd <= max_iteration) /*&& (pass_rate >= 1)*/); rnd++) {
+		if (cancelled()) {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Cancelled, another learner has succeeded.\n" << NORMAL;
+			return -1;
+		}
+		if (outOfTime()) {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Out of time, see TimeBudget.\n" << NORMAL;
+			return -1;
+		}
+		beginRound();
+		Profiler::round("poly", rnd);
 		int zero_times = 0;
 
 		int nexe = (rnd == 1) ? Nexe_init : Nexe_after;
-#ifdef __PRT
+		int randn = Nexe_rand;
+		if (!budgetSamples(randn, nexe)) {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Out of time, see TimeBudget.\n" << NORMAL;
+			return -1;
+		}
 		int step = 1;
-		std::cout << RED << "[" << rnd << "]" << NORMAL;
-		std::cout << RED << "Polynomail SVM------------------------{" << svm->etimes 
-			<< "}------------------------------------------------------------------------------------\n\t(" 
-			<< YELLOW << step++ << NORMAL << ") execute programs... [" << nexe + Nexe_rand << "] ";
-#else
-		std::cout << RED << "[" << rnd;
-#endif
+		if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "[" << rnd << "]" << NORMAL;
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "Polynomail SVM------------------------{" << svm->etimes 
+				<< "}------------------------------------------------------------------------------------\n\t(" 
+				<< YELLOW << step++ << NORMAL << ") execute programs... [" << nexe + randn << "] ";
+		} else {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "[" << rnd;
+		}
 
 init_svm:
 		//std::cout << std::endl << "\t-->selective sampling:\n\t";
-		selectiveSampling(Nexe_rand, nexe, &pre_cl);
+		selectiveSampling(randn, nexe, &pre_cl);
 		//std::cout << "\t<--selective sampling:\n";
+		if (counterExample())
+			return -2;
 
 		if ((rnd == 1) && (gsets[POSITIVE].traces_num() == 0 || gsets[NEGATIVE].traces_num() == 0)) {
-#ifdef __PRT
-			if (gsets[POSITIVE].traces_num() == 0) 
-				std::cout << RED << "\tZero Positive trace, execute program again.\n" << NORMAL;
-			if (gsets[NEGATIVE].traces_num() == 0) 
-				std::cout << RED << "\tZero Negative trace, execute program again.\n" << NORMAL;
-#else
-			std::cout << "+";
-#endif
+			if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+				if (gsets[POSITIVE].traces_num() == 0) 
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "\tZero Positive trace, execute program again.\n" << NORMAL;
+				if (gsets[NEGATIVE].traces_num() == 0) 
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << "\tZero Negative trace, execute program again.\n" << NORMAL;
+			} else {
+				IIF_LOG(LOG_LEARN, LOG_INFO) << "+";
+			}
 
+			if (outOfTime()) {
+				IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Out of time, see TimeBudget.\n" << NORMAL;
+				return -1;
+			}
 			if (++zero_times >= Nretry_init) {
 				if (gsets[POSITIVE].traces_num() == 0) 
-					std::cout << RED << "Can not get any positive trace. " << std::endl;
+					IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "Can not get any positive trace. " << std::endl;
 				else
-					std::cout << RED << "Can not get any negative trace. " << std::endl;
-				std::cout << " re-Run the system again OR modify your loop program.\n" << NORMAL;
-				exit(-1);
+					IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "Can not get any negative trace. " << std::endl;
+				IIF_LOG(LOG_LEARN, LOG_INFO) << " re-Run the system again OR modify your loop program.\n" << NORMAL;
+				return -1;
 			}
-			if (maxv <= 100000) {maxv+=base_step;}
-			if (minv >= -100000) {minv-=base_step;}
+			if (context->maxv <= 100000) {context->maxv+=base_step;}
+			if (context->minv >= -100000) {context->minv-=base_step;}
 			goto init_svm;
 		}
 
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") prepare training data... ";
-#else
-		std::cout << "]" << NORMAL;
-#endif
+		if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+			IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") prepare training data... ";
+		} else {
+			IIF_LOG(LOG_LEARN, LOG_INFO) << "]" << NORMAL;
+		}
 
-#ifdef __PRT_STATISTICS
-		std::cout << "[#r" << random_samples << ",#s" << selective_samples << "]\n    ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "[#r" << context->random_samples << ",#s" << context->selective_samples << "]\n    ";
 		if (svm->makeTrainingSet(gsets, pre_psize, pre_nsize) == 0) {
 			if (++zero_times < Nretry_init)
 				goto init_svm;
 		}
-		while (gsets[POSITIVE].getSize() + gsets[NEGATIVE].getSize() >= density * pow(maxv-minv, Nv)) {
-			if (maxv <= 100000) {maxv+=base_step;}
-			if (minv >= -100000) {minv-=base_step;}
+		while (gsets[POSITIVE].getSize() + gsets[NEGATIVE].getSize() >= density * pow(context->maxv-context->minv, Nv)) {
+			if (context->maxv <= 100000) {context->maxv+=base_step;}
+			if (context->minv >= -100000) {context->minv-=base_step;}
 		}
 
-#ifdef __PRT
-		std::cout << "\n\t(" << YELLOW << step++ << NORMAL << ") start training ...";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\n\t(" << YELLOW << step++ << NORMAL << ") start training ...";
 #ifdef __DS_ENABLED
-		std::cout << "[" << svm->problem.np << "+:" << svm->problem.nn << "-]";
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "[" << svm->problem.np << "+:" << svm->problem.nn << "-]";
 #endif
 
 		if (svm->train() != 0) {
 			//#ifdef __PRT
-			std::cout << RED  << " [FAIL] \n Can not divided by polynomial SVM " << NORMAL << std::endl;
+			IIF_LOG(LOG_LEARN, LOG_INFO) << RED  << " [FAIL] \n Can not divided by polynomial SVM " << NORMAL << std::endl;
 			//#endif
 			return -1;
 		}
-		std::cout << "|-->> " << YELLOW << svm->cl << NORMAL << std::endl;
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") checking training traces.";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "|-->> " << YELLOW << svm->cl << NORMAL << std::endl;
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") checking training traces.";
 		pass_rate = svm->checkTrainingSet();
 
-#ifdef __PRT
-		if (pass_rate == 1) 
-			std::cout << GREEN << " [" << pass_rate * 100 << "%]" << NORMAL;
-		else 
-			std::cout << RED << " [" << pass_rate * 100 << "%]" << NORMAL;
-#endif
+		if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+			if (pass_rate == 1) 
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << GREEN << " [" << pass_rate * 100 << "%]" << NORMAL;
+			else 
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << RED << " [" << pass_rate * 100 << "%]" << NORMAL;
+		}
 
 		if (pass_rate < 1) {
-			std::cerr << RED << "[FAIL] ..... Can not divided by polynomial SVM." << std::endl << NORMAL;
+			IIF_LOG(LOG_LEARN, LOG_ERROR) << RED << "[FAIL] ..... Can not divided by polynomial SVM." << std::endl << NORMAL;
 			rnd++;
 			break;	
 		}
-#ifdef __PRT
-		std::cout << GREEN << " [PASS]" << std::endl << NORMAL;
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << GREEN << " [PASS]" << std::endl << NORMAL;
 
 #ifdef __QUESTION_TRACE_CHECK_ENABLED
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") check Question Traces:   ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") check Question Traces:   ";
 		if (svm->checkQuestionTraces(gsets[QUESTION]) != 0)
 			continue;
-#ifdef __PRT
-		std::cout << "\n";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\n";
 #endif
 
 		/*
@@ -147,25 +154,21 @@ init_svm:
 		 *	This is to prevent in some round the points are too right to adjust the classifier.
 		 */
 		//svm->cl.roundoff();
-#ifdef __PRT
-		std::cout << "\t(" << YELLOW << step++ << NORMAL << ") check convergence:        ";
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "\t(" << YELLOW << step++ << NORMAL << ") check convergence:        ";
 
 		if (svm->converged(pre_cl) == true) {
 			converged_time++;
-#ifdef __PRT
-			std::cout << "[";
-			for (int j = 0; j < converged_std - converged_time; j++)
-				std::cout << "F";
-			for (int j = 0; j < converged_time; j++)
-				std::cout << "T";
-			std::cout << "]  ";
-#endif
+			if (Logger::enabled(LOG_LEARN, LOG_DEBUG)) {
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "[";
+				for (int j = 0; j < converged_std - converged_time; j++)
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << "F";
+				for (int j = 0; j < converged_time; j++)
+					IIF_LOG(LOG_LEARN, LOG_DEBUG) << "T";
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "]  ";
+			}
 
 			if (converged_time >= converged_std) {
-#ifdef __PRT
-				std::cout << "[SUCCESS] rounding off" << std::endl;
-#endif
+				IIF_LOG(LOG_LEARN, LOG_DEBUG) << "[SUCCESS] rounding off" << std::endl;
 				converged = true;
 				rnd++;
 				break;
@@ -173,15 +176,14 @@ init_svm:
 		} else {
 			converged_time = 0;
 		}
-#ifdef __PRT
-		std::cout << "[FAIL] neXt round " << std::endl;
-#endif
+		IIF_LOG(LOG_LEARN, LOG_DEBUG) << "[FAIL] neXt round " << std::endl;
 
+		offerCandidate(svm->cl);
 		pre_cl = svm->cl;
 		svm->cl.clear();
 	} // end of SVM training procedure
 
-	std::cout << "--------------------------------------------------\n";
+	IIF_LOG(LOG_LEARN, LOG_INFO) << "--------------------------------------------------\n";
 
 	int ret = 0;
 	if ((converged) && (rnd <= max_iteration)) {
@@ -189,13 +191,13 @@ init_svm:
 		svm->cl.clear();
 		svm->cl.factor(*poly);
 		svm->cl.roundoff();
-		std::cout << YELLOW << "  Invariant Candidate(Polynomial): {  ";
-		std::cout << GREEN << svm->cl.toString() << YELLOW;
-		std::cout << "  }" << NORMAL << std::endl;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << YELLOW << "  Invariant Candidate(Polynomial): {  ";
+		IIF_LOG(LOG_LEARN, LOG_INFO) << GREEN << svm->cl.toString() << YELLOW;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << "  }" << NORMAL << std::endl;
 	}
 
 	if ((pass_rate < 1) || (rnd >= max_iteration)) {
-		std::cout << RED << "  Cannot divide by polynomial SVM perfectly.\n" << NORMAL;
+		IIF_LOG(LOG_LEARN, LOG_INFO) << RED << "  Cannot divide by polynomial SVM perfectly.\n" << NORMAL;
 		ret = -1;
 	}
 
@@ -206,11 +208,25 @@ std::string PolyLearner::invariant(int n) {
 	return svm->cl.toString();
 }
 
+std::string PolyLearner::canonicalInvariant(int n) {
+	return svm->cl.canonical();
+}
+
+void PolyLearner::saveRounds(std::ostream& out) {
+	BaseLearner::saveRounds(out);
+	svm->saveTrainingSet(out);
+}
+
+bool PolyLearner::loadRounds(std::istream& in) {
+	restored = BaseLearner::loadRounds(in) && svm->loadTrainingSet(in, gsets);
+	return restored;
+}
+
 int PolyLearner::save2file(const char* dsfilename) {
 	printStatistics();
 	//svm->problem.save_to_file("../tmp/svm.ds");
 	//std::cout << "save to file succeed. ../tmp/svm.ds\n";
 	svm->problem.save_to_file(dsfilename);
-	std::cout << "save the training dataset to file " << dsfilename << "\n";
+	IIF_LOG(LOG_LEARN, LOG_INFO) << "save the training dataset to file " << dsfilename << "\n";
 	return 0;
 }
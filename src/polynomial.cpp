@@ -48,7 +48,7 @@ std::string Polynomial::toString() const {
 		if (theta[j] != 1) 
 			stm << "(" << theta[j] << ")*";
 		//stm << vparray[j];
-		stm << variables[j];
+		stm << current_context->variables[j];
 	}
 	stm << " >= 0";
 
@@ -76,7 +76,7 @@ std::string Polynomial::toString() const {
 		}
 		if (std::abs(theta[j]) != 1)
 			stm << std::abs(theta[j]) << "*";
-		stm << variables[j];
+		stm << current_context->variables[j];
 	}
 	stm << " >= 0";
 
@@ -84,6 +84,41 @@ std::string Polynomial::toString() const {
 }
 #endif
 
+static long long gcd(long long a, long long b) {
+	while (b != 0) {
+		long long r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+std::string Polynomial::canonical() const {
+	// a positive scaling keeps the half space, so the integer coefficients are reduced by their gcd
+	long long g = 0;
+	for (int i = 0; i < dims; i++) {
+		if ((theta[i] != nearbyint(theta[i])) || (std::abs(theta[i]) >= 9e15)) {
+			g = 0;
+			break;
+		}
+		g = gcd(g, std::abs(static_cast<long long>(theta[i])));
+	}
+	int last = dims - 1;
+	while ((last > 0) && (theta[last] == 0))
+		last--;
+	std::ostringstream stm;
+	stm << std::setprecision(16);
+	for (int i = 0; i <= last; i++) {
+		if (i > 0)
+			stm << " ";
+		if (g > 1)
+			stm << static_cast<long long>(theta[i]) / g;
+		else
+			stm << theta[i] + 0.0;	// +0.0 turns -0.0 into 0
+	}
+	return stm.str();
+}
+
 std::ostream& operator<< (std::ostream& out, const Polynomial& poly) {
 	out << std::setprecision(16);
 	out << poly.toString();
@@ -484,7 +519,7 @@ z3::expr Polynomial::toZ3expr(char** name, z3::context& c) const {
 	for (int i = 1; i < dims; i++) {
 		z3::expr tmp = theta[i];
 		for (int j = 0; j < Nv; j++) {
-			int power = vparray[i][j];
+			int power = monomial::exponent(i, j);
 			while (power-- > 0) {
 				tmp = tmp * x[j];
 			}
@@ -510,10 +545,8 @@ z3::expr Polynomial::toZ3expr(char** name, z3::context& c) const {
 
 bool Polynomial::uniImply(const Polynomial& e2) {
 #if (linux || __MACH__)
-#ifdef __PRT_QUERY
-	std::cout << BLUE << "-------------uni-Imply solving-------------\n" << NORMAL;
-	std::cout << RED << *this << " ==> " << e2 << std::endl << NORMAL;
-#endif
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << BLUE << "-------------uni-Imply solving-------------\n" << NORMAL;
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << RED << *this << " ==> " << e2 << std::endl << NORMAL;
 
 	z3::config cfg;
 	cfg.set("auto_config", true);
@@ -523,33 +556,27 @@ bool Polynomial::uniImply(const Polynomial& e2) {
 	z3::expr conc = e2.toZ3expr(NULL, c);
 
 	z3::expr query = implies(hypo, conc);
-#ifdef __PRT_QUERY
-	std::cout << "\nhypo: " << hypo << std::endl;
-	std::cout << "conc: " << conc << std::endl;
-	std::cout << BLUE << "Query : " << query << std::endl << NORMAL;
-#endif
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "\nhypo: " << hypo << std::endl;
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "conc: " << conc << std::endl;
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << BLUE << "Query : " << query << std::endl << NORMAL;
 
+	PROFILE_SCOPE(PHASE_Z3);
+	PROFILE_COUNT(COUNT_Z3_QUERIES, 1);
 	z3::solver s(c);
 	s.add(!query);
 	z3::check_result ret = s.check();
 	if (ret == unsat) {
-#ifdef __PRT_QUERY
-		std::cout << "Answer: UNSAT\n";
-#endif
+		IIF_LOG(LOG_QUERY, LOG_DEBUG) << "Answer: UNSAT\n";
 		return true;
 	}
-#ifdef __PRT_QUERY
-	std::cout << "Answer: SAT\n";
-#endif
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "Answer: SAT\n";
 #endif
 	return false;
 }
 
 bool Polynomial::multiImply(const Polynomial* e1, int e1_num, const Polynomial& e2) {
 #if (linux || __MACH__)
-#ifdef __PRT_QUERY
-	std::cout << "-------------Multi-Imply solving-------------\n";
-#endif
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "-------------Multi-Imply solving-------------\n";
 	z3::config cfg;
 	cfg.set("auto_config", true);
 	z3::context c(cfg);
@@ -565,25 +592,21 @@ bool Polynomial::multiImply(const Polynomial* e1, int e1_num, const Polynomial&
 	//std::cout << "conc: " << conc << std::endl;
 
 	z3::expr query = implies(hypo, conc);
-#ifdef __PRT_QUERY
-	std::cout << "Query : " << query << std::endl;
-	std::cout << "Answer: ";
-#endif
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "Query : " << query << std::endl;
+	IIF_LOG(LOG_QUERY, LOG_DEBUG) << "Answer: ";
 
+	PROFILE_SCOPE(PHASE_Z3);
+	PROFILE_COUNT(COUNT_Z3_QUERIES, 1);
 	z3::solver s(c);
 	s.add(!query);
 	z3::check_result ret = s.check();
 
 	if (ret == unsat) {
-#ifdef __PRT_QUERY
-		std::cout << "True" << std::endl;
-#endif
+		IIF_LOG(LOG_QUERY, LOG_DEBUG) << "True" << std::endl;
 		return true;
 	}
 	else {
-#ifdef __PRT_QUERY
-		std::cout << "False" << std::endl;
-#endif
+		IIF_LOG(LOG_QUERY, LOG_DEBUG) << "False" << std::endl;
 		return false;
 	}
 #endif
@@ -629,10 +652,8 @@ int Polynomial::roundoff(Polynomial& e) {
 	}
 
 
-#ifdef __PRT_POLYNOMIAL
-	std::cout << GREEN << "Before roundoff: " << *this;
-	std::cout << " min=" << min << std::endl;
-#endif
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << GREEN << "Before roundoff: " << *this;
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << " min=" << min << std::endl;
 
 	e = *this;
 	double scale_up = 2;
@@ -654,9 +675,7 @@ int Polynomial::roundoff(Polynomial& e) {
 			_roundoff(theta[i] / min, e.theta[i]);
 		}
 	}
-#ifdef __PRT_POLYNOMIAL
-	std::cout << "\tAfter roundoff: " << e << NORMAL << std::endl;
-#endif
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << "\tAfter roundoff: " << e << NORMAL << std::endl;
 	//std::cout << e << std::endl;
 	return 0;
 }
@@ -688,10 +707,8 @@ int Polynomial::roundoff(Polynomial& e) {
 		//if ((std::abs(theta0) < min) && (std::abs(theta0) > 1.0E-4))	
 		min = std::abs(theta[0]);
 
-#ifdef __PRT_POLYNOMIAL
-	std::cout << GREEN << "Before roundoff: " << *this;
-	std::cout << " min=" << min << std::endl;
-#endif
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << GREEN << "Before roundoff: " << *this;
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << " min=" << min << std::endl;
 
 	e = *this;
 	double scale_up = 2;
@@ -713,9 +730,7 @@ int Polynomial::roundoff(Polynomial& e) {
 			_roundoff(theta[i] / min, e.theta[i]);
 		}
 	}
-#ifdef __PRT_POLYNOMIAL
-	std::cout << "\tAfter roundoff: " << e << NORMAL << std::endl;
-#endif
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << "\tAfter roundoff: " << e << NORMAL << std::endl;
 	//std::cout << e << std::endl;
 	return 0;
 }
@@ -740,9 +755,7 @@ int Polynomial::toCandidates(Candidates* cs) {
 	if (second_min == DBL_MAX) second_min = 1;
 	if (second_min == 0) second_min = 1;
 
-#ifdef __PRT_POLYNOMIAL
-	std::cout << GREEN << "Before roundoff: " << *this;
-#endif
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << GREEN << "Before roundoff: " << *this;
 	if (min / second_min <= UPBOUND)
 		min = second_min;
 
@@ -754,27 +767,25 @@ int Polynomial::toCandidates(Candidates* cs) {
 		e.theta[i] = _roundoff(theta[i] / min);
 	//e.theta[0] = ceil(theta[0] / min);
 	e.theta[0] = _roundoff(theta[0] / min);
-#ifdef __PRT_POLYNOMIAL
-	std::cout << "\tAfter roundoff: " << e << GREEN << "[" << min_bound << "," << max_bound << "]\n" << NORMAL;
-#endif
-	std::cout << "--->: " << e << GREEN << "[" << min_bound << "," << max_bound << "]\n" << NORMAL;
+	IIF_LOG(LOG_POLY, LOG_DEBUG) << "\tAfter roundoff: " << e << GREEN << "[" << min_bound << "," << max_bound << "]\n" << NORMAL;
+	IIF_LOG(LOG_POLY, LOG_INFO) << "--->: " << e << GREEN << "[" << min_bound << "," << max_bound << "]\n" << NORMAL;
 #ifdef _multi_candidates_
 	double center = e.theta[0];
 	for (int up = center, down = center - 1; (up <= max_bound) || (down >= min_bound); up++, down--) {
 		if (up <= max_bound) {
 			e.theta[0] = up;
-			std::cout << "-->factoring up" << up << " ";
+			IIF_LOG(LOG_POLY, LOG_INFO) << "-->factoring up" << up << " ";
 			if (e.factor() == true) {
-				std::cout << "<---Done." << e << std::endl;
+				IIF_LOG(LOG_POLY, LOG_INFO) << "<---Done." << e << std::endl;
 				cs->add(&e);
 				//return 0;
 			}
 		}
 		if (down >= min_bound) {
 			e.theta[0] = down;
-			std::cout << "-->factoring down" << down << " ";
+			IIF_LOG(LOG_POLY, LOG_INFO) << "-->factoring down" << down << " ";
 			if (e.factor() == true) {
-				std::cout << "<---Done." << e << std::endl;
+				IIF_LOG(LOG_POLY, LOG_INFO) << "<---Done." << e << std::endl;
 				cs->add(&e);
 				//return 0;
 			}
@@ -784,7 +795,7 @@ int Polynomial::toCandidates(Candidates* cs) {
 #else
 	cs->add(&e);
 #endif
-	std::cout << YELLOW << "Candidates size = " << cs->getSize() << std::endl;
+	IIF_LOG(LOG_POLY, LOG_INFO) << YELLOW << "Candidates size = " << cs->getSize() << std::endl;
 	return cs->getSize();
 }
 #endif
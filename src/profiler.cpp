@@ -0,0 +1,238 @@
+/** @file profiler.cpp
+ *  @brief Implementation of the phase profiler.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "profiler.h"
+#include "memtrack.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <atomic>
+#include <unistd.h>
+#if (__linux__ || __MACH__)
+#include <sys/resource.h>
+#endif
+
+const char* Profiler::phase_names[PHASE_NUM] = { "sampling", "add_states", "mapping", "svm_train",
+	"check", "simplify", "z3" };
+static const char* counter_names[COUNT_NUM] = { "smo_iterations", "traces", "z3_queries" };
+
+std::atomic<int> Profiler::opened(0);
+std::mutex Profiler::open_mutex;
+std::atomic<bool> Profiler::trace_calls(false);
+std::ofstream Profiler::fout;
+std::ofstream Profiler::tout;
+std::mutex Profiler::tout_mutex;
+std::mutex Profiler::fout_mutex;
+long long Profiler::epoch_offset_us = 0;
+std::chrono::steady_clock::time_point Profiler::start;
+long long Profiler::total_ns[PHASE_NUM], Profiler::total_calls[PHASE_NUM], Profiler::total_counts[COUNT_NUM];
+thread_local std::chrono::steady_clock::time_point Profiler::learner_start, Profiler::round_start;
+thread_local std::string Profiler::learner;
+thread_local int Profiler::rnd = 0;
+thread_local long long Profiler::round_ns[PHASE_NUM], Profiler::round_calls[PHASE_NUM],
+	Profiler::round_counts[COUNT_NUM];
+
+static std::atomic<int> thread_count(0);
+static thread_local int thread_id = 0;
+
+bool Profiler::open(const char* prefix) {
+#ifdef __PROFILE_ENABLED
+	if (prefix == NULL) return false;
+	std::lock_guard<std::mutex> open_lock(open_mutex);
+	for (int i = 0; i < PHASE_NUM; i++)
+		round_ns[i] = round_calls[i] = 0;
+	for (int i = 0; i < COUNT_NUM; i++)
+		round_counts[i] = 0;
+	learner.clear();
+	rnd = 0;
+	// the contexts learning at the same time share the files of the first one
+	if (opened > 0) {
+		opened++;
+		return true;
+	}
+	std::string filename = std::string(prefix) + ".prof.csv";
+	fout.open(filename.c_str(), std::ofstream::app);
+	if (!fout) return false;
+	fout.precision(15);
+	// a new file gets the header line
+	if (fout.tellp() == 0)
+		fout << "pid,stage,round,metric,value\n";
+
+	filename = std::string(prefix) + ".trace.json";
+	tout.open(filename.c_str(), std::ofstream::app);
+	if (tout.tellp() == 0)
+		tout << "[\n";
+	std::string name = prefix;
+	if (name.find_last_of('/') != std::string::npos)
+		name = name.substr(name.find_last_of('/') + 1);
+	tout << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << getpid()
+		<< ",\"tid\":0,\"args\":{\"name\":\"learn " << name << "\"}},\n";
+	epoch_offset_us = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count()
+		- std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+	for (int i = 0; i < PHASE_NUM; i++)
+		total_ns[i] = total_calls[i] = 0;
+	for (int i = 0; i < COUNT_NUM; i++)
+		total_counts[i] = 0;
+	const char* calls = getenv("IIF_TRACE_CALLS");
+	trace_calls = (calls != NULL) && (atoi(calls) != 0);
+	start = std::chrono::steady_clock::now();
+	opened = 1;
+	static bool registered = false;
+	if (!registered)
+		atexit(closeAtExit);
+	registered = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Profiler::round(const char* name, int r) {
+	if (!opened) return;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	flushRound(now);
+	if (learner != name) {
+		if (!learner.empty())
+			span(learner.c_str(), "learner", learner_start, now);
+		learner_start = now;
+	}
+	learner = name;
+	rnd = r;
+	round_start = now;
+}
+
+void Profiler::endLearner() {
+	if (!opened) return;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	flushRound(now);
+	if (!learner.empty())
+		span(learner.c_str(), "learner", learner_start, now);
+	learner.clear();
+}
+
+void Profiler::close() {
+	std::lock_guard<std::mutex> open_lock(open_mutex);
+	if (opened == 0) return;
+	endLearner();
+	if (--opened > 0) return;
+	std::lock_guard<std::mutex> lock(fout_mutex);
+	for (int i = 0; i < PHASE_NUM; i++) {
+		write("total", 0, (std::string(phase_names[i]) + "_ms").c_str(), total_ns[i] / 1e6);
+		write("total", 0, (std::string(phase_names[i]) + "_calls").c_str(), total_calls[i]);
+	}
+	for (int i = 0; i < COUNT_NUM; i++)
+		write("total", 0, counter_names[i], total_counts[i]);
+	write("total", 0, "wall_ms", std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start).count() / 1e3);
+	write("total", 0, "peak_rss_kb", peakRSS());
+	for (int i = 0; i < MEM_NUM; i++)
+		write("total", 0, (std::string("mem_") + MemoryTracker::getName(i) + "_peak_kb").c_str(),
+				MemoryTracker::getPeak(i) / 1024.0);
+	write("total", 0, "mem_total_peak_kb", MemoryTracker::getTotalPeak() / 1024.0);
+	if (MemoryTracker::getBudget() > 0)
+		write("total", 0, "mem_budget_kb", MemoryTracker::getBudget() / 1024.0);
+	fout.close();
+	trace_calls = false;
+	std::lock_guard<std::mutex> trace_lock(tout_mutex);
+	tout.close();
+}
+
+void Profiler::closeAtExit() {
+	{
+		std::lock_guard<std::mutex> open_lock(open_mutex);
+		if (opened == 0) return;
+		opened = 1;
+	}
+	close();
+}
+
+long Profiler::peakRSS() {
+#if (__linux__ || __MACH__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+#ifdef __MACH__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+void Profiler::span(const char* name, const char* category,
+		std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end,
+		const std::string& args) {
+	std::lock_guard<std::mutex> lock(tout_mutex);
+	if (!tout.is_open()) return;
+	if (thread_id == 0) {
+		thread_id = ++thread_count;
+		tout << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << getpid() << ",\"tid\":" << thread_id
+			<< ",\"args\":{\"name\":\"" << ((thread_id == 1) ? "main" : "worker") << "\"}},\n";
+	}
+	long long ts = std::chrono::duration_cast<std::chrono::microseconds>(begin.time_since_epoch()).count();
+	long long dur = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+	tout << "{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":" << ts + epoch_offset_us
+		<< ",\"dur\":" << dur << ",\"pid\":" << getpid() << ",\"tid\":" << thread_id;
+	if (!args.empty())
+		tout << ",\"args\":{" << args << "}";
+	tout << "},\n";
+}
+
+void Profiler::flushRound(std::chrono::steady_clock::time_point now) {
+	// figures before the first round, e.g. running the counter examples, go to the totals only
+	bool named = !learner.empty();
+	if (named) {
+		std::ostringstream name, args;
+		name << learner << " round " << rnd;
+		// the phases of the round, aggregated into the round span
+		for (int i = 0; i < PHASE_NUM; i++) {
+			if (round_calls[i] == 0) continue;
+			args << (args.tellp() > 0 ? "," : "") << "\"" << phase_names[i] << "_ms\":" << round_ns[i] / 1e6
+				<< ",\"" << phase_names[i] << "_calls\":" << round_calls[i];
+		}
+		span(name.str().c_str(), "round", round_start, now, args.str());
+	}
+	std::lock_guard<std::mutex> lock(fout_mutex);
+	for (int i = 0; i < PHASE_NUM; i++) {
+		if (named && (round_calls[i] > 0)) {
+			write(learner.c_str(), rnd, (std::string(phase_names[i]) + "_ms").c_str(), round_ns[i] / 1e6);
+			write(learner.c_str(), rnd, (std::string(phase_names[i]) + "_calls").c_str(), round_calls[i]);
+		}
+		total_ns[i] += round_ns[i];
+		total_calls[i] += round_calls[i];
+		round_ns[i] = round_calls[i] = 0;
+	}
+	for (int i = 0; i < COUNT_NUM; i++) {
+		if (named && (round_counts[i] > 0))
+			write(learner.c_str(), rnd, counter_names[i], round_counts[i]);
+		total_counts[i] += round_counts[i];
+		round_counts[i] = 0;
+	}
+	if (named) {
+		write(learner.c_str(), rnd, "mem_kb", MemoryTracker::getTotal() / 1024.0);
+		memoryCounter(now);
+	}
+}
+
+void Profiler::memoryCounter(std::chrono::steady_clock::time_point when) {
+	std::lock_guard<std::mutex> lock(tout_mutex);
+	if (!tout.is_open()) return;
+	long long ts = std::chrono::duration_cast<std::chrono::microseconds>(when.time_since_epoch()).count();
+	tout << "{\"name\":\"memory_kb\",\"ph\":\"C\",\"ts\":" << ts + epoch_offset_us
+		<< ",\"pid\":" << getpid() << ",\"args\":{";
+	for (int i = 0; i < MEM_NUM; i++)
+		tout << ((i == 0) ? "" : ",") << "\"" << MemoryTracker::getName(i) << "\":"
+			<< MemoryTracker::getCurrent(i) / 1024;
+	tout << "}},\n";
+}
+
+void Profiler::write(const char* stage, int r, const char* metric, double value) {
+	fout << getpid() << "," << stage << "," << r << "," << metric << "," << value << "\n";
+}
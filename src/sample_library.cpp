@@ -0,0 +1,151 @@
+/** @file sample_library.cpp
+ *  @brief Implementation of the on-disk library of executions, see sample_library.h.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "sample_library.h"
+#include "context_state.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+static const char library_magic[8] = { 'I', 'I', 'F', 'S', 'L', 'I', 'B', '1' };
+
+SampleLibrary::SampleLibrary(const std::string& folder, const std::string& key)
+	: folder(folder), filename(folder + "/" + key + ".lib"), pending_num(0),
+	busy(false) {
+}
+
+unsigned long long SampleLibrary::executionHash(const int* input, const double* states, int len) {
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < Nv; i++)
+		h = (h ^ static_cast<unsigned int>(input[i])) * 1099511628211ULL;
+	for (int i = 0; i < len * Nv; i++) {
+		unsigned long long bits;
+		double v = states[i] + 0.0;	// +0.0 turns -0.0 into 0.0
+		memcpy(&bits, &v, sizeof(bits));
+		h = (h ^ bits) * 1099511628211ULL;
+	}
+	return h ^ static_cast<unsigned long long>(len);
+}
+
+template <typename T>
+static inline void append(std::string& buffer, const T& value) {
+	buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// read a value at pos of data, false if data ends before it
+template <typename T>
+static inline bool take(const std::string& data, size_t& pos, T& value) {
+	if (pos + sizeof(T) > data.size())
+		return false;
+	memcpy(&value, data.data() + pos, sizeof(T));
+	pos += sizeof(T);
+	return true;
+}
+
+bool SampleLibrary::load(std::vector<Execution>& executions) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	std::string data;
+	flock(fd, LOCK_SH);
+	char buf[65536];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		data.append(buf, n);
+	flock(fd, LOCK_UN);
+	close(fd);
+
+	ContextState* c = current_context;
+	size_t pos = 0;
+	while (pos + sizeof(library_magic) <= data.size()) {
+		if (memcmp(data.data() + pos, library_magic, sizeof(library_magic)) != 0)
+			break;
+		pos += sizeof(library_magic);
+		int nv, mstates, policy, k, num;
+		if (!take(data, pos, nv) || !take(data, pos, mstates) || !take(data, pos, policy) || !take(data, pos, k)
+				|| !take(data, pos, num) || (nv != Nv))
+			break;
+		bool reusable = (mstates == MstatesIn1trace) && (policy == c->sampling_policy) && (k == c->sampling_k);
+		int i = 0;
+		for (; i < num; i++) {
+			Execution e;
+			int len;
+			if (!take(data, pos, e.input) || !take(data, pos, e.label) || !take(data, pos, len)
+					|| (len < 0) || (pos + len * sizeof(double) * Nv > data.size()))
+				break;
+			e.reusable = reusable;
+			e.states.resize(len * Nv);
+			if (len > 0)
+				memcpy(&e.states[0], data.data() + pos, len * sizeof(double) * Nv);
+			pos += len * sizeof(double) * Nv;
+			if (known.insert(executionHash(e.input, (len > 0) ? &e.states[0] : NULL, len)).second)
+				executions.push_back(e);
+		}
+		if (i < num)
+			break;
+	}
+	return true;
+}
+
+void SampleLibrary::record(const int* input, int label, const double (*states)[Nv], int len) {
+	const double* values = (len > 0) ? states[0] : NULL;
+	if (!known.insert(executionHash(input, values, len)).second)
+		return;
+	busy = true;
+	for (int i = 0; i < Nv; i++)
+		append(buffer, input[i]);
+	append(buffer, label);
+	append(buffer, len);
+	if (len > 0)
+		buffer.append(reinterpret_cast<const char*>(values), len * sizeof(double) * Nv);
+	pending_num++;
+	busy = false;
+}
+
+bool SampleLibrary::flush() {
+	busy = true;
+	bool written = writePending();
+	busy = false;
+	return written;
+}
+
+bool SampleLibrary::flushIfIdle() {
+	return !busy && flush();
+}
+
+bool SampleLibrary::writePending() {
+	if (pending_num == 0)
+		return true;
+	ContextState* c = current_context;
+	std::string chunk(library_magic, sizeof(library_magic));
+	append(chunk, Nv);
+	append(chunk, MstatesIn1trace);
+	append(chunk, c->sampling_policy);
+	append(chunk, c->sampling_k);
+	append(chunk, pending_num);
+	chunk += buffer;
+
+	makeFolders(folder.c_str());
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+	if (fd < 0)
+		return false;
+	flock(fd, LOCK_EX);
+	size_t written = 0;
+	while (written < chunk.size()) {
+		ssize_t n = write(fd, chunk.data() + written, chunk.size() - written);
+		if (n <= 0)
+			break;
+		written += n;
+	}
+	flock(fd, LOCK_UN);
+	close(fd);
+	if (written < chunk.size())
+		return false;
+	buffer.clear();
+	pending_num = 0;
+	return true;
+}
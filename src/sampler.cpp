@@ -0,0 +1,203 @@
+/** @file sampler.cpp
+ *  @brief Implementation of the batch boundary sampler.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "sampler.h"
+#include "checkpoint.h"
+
+// the execution cache of the current context is the first thing to give up when the memory budget is short
+static long long compactExecutionCache(long long needed) {
+	ExecutionCache* cache = current_context->execution_cache;
+	long long bytes = cache->size() * ExecutionCache::entry_bytes;
+	cache->clear();
+	return bytes;
+}
+static bool execution_cache_compactor = MemoryTracker::addCompactor(compactExecutionCache);
+
+void InputSet::save(std::ostream& out) const {
+	writeBinary(out, static_cast<int>(keys.size()));
+	for (std::unordered_set<Key, KeyHash>::const_iterator it = keys.begin(); it != keys.end(); ++it)
+		writeBinary(out, *it);
+}
+
+bool InputSet::load(std::istream& in) {
+	int n;
+	if (!readBinary(in, n) || (n < 0))
+		return false;
+	clear();
+	for (int i = 0; i < n; i++) {
+		Key k;
+		if (!readBinary(in, k))
+			return false;
+		if (keys.insert(k).second)
+			MemoryTracker::add(MEM_SAMPLER, entry_bytes);
+	}
+	return true;
+}
+
+void ExecutionCache::save(std::ostream& out) const {
+	writeBinary(out, static_cast<int>(labels.size()));
+	for (std::unordered_map<InputSet::Key, int, InputSet::KeyHash>::const_iterator it = labels.begin(); it != labels.end(); ++it) {
+		writeBinary(out, it->first);
+		writeBinary(out, it->second);
+	}
+}
+
+bool ExecutionCache::load(std::istream& in) {
+	int n;
+	if (!readBinary(in, n) || (n < 0))
+		return false;
+	clear();
+	for (int i = 0; i < n; i++) {
+		InputSet::Key k;
+		int label;
+		if (!readBinary(in, k) || !readBinary(in, label))
+			return false;
+		if (labels.insert(std::make_pair(k, label)).second)
+			MemoryTracker::add(MEM_SAMPLER, entry_bytes);
+	}
+	return true;
+}
+
+/// the number of blocks tried for one conjunct before falling back to random inputs
+static const int Nretry_block = 10;
+
+int BoundarySampler::sample(const Classifier* cl, Solution* sols, int n) {
+	batch.clear();
+	if (n <= 0) return 0;
+	if ((cl == NULL) || (cl->size == 0)) {
+		fillRandom(sols, n, 1);
+		return 0;
+	}
+
+	int filled = 0;
+	int start = rand() % cl->size;
+	for (int c = 0; c < cl->size; c++) {
+		int quota = n / cl->size + ((c < n % cl->size) ? 1 : 0);
+		if (quota == 0) continue;
+		filled += sampleConjunct(*(*cl)[(start + c) % cl->size], sols + filled, quota);
+	}
+
+	int boundary = filled;
+	if (filled < n)
+		fillRandom(sols + filled, n - filled, 10);
+	return boundary;
+}
+
+bool BoundarySampler::accept(const int* input) {
+	const InputSet* done = (executed != NULL) ? executed : current_context->executed_inputs;
+	if (done->contains(input))
+		return false;
+	return batch.insert(input);
+}
+
+int BoundarySampler::fillRandom(Solution* sols, int n, int scale) {
+	const int minv = current_context->minv, maxv = current_context->maxv;
+	int input[Nv];
+	int got = 0;
+	for (int tries = 0; (got < n) && (tries < 10 * n); tries++) {
+		for (int j = 0; j < Nv; j++)
+			input[j] = rand() % (scale * (maxv - minv + 1)) + scale * minv;
+		if (accept(input))
+			sols[got++] = input;
+	}
+	// the scope is exhausted, duplicates are allowed from here on
+	for (; got < n; got++) {
+		for (int j = 0; j < Nv; j++)
+			input[j] = rand() % (scale * (maxv - minv + 1)) + scale * minv;
+		sols[got] = input;
+	}
+	return n;
+}
+
+int BoundarySampler::sampleConjunct(Polynomial& poly, Solution* sols, int n) {
+	const int et = poly.getEtimes();
+	const int dims = poly.getDims();
+	const int B = (2 * n > 8) ? 2 * n : 8;
+	const double eps = pow(0.01, PRECISION);
+	const int minv = current_context->minv, maxv = current_context->maxv;
+
+	base.resize(Nv * B);
+	powers.resize(Nv * (et + 1) * B);
+	coefs.resize((et + 1) * B);
+	terms.resize(B);
+
+	int got = 0;
+	for (int attempt = 0; (attempt < Nretry_block) && (got < n); attempt++) {
+		const int x = rand() % Nv;
+
+		// random base points and their powers, variable x is solved later
+		for (int j = 0; j < Nv; j++) {
+			double* bj = &base[j * B];
+			for (int b = 0; b < B; b++)
+				bj[b] = rand() % (maxv - minv + 1) + minv;
+			double* pj = &powers[j * (et + 1) * B];
+			for (int b = 0; b < B; b++)
+				pj[b] = 1;
+			for (int k = 1; k <= et; k++) {
+				double* pk = pj + k * B;
+				double* pk_1 = pj + (k - 1) * B;
+				for (int b = 0; b < B; b++)
+					pk[b] = pk_1[b] * bj[b];
+			}
+		}
+
+		// univariate coefficients in x for the whole block
+		for (int k = 0; k < (et + 1) * B; k++)
+			coefs[k] = 0;
+		for (int i = 0; i < dims; i++) {
+			if (poly.theta[i] == 0) continue;
+			double* t = &terms[0];
+			for (int b = 0; b < B; b++)
+				t[b] = poly.theta[i];
+			for (int j = 0; j < Nv; j++) {
+				int e = monomial::exponent(i, j);
+				if ((j == x) || (e == 0)) continue;
+				const double* pe = &powers[(j * (et + 1) + e) * B];
+				for (int b = 0; b < B; b++)
+					t[b] *= pe[b];
+			}
+			double* c = &coefs[monomial::exponent(i, x) * B];
+			for (int b = 0; b < B; b++)
+				c[b] += t[b];
+		}
+
+		// solve each point of the block, and take an integer next to the root
+		for (int b = 0; (b < B) && (got < n); b++) {
+			double uni[5];
+			int deg = 0;
+			for (int k = 0; k <= et; k++) {
+				uni[k] = coefs[k * B + b];
+				if (std::abs(uni[k]) > eps)
+					deg = k;
+			}
+			if (deg == 0) continue;
+
+			double root;
+			if (deg == 1) {
+				root = -uni[0] / uni[1];
+			} else if (deg == 2) {
+				double delta = uni[1] * uni[1] - 4 * uni[2] * uni[0];
+				if (delta < 0) continue;
+				double sq = (rand() % 2) ? sqrt(delta) : -sqrt(delta);
+				root = (-uni[1] + sq) / (2 * uni[2]);
+			} else if (Polynomial::gslSolvePolynomial(uni, deg, &root) == false) {
+				continue;
+			}
+			if (!(root <= 10.0 * maxv && root >= 10.0 * minv))
+				continue;
+
+			int input[Nv];
+			for (int j = 0; j < Nv; j++)
+				input[j] = static_cast<int>(base[j * B + b]);
+			// univariate loops have fixed roots, so look a bit further around them
+			int jitter = (Nv == 1) ? rand() % 5 - 2 : rand() % 2;
+			input[x] = static_cast<int>(floor(root)) + jitter;
+			if (accept(input))
+				sols[got++] = input;
+		}
+	}
+	return got;
+}
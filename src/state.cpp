@@ -1,21 +1,67 @@
 #include "states.h"
+#include "checkpoint.h"
+#include <new>
 
 States::~States() {
 	if (values != NULL) {
 		delete[] values;
 		values = NULL;
+		MemoryTracker::sub(MEM_STATES, static_cast<long long>(max_size) * sizeof(State));
 	}
 	if (t_index != NULL) {
 		delete[] t_index;
 		t_index = NULL;
+		MemoryTracker::sub(MEM_STATES, static_cast<long long>(max_traces) * sizeof(int));
 	}
+	MemoryTracker::sub(MEM_STATES, static_cast<long long>(trace_hashes.size()) * trace_hash_bytes);
+	for (int i = 0; i < mapped_block_num; i++)
+		delete[] mapped_blocks[i];
+	MemoryTracker::sub(MEM_MAPPED, static_cast<long long>(mapped_block_num) * mapped_block_size * sizeof(MState));
+	mapped_block_num = 0;
+}
+
+bool States::reserve(int states_needed, int traces_needed) {
+	if (states_needed > max_size) {
+		int new_size = max_size;
+		while (new_size < states_needed) new_size *= 2;
+		if (!MemoryTracker::reserve(static_cast<long long>(new_size) * sizeof(State)))
+			new_size = states_needed;
+		double(*previous_values)[Nv] = values;
+		if ((values = new (std::nothrow) double[new_size][Nv]) == NULL) {
+			values = previous_values;
+			return false;
+		}
+		memcpy(values, previous_values, size * sizeof(State));
+		delete[] previous_values;
+		MemoryTracker::add(MEM_STATES, static_cast<long long>(new_size - max_size) * sizeof(State));
+		max_size = new_size;
+	}
+	// t_index[traces_needed] is the end of the last trace
+	if (traces_needed >= max_traces) {
+		int new_traces = max_traces;
+		while (new_traces <= traces_needed) new_traces *= 2;
+		if (!MemoryTracker::reserve(static_cast<long long>(new_traces) * sizeof(int)))
+			new_traces = traces_needed + 1;
+		int* previous_t_index = t_index;
+		if ((t_index = new (std::nothrow) int[new_traces]) == NULL) {
+			t_index = previous_t_index;
+			return false;
+		}
+		memcpy(t_index, previous_t_index, (p_index + 1) * sizeof(int));
+		delete[] previous_t_index;
+		MemoryTracker::add(MEM_STATES, static_cast<long long>(new_traces - max_traces) * sizeof(int));
+		max_traces = new_traces;
+	}
+	return true;
 }
 
 bool States::initFromFile(int num, std::ifstream& fin) {
 	int label;
 	int tmpint;
 	char tmpchar;
-	for (int i = 0; i < num; i++) {
+	if (!reserve(size + num, p_index + 1))
+		return false;
+	for (int i = size; i < size + num; i++) {
 		fin >> label;
 		for (int j = 0; j < Nv; j++) {
 			fin >> tmpint >> tmpchar >> values[i][j];
@@ -29,71 +75,153 @@ bool States::initFromFile(int num, std::ifstream& fin) {
 	return true;
 }
 
-int States::addStates(State st[], int len) {
-	if (size + len >= max_size) {
-		//std::cerr << "exceed maximium program states." << std::endl;
-		int previous_max_size = max_size;
-		double(*previous_values)[Nv] = values;
-		//while (t_index[p_index] + len >= max_size)
-		max_size *= 2;
+void States::save(std::ostream& out) const {
+	int n = size;
+	int traces = p_index;
+	writeBinary(out, n);
+	writeBinary(out, traces);
+	out.write(reinterpret_cast<const char*>(values), n * sizeof(State));
+	out.write(reinterpret_cast<const char*>(t_index), (traces + 1) * sizeof(int));
+	writeBinary(out, static_cast<int>(trace_hashes.size()));
+	for (std::unordered_set<unsigned long long>::const_iterator it = trace_hashes.begin(); it != trace_hashes.end(); ++it)
+		writeBinary(out, *it);
+}
 
-		if ((values = new double[max_size][Nv]) == NULL)
-			return -1;
-		memcpy(values, previous_values, previous_max_size * Nv * sizeof(double));
+bool States::load(std::istream& in) {
+	assert(mapped_size == 0);
+	int n, traces, hashes;
+	if (!readBinary(in, n) || !readBinary(in, traces) || (n < 0) || (traces < 0))
+		return false;
+	if (!reserve(n, traces))
+		return false;
+	if (!in.read(reinterpret_cast<char*>(values), n * sizeof(State))
+			|| !in.read(reinterpret_cast<char*>(t_index), (traces + 1) * sizeof(int))
+			|| !readBinary(in, hashes))
+		return false;
+	MemoryTracker::sub(MEM_STATES, static_cast<long long>(trace_hashes.size()) * trace_hash_bytes);
+	trace_hashes.clear();
+	for (int i = 0; i < hashes; i++) {
+		unsigned long long h;
+		if (!readBinary(in, h))
+			return false;
+		trace_hashes.insert(h);
+	}
+	MemoryTracker::add(MEM_STATES, static_cast<long long>(trace_hashes.size()) * trace_hash_bytes);
+	size = n;
+	p_index = traces;
+	return true;
+}
 
+void States::clear() {
+	size = 0;
+	p_index = 0;
+	t_index[0] = 0;
+	MemoryTracker::sub(MEM_STATES, static_cast<long long>(trace_hashes.size()) * trace_hash_bytes);
+	trace_hashes.clear();
+	for (int i = 0; i < mapped_block_num; i++)
+		delete[] mapped_blocks[i];
+	MemoryTracker::sub(MEM_MAPPED, static_cast<long long>(mapped_block_num) * mapped_block_size * sizeof(MState));
+	mapped_block_num = 0;
+	mapped_size = 0;
+}
 
-		int* previous_t_index = t_index;
-		if ((t_index = new int[max_size]) == NULL)
-			return -1;
-		memcpy(t_index, previous_t_index, previous_max_size * sizeof(int));
+bool States::hasStates(State st[], int len) const {
+	int n = size;
+	for (int i = 0; i < len; i++) {
+		bool found = false;
+		for (int j = 0; (j < n) && !found; j++)
+			found = stateCmp(values[j], st[i]);
+		if (!found)
+			return false;
 	}
+	return true;
+}
+
+int States::addStates(State st[], int len) {
+	PROFILE_SCOPE(PHASE_ADD_STATES);
+	// the same trace brings nothing new, its states are compared as another trace may have the same hash
+	unsigned long long hash = traceHash(st, len);
+	if ((trace_hashes.count(hash) > 0) && hasStates(st, len))
+		return 0;
+	if (!reserve(size + len, p_index + 1))
+		return -1;
+	PROFILE_COUNT(COUNT_TRACES, 1);
 
 	int addLength = 0;
+	// size is published once the whole trace is added
+	int cur_size = size;
 	for (int i = 0; i < len; i++) {
 		// try to insert state st[i]
 		bool skip = false;
-		for (int j = 0; j < size; j++) {
+		for (int j = 0; j < cur_size; j++) {
 			if (stateCmp(values[j], st[i]) == true) {
 				skip = true;
 				break;
 			}
 		}
 		if (skip) continue;
-		stateCpy(&values[size], &st[i]);
+		stateCpy(&values[cur_size], &st[i]);
 		addLength++;
-		size++;
+		cur_size++;
 	}
 	t_index[p_index + 1] = t_index[p_index] + addLength;
+	size = cur_size;
 	p_index++;
+	// the trace is only known once it is stored, so that a trace which could not be stored can be added again.
+	// under a tight budget, forget the traces seen; a repeated trace is then only deduplicated state by state
+	if (MemoryTracker::available() < 0) {
+		MemoryTracker::sub(MEM_STATES, static_cast<long long>(trace_hashes.size()) * trace_hash_bytes);
+		std::unordered_set<unsigned long long>().swap(trace_hashes);
+	} else {
+		trace_hashes.insert(hash);
+		MemoryTracker::add(MEM_STATES, trace_hash_bytes);
+	}
 	//std::cout << "+" << addLength << " ";
 	return addLength;
 }
 
-void States::dumpTrace(int num) {
+int States::ensureMapped() {
+	PROFILE_SCOPE(PHASE_MAPPING);
+	int pre_mapped_size = mapped_size;
+	int i = pre_mapped_size;
+	for (; i < size; i++) {
+		if (i % mapped_block_size == 0) {
+			assert(mapped_block_num < max_mapped_blocks);
+			mapped_blocks[mapped_block_num++] = new MState[mapped_block_size];
+			MemoryTracker::add(MEM_MAPPED, mapped_block_size * sizeof(MState));
+		}
+		monomial::expand(values[i], mapped_blocks[i / mapped_block_size][i % mapped_block_size], 4);
+	}
+	// published after the states are mapped
+	mapped_size = i;
+	return i - pre_mapped_size;
+}
+
+void States::dumpTrace(int num, std::ostream& out) {
 	if (num >= p_index) {
-		std::cerr << "exceed state set boundary" << std::endl;
+		out << "exceed state set boundary" << std::endl;
 		return;
 	}
 	for (int i = t_index[num]; i < t_index[num + 1]; i++) {
-		std::cout << "(" << values[i][0];
+		out << "(" << values[i][0];
 		for (int j = 1; j < Nv; j++)
-			std::cout << "," << values[i][j];
-		std::cout << ")->";
+			out << "," << values[i][j];
+		out << ")->";
 	}
-	std::cout << "end.";
+	out << "end.";
 }
 
 std::ostream& operator<< (std::ostream& out, const States& ss) {
 	//std::cout << "lable[" << ss.label << "]:" << std::endl;
 	for (int i = 0; i < ss.p_index; i++) {
-		std::cout << "\tTr." << i << ":";
+		out << "\tTr." << i << ":";
 		for (int j = ss.t_index[i]; j < ss.t_index[i + 1]; j++) {
-			std::cout << "(" << ss.values[j][0];
+			out << "(" << ss.values[j][0];
 			for (int k = 1; k < Nv; k++)
-				std::cout << "," << ss.values[j][k];
-			std::cout << ")->";
+				out << "," << ss.values[j][k];
+			out << ")->";
 		}
-		std::cout << "end." << std::endl;
+		out << "end." << std::endl;
 	}
 	return out;
 }
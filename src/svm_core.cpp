@@ -10,13 +10,18 @@
 //#include "svm.h"
 #include "svm_core.h"
 #include "color.h"
+#include "profiler.h"
+#include "logger.h"
+#include "memtrack.h"
+#include "time_budget.h"
 #if (linux || __MACH__)
 #include "z3++.h"
 using namespace z3;
 #endif
 
 int libsvm_version = LIBSVM_VERSION;
-int DIMENSION = Nv;
+// set by the learner of the calling thread before training, see MLalgo::setEtimes
+thread_local int DIMENSION = Nv;
 typedef float Qfloat;
 typedef signed char schar;
 #ifndef min
@@ -104,6 +109,10 @@ class Cache
 Cache::Cache(int l_,long int size_):l(l_),size(size_)
 {
 	head = (head_t *)calloc(l,sizeof(head_t));	// initialized to 0
+	MemoryTracker::add(MEM_SVM_CACHE, (long long)l * sizeof(head_t));
+	// under a memory budget, the cache takes at most what is left
+	if(size > MemoryTracker::available())
+		size = (long int) max(MemoryTracker::available(), 0LL);
 	size /= sizeof(Qfloat);
 	size -= l * sizeof(head_t) / sizeof(Qfloat);
 	size = max(size, 2 * (long int) l);	// cache must be large enough for two columns
@@ -112,9 +121,14 @@ Cache::Cache(int l_,long int size_):l(l_),size(size_)
 
 Cache::~Cache()
 {
+	long long bytes = (long long)l * sizeof(head_t);
 	for(head_t *h = lru_head.next; h != &lru_head; h=h->next)
+	{
+		bytes += (long long)h->len * sizeof(Qfloat);
 		free(h->data);
+	}
 	free(head);
+	MemoryTracker::sub(MEM_SVM_CACHE, bytes);
 }
 
 void Cache::lru_delete(head_t *h)
@@ -148,6 +162,7 @@ int Cache::get_data(const int index, Qfloat **data, int len)
 			lru_delete(old);
 			free(old->data);
 			size += old->len;
+			MemoryTracker::sub(MEM_SVM_CACHE, (long long)old->len * sizeof(Qfloat));
 			old->data = 0;
 			old->len = 0;
 		}
@@ -155,6 +170,7 @@ int Cache::get_data(const int index, Qfloat **data, int len)
 		// allocate new space
 		h->data = (Qfloat *)realloc(h->data,sizeof(Qfloat)*len);
 		size -= more;
+		MemoryTracker::add(MEM_SVM_CACHE, (long long)more * sizeof(Qfloat));
 		swap(h->len,len);
 	}
 
@@ -187,6 +203,7 @@ void Cache::swap_index(int i, int j)
 				lru_delete(h);
 				free(h->data);
 				size += h->len;
+				MemoryTracker::sub(MEM_SVM_CACHE, (long long)h->len * sizeof(Qfloat));
 				h->data = 0;
 				h->len = 0;
 			}
@@ -549,6 +566,12 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 			counter = min(l,1000);
 			if(shrinking) do_shrinking();
 			info(".");
+			// the learner is out of its time slice, stop as at max_iter, see TimeBudget
+			if(TimeBudget::overdue())
+			{
+				max_iter = iter;
+				break;
+			}
 		}
 
 		int i,j;
@@ -707,6 +730,7 @@ void Solver::Solve(int l, const QMatrix& Q, const double *p_, const schar *y_,
 		}
 	}
 	//std::cout << "oprimization step 3.\n";
+	PROFILE_COUNT(COUNT_SMO_ITERATIONS, iter);
 
 	if(iter >= max_iter)
 	{
@@ -2573,6 +2597,11 @@ double svm_predict(const svm_model *model, const svm_node *x)
 	return pred_result;
 }
 
+double svm_kernel_function(const svm_node *x, const svm_node *y, const svm_parameter *param)
+{
+	return Kernel::k_function(x, y, *param);
+}
+
 double svm_predict_probability(
 		const svm_model *model, const svm_node *x, double *prob_estimates)
 {
@@ -3167,7 +3196,7 @@ bool svm_model_z3_conjunctive(const svm_model *m, Classifier* cl) //, Polynomial
 		return false;
 	if (cl == NULL)
 		return false;
-	std::cout << *m << std::endl;
+	IIF_LOG(LOG_SOLVE, LOG_INFO) << *m << std::endl;
 
 	/*
 #if (linux || __MACH__)
@@ -3414,11 +3443,11 @@ void prepare_svm_parameters(struct svm_parameter* param, int type, int degree) {
 		//std::cout << "Using LINEAR kernel...\n";
 		param->kernel_type = LINEAR;
 	} else if (type == 1){
-		std::cout << "Using POLY kernel...\n";
+		IIF_LOG(LOG_SVM, LOG_DEBUG) << "Using POLY kernel...\n";
 		param->kernel_type = POLY;
 		param->gamma = 8;//1.0/DIMENSION;	// 1/num_features
 	} else if (type == 2){
-		std::cout << "Using RBF kernel...\n";
+		IIF_LOG(LOG_SVM, LOG_DEBUG) << "Using RBF kernel...\n";
 		param->kernel_type = RBF;
 		param->gamma = 20; ///DIMENSION; //0;	// 1/num_features
 	}
@@ -3452,9 +3481,7 @@ bool node_polyal(svm_node* n1, svm_node* n2)
 bool model_converged(struct svm_model *m1, struct svm_model *m2)
 {
 	if ((m1 == NULL) || (m2 == NULL)) return false;
-#ifdef __PRT
-	std::cout << " sv[" << m1->l << "," << m2->l <<"] ";
-#endif
+	IIF_LOG(LOG_SVM, LOG_DEBUG) << " sv[" << m1->l << "," << m2->l <<"] ";
 	//std::cout << "\n" << BLUE << "\tfirst model:"<< *m1 << std::endl;
 	//std::cout << "\tsecond model:"<< *m2 << NORMAL << std::endl;
 	if (m1->nr_class != m2->nr_class) return false;
@@ -3558,7 +3585,7 @@ bool svm_model_approximate(const svm_model *m, int times/*, Classifier* cl*/)
 	if (cl == NULL)
 		return false;
 		*/
-	std::cout << *m << std::endl;
+	IIF_LOG(LOG_SOLVE, LOG_INFO) << *m << std::endl;
 
 #if (linux || __MACH__)
 	double* label = m->sv_coef[0];
@@ -3613,18 +3640,15 @@ bool svm_model_approximate(const svm_model *m, int times/*, Classifier* cl*/)
 		s.add(A[i][0] >= A[i-1][0]);
 	if (times >= 2)
 		s.add(A[1][0] > 0);
-#ifdef __PRT_Z3SOLVE
-	std::cout << s << std::endl;
-#endif
-	std::cout << s << std::endl;
+	IIF_LOG(LOG_SOLVE, LOG_DEBUG) << s << std::endl;
 	z3::check_result ret = s.check();
 	if (ret == unsat) {
-		std::cout << "UNSAT. can not get Z3 MODEL.\n";
+		IIF_LOG(LOG_SOLVE, LOG_INFO) << "UNSAT. can not get Z3 MODEL.\n";
 		return false;
 	}
 
 	z3::model z3m = s.get_model();
-	std::cout << GREEN << "Z3 MODEL: "<< RED << z3m << "\n" << NORMAL;
+	IIF_LOG(LOG_SOLVE, LOG_INFO) << GREEN << "Z3 MODEL: "<< RED << z3m << "\n" << NORMAL;
 
 #endif
 	return true;
@@ -3638,7 +3662,7 @@ bool svm_problem_approximate(const svm_problem *sp, int times/*, Classifier* cl*
 	if (cl == NULL)
 		return false;
 		*/
-	std::cout << *sp << std::endl;
+	IIF_LOG(LOG_SOLVE, LOG_INFO) << *sp << std::endl;
 
 #if (linux || __MACH__)
 	double* label = sp->y;
@@ -3693,18 +3717,15 @@ bool svm_problem_approximate(const svm_problem *sp, int times/*, Classifier* cl*
 		s.add(A[i][0] >= A[i-1][0]);
 	if (times >= 2)
 		s.add(A[1][0] > 0);
-#ifdef __PRT_Z3SOLVE
-	std::cout << s << std::endl;
-#endif
-	std::cout << s << std::endl;
+	IIF_LOG(LOG_SOLVE, LOG_DEBUG) << s << std::endl;
 	z3::check_result ret = s.check();
 	if (ret == unsat) {
-		std::cout << "UNSAT. can not get Z3 MODEL.\n";
+		IIF_LOG(LOG_SOLVE, LOG_INFO) << "UNSAT. can not get Z3 MODEL.\n";
 		return false;
 	}
 
 	z3::model z3m = s.get_model();
-	std::cout << GREEN << "Z3 MODEL: "<< RED << z3m << "\n" << NORMAL;
+	IIF_LOG(LOG_SOLVE, LOG_INFO) << GREEN << "Z3 MODEL: "<< RED << z3m << "\n" << NORMAL;
 
 #endif
 	return true;
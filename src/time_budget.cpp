@@ -0,0 +1,71 @@
+/** @file time_budget.cpp
+ *  @brief Implementation of the wall-clock budget of a run, see time_budget.h.
+ *
+ *  @author Li Jiaying
+ *  @bug No known bugs.
+ */
+#include "time_budget.h"
+
+thread_local TimeBudget::Clock::time_point TimeBudget::thread_deadline = TimeBudget::Clock::time_point::max();
+
+TimeBudget::TimeBudget() : is_limited(false), sample_cost(0), best_learner(NULL), best_converged(-1) {
+}
+
+void TimeBudget::start(double seconds) {
+	is_limited = (seconds > 0);
+	if (is_limited)
+		deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+	std::lock_guard<std::mutex> lock(mutex);
+	sample_cost = 0;
+	best_learner = NULL;
+	best_candidate.clear();
+	best_converged = -1;
+}
+
+double TimeBudget::remaining() const {
+	if (!is_limited)
+		return 1e9;
+	double left = std::chrono::duration<double>(deadline - Clock::now()).count();
+	return (left > 0) ? left : 0;
+}
+
+TimeBudget::Clock::time_point TimeBudget::slice(int learners) const {
+	if (!is_limited)
+		return Clock::time_point::max();
+	if (learners <= 1)
+		return deadline;
+	Clock::time_point now = Clock::now();
+	return (now >= deadline) ? deadline : now + (deadline - now) / learners;
+}
+
+void TimeBudget::recordSampling(int samples, double seconds) {
+	if (samples <= 0)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	double cost = seconds / samples;
+	// the first round has no history, the later ones follow the loop as its inputs grow
+	sample_cost = (sample_cost == 0) ? cost : (sample_cost + cost) / 2;
+}
+
+double TimeBudget::sampleCost() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return sample_cost;
+}
+
+void TimeBudget::offer(BaseLearner* learner, const std::string& candidate, int converged_time) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (converged_time < best_converged)
+		return;
+	best_learner = learner;
+	best_candidate = candidate;
+	best_converged = converged_time;
+}
+
+bool TimeBudget::best(BaseLearner*& learner, std::string& candidate) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (best_learner == NULL)
+		return false;
+	learner = best_learner;
+	candidate = best_candidate;
+	return true;
+}
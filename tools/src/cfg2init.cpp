@@ -13,7 +13,8 @@
 using namespace std;
 
 const int max_confignum = 32;
-enum category {NAME=0, BEFL, BEFLI, SYM, PREC, LOOPC, LOOP, POSTC, AFTL, INV, LEARNERS};
+// sampling and deterministic are only read by cfg2test, they are known here so that they are not taken as lines of the key before
+enum category {NAME=0, BEFL, BEFLI, SYM, PREC, LOOPC, LOOP, POSTC, AFTL, INV, SAMPLING, DETERMINISTIC, LEARNERS};
 
 class Config {
 	public:
@@ -71,6 +72,8 @@ class FileHelper {
 			cs[i++].key = "postcondition";
 			cs[i++].key = "afterloop";
 			cs[i++].key = "invariant";
+			cs[i++].key = "sampling";
+			cs[i++].key = "deterministic";
 			cs[i++].key = "learners";
 			confignum = i;
 			for (int i = 0; i < confignum; i++)
@@ -3,6 +3,7 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include "../../include/loop_key.h"
 using namespace std;
 
 const int max_confignum = 32;
@@ -64,6 +65,9 @@ class FileHelper {
 			cs[i++].key = "loop";
 			cs[i++].key = "postcondition";
 			cs[i++].key = "afterloop";
+			cs[i++].key = "sampling";
+			cs[i++].key = "deterministic";
+			// learners should always be the last key
 			cs[i++].key = "learners";
 			confignum = i;
 			vnum = 0;
@@ -170,8 +174,20 @@ class FileHelper {
 		}
 
 	private:
+		/// the key of the loop in its sample library, see include/loop_key.h
+		string loopKey() {
+			// the sections from names to afterloop, which come before sampling
+			string sections[max_confignum];
+			int num = 0;
+			while ((num < confignum) && (cs[num].key != "sampling")) {
+				sections[num] = cs[num].value;
+				num++;
+			}
+			return ::loopKey(sections, num);
+		}
+
 		inline bool writeRecordi(ofstream& cppFile) {
-			cppFile << "recordi(" << variables[0];
+			cppFile << "iif_record(" << variables[0];
 			for (int i = 1; i < vnum; i++)
 				cppFile << ", " << variables[i];
 			cppFile << ");";
@@ -226,6 +242,7 @@ class FileHelper {
 					<<"\", loopFunction, \"loopFunction\", \"../" << oldtracefilename << "\");\n";
 			else
 				cppFile << "iifContext context(\"../" << varfilename <<"\", loopFunction, \"loopFunction\");\n";
+			cppFile << "context.setLoopKey(\"" << loopKey() << "\");\n";
 
 			{
 				/*std::cout << "size=" << learners.size() << std::endl;
@@ -257,6 +274,26 @@ class FileHelper {
 				std::cout << "]]";
 			}
 
+			// deterministic=true, the loop always gives the same trace on the same input
+			for (int i = 0; i < confignum; i++) {
+				if ((cs[i].key == "deterministic") && (cs[i].value.find("true") != string::npos))
+					cppFile << "context.setDeterministic(true);\n";
+			}
+
+			// sampling=policy [k], e.g. sampling=reservoir 256
+			for (int i = 0; i < confignum; i++) {
+				if ((cs[i].key != "sampling") || (cs[i].value.find_first_not_of(" \t\n") == string::npos))
+					continue;
+				istringstream sin(cs[i].value);
+				string policy;
+				int k = 0;
+				sin >> policy >> k;
+				cppFile << "context.setTraceSampling(\"" << policy << "\"";
+				if (k > 0)
+					cppFile << ", " << k;
+				cppFile << ");\n";
+			}
+
 			if (testcasefilename) {
 				cppFile << "return context.learn(\"../" << testcasefilename << "\", \"../" << invfileprefix << "\");\n}" << endl;
 			} else {
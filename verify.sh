@@ -33,6 +33,11 @@ file_cnt=$prefix".cnt"
 path_cnt=$dir_temp""$file_cnt
 file_cnt_lib=$prefix".cntlib"
 path_cnt_lib=$dir_temp""$file_cnt_lib
+file_canon=$prefix".canon"
+path_canon=$dir_temp""$file_canon
+path_vc=$dir_temp""$prefix".vc"
+file_prof=$prefix".prof.csv"
+file_trace=$prefix".trace.json"
 
 file_verif=$prefix".c"
 path_verif=$dir_temp""$file_verif
@@ -55,9 +60,11 @@ while [ $i -lt $n ]; do
 	path_smt2=$smtname""$i".smt2"
 	path_model=$smtname""$i".model"
 	echo -n "  |-- processing "$path_smt2" ---> "
+	vc_start=$(date +%s%N)
 	"../../tools/smt2_bv2int.sh" $path_smt2 
 	"../../tools/bin/smt2solver" $path_smt2 > $path_model
 	result=$?
+	func_traceSpan "../"$file_trace $path_smt2 vc $vc_start $u
 	if [ $result -gt 1 ]; then
 		echo -e $red$bold"A Error Occurs during smt2solver"$normal
 		exit 2 
@@ -95,8 +102,56 @@ done
 return 0
 }
 
+# append a chrome trace span to file $1, named $2 in category $3, from $4 (in ns) till now, on track $5
+function func_traceSpan(){
+now=$(date +%s%N)
+echo "{\"name\":\"$2\",\"cat\":\"$3\",\"ph\":\"X\",\"ts\":$(($4 / 1000)),\"dur\":$((($now - $4) / 1000)),\"pid\":$$,\"tid\":$5}," >> $1
+}
+
+# append the time of verifying property $1 since $2 (in ns) to the profile of the learner
+function func_profileVerify(){
+elapsed=$(( ($(date +%s%N) - $2) / 1000 ))
+if [ ! -s "../"$file_prof ]; then
+	echo "pid,stage,round,metric,value" > "../"$file_prof
+fi
+echo "$$,verify,$1,verify_ms,$(($elapsed / 1000)).$(printf "%03d" $(($elapsed % 1000)))" >> "../"$file_prof
+}
+
+# print why the candidate is not an invariant, as property $1 failed
+function func_printFailure(){
+echo -n -e $red">>>NOT A VALID INVARIVANT..."
+if [ $1 -eq 1 ]; then
+	echo -e $bold"Reason: Property I (precondition ==> invariant) FAILED. stop here..."$normal
+elif [ $1 -eq 2 ]; then
+	echo -e $bold"Reason: Property II (invariant && loopcondition =S=> invariant) FAILED. stop here..."$normal 
+elif [ $1 -eq 3 ]; then
+	echo -e $bold"Reason: Property III (invariant && ~loopcondition ==> postcondition) FAILED. stop here..."$normal
+fi
+}
+
+# look property $1 of the candidate up in the memo, 0 if it passed, 1 if it failed, 2 if it is unknown
+# a failed one gives its counter example again
+function func_memoLookup(){
+memo=$path_vc"/"$vc_key"."$1
+if [ -f $memo".pass" ]; then
+	echo -e "  |-- property "$1" of the candidate passed before"$green$bold" [PASS]"$normal
+	return 0
+fi
+if [ -s $memo".cnt" ]; then
+	cp $memo".cnt" $path_cnt
+	echo -n -e "  |-- property "$1" of the candidate failed before"$red$bold" [FAIL]"$normal
+	echo -e " >>> counter example is stored at "$yellow$path_cnt$normal
+	return 1
+fi
+return 2
+}
+
 function KleeVerify(){
 u=$1
+if [ -f "../"$path_vc"/"$vc_key"."$u".pass" ]; then
+	return 0
+fi
+verify_start=$(date +%s%N)
 cd $prefix"_klee"$u 
 rm -rf klee-*
 rm -rf *.smt2
@@ -108,19 +163,19 @@ klee -write-smt2s $file_o_verif > /dev/null 2>&1
 ret=$?
 func_findSmtForZ3
 ret=$?
+if [ $ret -eq 0 ]; then
+	touch "../../"$path_vc"/"$vc_key"."$u".pass"
+elif [ $ret -eq 1 ]; then
+	cp "../../"$path_cnt "../../"$path_vc"/"$vc_key"."$u".cnt"
+fi
+func_profileVerify $u $verify_start
+func_traceSpan "../"$file_trace "property "$u verify $verify_start $u
 #echo -n -e $red$ret$normal
 if [ $ret -eq 2 ]; then
 	exit $ret
 fi
 if [ $ret -eq 1 ]; then
-	echo -n -e $red">>>NOT A VALID INVARIVANT..."
-	if [ $u -eq 1 ]; then
-		echo -e $bold"Reason: Property I (precondition ==> invariant) FAILED. stop here..."$normal
-	elif [ $u -eq 2 ]; then
-		echo -e $bold"Reason: Property II (invariant && loopcondition =S=> invariant) FAILED. stop here..."$normal 
-	elif [ $u -eq 3 ]; then
-		echo -e $bold"Reason: Property III (invariant && ~loopcondition ==> postcondition) FAILED. stop here..."$normal
-	fi
+	func_printFailure $u
 	exit $ret
 fi
 #echo -e $blue"[PASS]"$normal
@@ -135,16 +190,55 @@ return 0
 ##########################################################################
 # From inv files to prepare for verification step
 ##########################################################################
+if [ ! -s $dir_temp""$file_trace ]; then
+	echo "[" > $dir_temp""$file_trace
+fi
+echo "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":$$,\"tid\":0,\"args\":{\"name\":\"verify $prefix\"}}," >> $dir_temp""$file_trace
 echo -n -e $blue"Invariant file is located at "$path_inv" >>> "$normal
 cat $path_inv
 echo ""
 
 
+##########################################################################
+# Look the candidate up in the memo of the verification results
+##########################################################################
+# a candidate is known by the canonical form of its classifier, see Classifier::canonical,
+# or by its text without blanks if the learner did not write it, e.g. the precondition.
+# The results are kept in tmp/<prefix>.vc/<key>.<property>.pass or .cnt for the run, see run_once.sh.
+inv_text=$(cat $path_inv)
+if [ -s $path_canon ] && [ "$(head -n 1 $path_canon)" = "$inv_text" ]; then
+	canon=$(sed -n 2p $path_canon)
+else
+	canon=$(echo "$inv_text" | tr -d ' \t\n')
+fi
+vc_key=$( (sed 's/[[:space:]]\+/ /g; s/^ //; s/ $//' $path_cfg | grep -v '^$'; echo "invariant="$canon) | sha1sum | cut -d' ' -f1)
+mkdir -p $path_vc
+memo_ret=0
+for u in 1 2 3; do
+	func_memoLookup $u
+	memo_ret=$?
+	if [ $memo_ret -eq 1 ]; then
+		func_printFailure $u
+		exit 1
+	fi
+	if [ $memo_ret -eq 2 ]; then
+		break
+	fi
+done
+if [ $memo_ret -eq 0 ]; then
+	echo -e $bold$green"-----------------------------------------------------------finish proving---------------------------------------------------------------"$normal
+	echo -n -e $green"The invariant can be "$yellow
+	cat $path_inv
+	echo -e "\n"$normal
+	exit 0
+fi
+
+
 ##########################################################################
 # Generating a new config file contains the invariant candidate...
 ##########################################################################
 echo -n -e $blue"Generating a new config file contains the invariant candidate..."$normal
-path_tmp_cfg="tmp/tmp.cfg"
+path_tmp_cfg=$dir_temp""$prefix".tmp.cfg"
 cp $path_cfg $path_tmp_cfg
 echo "" >> $path_tmp_cfg
 echo -n "invariant=" >> $path_tmp_cfg